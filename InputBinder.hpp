@@ -6,6 +6,7 @@
 #include <mysql/mysql.h>
 
 #include <string>
+#include <tuple>
 #include <vector>
 
 /**
@@ -16,6 +17,16 @@ void bindInputs(
     std::vector<MYSQL_BIND>* inputBindParameters,
     const Args&... args);
 
+/**
+ * Binds the values in row to the parameters starting at offset, e.g. to bind
+ * one row of a multi-row INSERT.
+ */
+template <typename... Args>
+void bindInputTuple(
+    std::vector<MYSQL_BIND>* inputBindParameters,
+    size_t offset,
+    const std::tuple<Args...>& row);
+
 namespace InputBinderPrivate {
 
 // C++11 doesn't allow for partial template specialization of variadic
@@ -165,6 +176,36 @@ struct InputBinder<N, type, Tail...> { \
 INPUT_BINDER_FLOATING_TYPE_SPECIALIZATION(float, MYSQL_TYPE_FLOAT, 4)
 INPUT_BINDER_FLOATING_TYPE_SPECIALIZATION(double, MYSQL_TYPE_DOUBLE, 8)
 
+
+// Unpacks a tuple into a parameter pack, from the last element to the first,
+// so that it can be bound with bindInputs
+template <size_t Remaining>
+struct TupleUnpacker {
+    template <typename Tuple, typename... Unpacked>
+    static void bind(
+        std::vector<MYSQL_BIND>* const bindParameters,
+        const Tuple& tuple,
+        const Unpacked&... unpacked
+    ) {
+        TupleUnpacker<Remaining - 1>::bind(
+            bindParameters,
+            tuple,
+            std::get<Remaining - 1>(tuple),
+            unpacked...);
+    }
+};
+template <>
+struct TupleUnpacker<0> {
+    template <typename Tuple, typename... Unpacked>
+    static void bind(
+        std::vector<MYSQL_BIND>* const bindParameters,
+        const Tuple&,
+        const Unpacked&... unpacked
+    ) {
+        InputBinder<0, Unpacked...>::bind(bindParameters, unpacked...);
+    }
+};
+
 }  // namespace InputBinderPrivate
 
 
@@ -178,4 +219,26 @@ void bindInputs(
         args...);
 }
 
+
+template <typename... Args>
+void bindInputTuple(
+    std::vector<MYSQL_BIND>* const inputBindParameters,
+    const size_t offset,
+    const std::tuple<Args...>& row
+) {
+    std::vector<MYSQL_BIND> rowBindParameters(sizeof...(Args));
+    InputBinderPrivate::TupleUnpacker<sizeof...(Args)>::bind(
+        &rowBindParameters,
+        row);
+    for (size_t i = 0; i < rowBindParameters.size(); ++i) {
+        MYSQL_BIND& bindParameter = inputBindParameters->at(offset + i);
+        bindParameter = rowBindParameters.at(i);
+        // Strings point their length at their own buffer_length, so it has
+        // to follow the copy
+        if (nullptr != bindParameter.length) {
+            bindParameter.length = &bindParameter.buffer_length;
+        }
+    }
+}
+
 #endif  // INPUTBINDER_HPP_
@@ -3,13 +3,21 @@
 
 #include <cassert>
 #include <cstdint>
+#include <mysql/errmsg.h>
 #include <mysql/mysql.h>
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <utility>
 #include <vector>
 
 
+using std::move;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
@@ -20,33 +28,33 @@ MySql::MySql(
     const char* password,
     const uint16_t port
 )
-#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)
-    : MySql(hostname, username, password, nullptr, port)
+    : MySql(hostname, username, password, nullptr, MySqlOptions(), port)
 {
 }
-#else
-    : connection_(mysql_init(nullptr))
+
+
+MySql::MySql(
+    const char* const hostname,
+    const char* const username,
+    const char* const password,
+    const char* const database,
+    const uint16_t port
+)
+    : MySql(hostname, username, password, database, MySqlOptions(), port)
 {
-    if (nullptr == connection_) {
-        throw MySqlException("Unable to connect to MySQL");
-    }
+}
 
-    const MYSQL* const success = mysql_real_connect(
-        connection_,
-        hostname,
-        username,
-        password,
-        nullptr,
-        port,
-        nullptr,
-        0);
-    if (nullptr == success) {
-        MySqlException mse(connection_);
-        mysql_close(connection_);
-        throw mse;
-    }
+
+// mysql_real_connect treats empty strings the same as nullptr, so they're
+// saved as empty strings
+static string toString(const char* const value) {
+    return nullptr == value ? string() : string(value);
+}
+
+
+static const char* toNullable(const string& value) {
+    return value.empty() ? nullptr : value.c_str();
 }
-#endif
 
 
 MySql::MySql(
@@ -54,55 +62,319 @@ MySql::MySql(
     const char* const username,
     const char* const password,
     const char* const database,
+    const MySqlOptions& options,
     const uint16_t port
 )
-    : connection_(mysql_init(nullptr))
+    : hostname_(toString(hostname))
+    , username_(toString(username))
+    , password_(toString(password))
+    , database_(toString(database))
+    , port_(port)
+    , options_(options)
+    , connection_(std::make_shared<MySqlConnectionState>())
+    , queryCache_()
+    , transactionTables_()
+    , transactionClearsCache_(false)
+    , cachedStatements_()
 {
-    if (nullptr == connection_) {
+    connection_->handle = connect();
+}
+
+
+MYSQL* MySql::connect() const {
+    MYSQL* const connection = mysql_init(nullptr);
+    if (nullptr == connection) {
         throw MySqlException("Unable to connect to MySQL");
     }
 
+    try {
+        options_.apply(connection);
+    } catch (...) {
+        mysql_close(connection);
+        throw;
+    }
+
     const MYSQL* const success = mysql_real_connect(
-        connection_,
-        hostname,
-        username,
-        password,
-        database,
-        port,
-        nullptr,
+        connection,
+        toNullable(hostname_),
+        toNullable(username_),
+        toNullable(password_),
+        toNullable(database_),
+        port_,
+        options_.getUnixSocket(),
         0);
     if (nullptr == success) {
-        MySqlException mse(connection_);
-        mysql_close(connection_);
+        MySqlException mse(connection);
+        mysql_close(connection);
         throw mse;
     }
+    return connection;
+}
+
+
+static bool isLostConnectionError(const unsigned int error) {
+    switch (error) {
+        case CR_SERVER_GONE_ERROR:
+        case CR_SERVER_LOST:
+#ifdef CR_SERVER_LOST_EXTENDED
+        case CR_SERVER_LOST_EXTENDED:
+#endif
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+bool MySql::isConnectionLost(
+    const MySqlPreparedStatement* const statement
+) const {
+    if (0 == options_.getReconnectAttempts()) {
+        return false;
+    }
+    return isLostConnectionError(mysql_errno(connection_->handle))
+        || (nullptr != statement
+            && isLostConnectionError(
+                mysql_stmt_errno(statement->statementHandle_)));
+}
+
+
+bool MySql::reconnect() const {
+    MYSQL* const oldConnection = connection_->handle;
+    // The status is from the last reply before the connection was lost
+    const bool inTransaction =
+        0 != (oldConnection->server_status & SERVER_STATUS_IN_TRANS);
+
+    unsigned int delay = options_.getReconnectInitialDelay();
+    for (unsigned int attempt = 0;
+        attempt < options_.getReconnectAttempts();
+        ++attempt
+    ) {
+        if (0 != attempt) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            delay = std::min(delay * 2, options_.getReconnectMaximumDelay());
+        }
+
+        MYSQL* newConnection;
+        try {
+            newConnection = connect();
+        } catch (const MySqlException&) {
+            continue;
+        }
+        // Statements prepared on the old connection are detached by
+        // mysql_close and prepare themselves again when they're next used
+        mysql_close(oldConnection);
+        connection_->handle = newConnection;
+        ++connection_->generation;
+        return !inTransaction;
+    }
+    return false;
+}
+
+
+bool MySql::isInTransaction() const {
+    return 0 != (connection_->handle->server_status & SERVER_STATUS_IN_TRANS);
+}
+
+
+void MySql::invalidateCachedTables(const char* const statement) {
+    if (nullptr == queryCache_) {
+        return;
+    }
+    // Right away, so that this connection sees its own writes
+    queryCache_->invalidateTablesIn(statement);
+
+    if (isInTransaction()) {
+        vector<string> tables;
+        if (MySqlQueryCache::getTables(statement, &tables)) {
+            transactionTables_.insert(tables.begin(), tables.end());
+        } else {
+            transactionClearsCache_ = true;
+        }
+        return;
+    }
+
+    // If a transaction just ended, e.g. with COMMIT or ROLLBACK, then other
+    // connections might have cached its tables' old rows
+    if (transactionClearsCache_) {
+        queryCache_->clear();
+    } else {
+        for (const auto& table : transactionTables_) {
+            queryCache_->invalidateTable(table);
+        }
+    }
+    transactionTables_.clear();
+    transactionClearsCache_ = false;
+}
+
+
+bool MySql::reconnectIfLost(
+    const MySqlPreparedStatement* const statement
+) const {
+    return isConnectionLost(statement) && reconnect();
+}
+
+
+MySql::MySql(MySql&& rhs) noexcept
+    : hostname_(move(rhs.hostname_))
+    , username_(move(rhs.username_))
+    , password_(move(rhs.password_))
+    , database_(move(rhs.database_))
+    , port_(rhs.port_)
+    , options_(move(rhs.options_))
+    , connection_(move(rhs.connection_))
+    , queryCache_(move(rhs.queryCache_))
+    , transactionTables_(move(rhs.transactionTables_))
+    , transactionClearsCache_(rhs.transactionClearsCache_)
+    , cachedStatements_(move(rhs.cachedStatements_))
+{
+}
+
+
+MySql& MySql::operator=(MySql&& rhs) noexcept {
+    if (this != &rhs) {
+        close();
+        hostname_ = move(rhs.hostname_);
+        username_ = move(rhs.username_);
+        password_ = move(rhs.password_);
+        database_ = move(rhs.database_);
+        port_ = rhs.port_;
+        options_ = move(rhs.options_);
+        connection_ = move(rhs.connection_);
+        queryCache_ = move(rhs.queryCache_);
+        transactionTables_ = move(rhs.transactionTables_);
+        transactionClearsCache_ = rhs.transactionClearsCache_;
+        cachedStatements_ = move(rhs.cachedStatements_);
+    }
+    return *this;
 }
 
 
 MySql::~MySql() {
-    mysql_close(connection_);
+    close();
+}
+
+
+void MySql::close() {
+    if (nullptr == connection_) {
+        return;
+    }
+    cachedStatements_.clear();
+    mysql_close(connection_->handle);
+    // Statements that outlive this throw instead of using the closed handle
+    connection_->handle = nullptr;
+    ++connection_->generation;
+    connection_.reset();
 }
 
 
 my_ulonglong MySql::runCommand(const char* const command) {
-    if (0 != mysql_real_query(connection_, command, strlen(command))) {
-        throw MySqlException(connection_);
+    MYSQL* const connection = connection_->handle;
+    if (0 != mysql_real_query(connection, command, strlen(command))) {
+        const MySqlException exception(connection);
+        reconnectIfLost(nullptr);
+        throw exception;
     }
 
     // If the user ran a SELECT statement or something else, at least warn them
-    const my_ulonglong affectedRows = mysql_affected_rows(connection_);
+    const my_ulonglong affectedRows = mysql_affected_rows(connection);
     if ((my_ulonglong) - 1 == affectedRows) {
         // Clean up after the query
-        MYSQL_RES* const result = mysql_store_result(connection_);
+        MYSQL_RES* const result = mysql_store_result(connection);
         mysql_free_result(result);
 
         throw MySqlException("Tried to run query with runCommand");
     }
 
+    invalidateCachedTables(command);
+
     return affectedRows;
 }
 
 
+my_ulonglong MySql::runBoundCommand(
+    const MySqlPreparedStatement& statement,
+    vector<MYSQL_BIND>* const bindParameters
+) {
+    my_ulonglong affectedRows = 0;
+    const MySqlError error(
+        tryRunBoundCommand(statement, bindParameters, &affectedRows));
+    if (error) {
+        throw error.toException();
+    }
+    return affectedRows;
+}
+
+
+MySqlError MySql::tryRunBoundCommand(
+    const MySqlPreparedStatement& statement,
+    vector<MYSQL_BIND>* const bindParameters,
+    my_ulonglong* const affectedRows
+) {
+    assert(nullptr != bindParameters);
+    assert(nullptr != affectedRows);
+    statement.prepareIfReconnected();
+    if (0 != mysql_stmt_bind_param(
+        statement.statementHandle_,
+        bindParameters->data())
+    ) {
+        throw MySqlException(statement);
+    }
+
+    if (0 != mysql_stmt_execute(statement.statementHandle_)) {
+        // The command may have been applied before the connection was lost,
+        // so it's not run again
+        MySqlError error(statement);
+        if (isConnectionLost(&statement)) {
+            error.saveMessage();
+            reconnect();
+        }
+        return error;
+    }
+
+    // If the user ran a SELECT statement or something else, at least warn them
+    *affectedRows = mysql_stmt_affected_rows(statement.statementHandle_);
+    if (static_cast<my_ulonglong>(-1) == *affectedRows) {
+        throw MySqlException("Tried to run query with runCommand");
+    }
+
+    invalidateCachedTables(statement.getQuery().c_str());
+
+    return MySqlError();
+}
+
+
+my_ulonglong MySql::runCommand(const MySqlPreparedStatement& statement) {
+    return runCommand<>(statement);
+}
+
+
+void MySql::cacheStatement(const char* const query) {
+    assert(nullptr != query);
+    if (cachedStatements_.end() != cachedStatements_.find(query)) {
+        return;
+    }
+    cachedStatements_.emplace(query, prepareStatement(query));
+}
+
+
+size_t MySql::getCachedStatementCount() const {
+    return cachedStatements_.size();
+}
+
+
+void MySql::setQueryCache(shared_ptr<MySqlQueryCache> cache) {
+    queryCache_ = move(cache);
+}
+
+
 MySqlPreparedStatement MySql::prepareStatement(const char* const command) const {
-    return MySqlPreparedStatement(command, connection_);
+    try {
+        return MySqlPreparedStatement(command, connection_);
+    } catch (const MySqlException&) {
+        if (!reconnectIfLost(nullptr)) {
+            throw;
+        }
+        return MySqlPreparedStatement(command, connection_);
+    }
 }
@@ -2,20 +2,28 @@
 #define MYSQL_HPP_
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <mysql/mysql.h>
 
 #include <boost/lexical_cast.hpp>
+#include <memory>
 #include <string>
 #include <tuple>
 #include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "InputBinder.hpp"
+#include "MySqlError.hpp"
 #include "MySqlException.hpp"
+#include "MySqlExportSink.hpp"
+#include "MySqlOptions.hpp"
 #include "MySqlPreparedStatement.hpp"
+#include "MySqlQueryCache.hpp"
 #include "OutputBinder.hpp"
 
 #if __GNUC__ < 4 || (__GNUC__ == 4 && __GNUC_MINOR__ < 6)
@@ -25,7 +33,22 @@
 #endif
 #endif
 
-
+template <typename... Args> class MySqlArrowBatch;
+
+
+/**
+ * A connection to a MySQL server. If reconnecting is enabled in MySqlOptions,
+ * a lost connection is opened again the next time it fails. Queries that
+ * failed because the connection was lost are run once more on the new
+ * connection, unless a transaction was open. Commands are never run again,
+ * because the server may have applied them before the connection was lost,
+ * so they still throw. Session state, like open transactions, temporary
+ * tables and session variables, doesn't survive reconnecting.
+ *
+ * Connections can be moved, e.g. into containers or out of factories. A
+ * moved-from MySql can only be destroyed or assigned to. Statements prepared
+ * on a connection keep working after it's moved.
+ */
 class MySql {
     public:
         MySql(
@@ -41,12 +64,24 @@ class MySql {
             const char* password,
             const uint16_t port = 3306);
 
+        /**
+         * Connects after applying the given options, e.g. compression or
+         * timeouts. The database may be nullptr.
+         */
+        MySql(
+            const char* const hostname,
+            const char* const username,
+            const char* const password,
+            const char* const database,
+            const MySqlOptions& options,
+            const uint16_t port = 3306);
+
         ~MySql();
 
         MySql(const MySql& rhs) = delete;
-        MySql(MySql&& rhs) = delete;
+        MySql(MySql&& rhs) noexcept;
         MySql& operator=(const MySql& rhs) = delete;
-        MySql& operator=(MySql&& rhs) = delete;
+        MySql& operator=(MySql&& rhs) noexcept;
 
         /**
          * Normal query. Results are stored in the given vector.
@@ -63,6 +98,33 @@ class MySql {
             // can be bound to MySQL's prepared statement API
             const InputArgs&... args) const;
 
+        /**
+         * Query whose results are shared through the query cache, if one has
+         * been set. Repeated queries with the same parameters and result type
+         * return the same immutable results without a round trip until the
+         * entry expires or a command on this connection writes to one of the
+         * tables that the query reads. Writes in a transaction invalidate
+         * the tables again when it commits or rolls back, and queries inside
+         * a transaction don't use the cache. Without a cache, this just runs
+         * the query.
+         * @param results Set to the shared results.
+         * @param query The query to run.
+         * @param args Arguments to bind to the query.
+         */
+        template <typename... InputArgs, typename... OutputArgs>
+        void runCachedQuery(
+            std::shared_ptr<const std::vector<std::tuple<OutputArgs...>>>*
+                const results,
+            const char* const query,
+            const InputArgs&... args) const;
+
+        /**
+         * Sets the cache used by runCachedQuery and invalidated by
+         * runCommand. The cache may be shared with other connections, and
+         * may be nullptr to stop caching.
+         */
+        void setQueryCache(std::shared_ptr<MySqlQueryCache> cache);
+
         /**
          * Command that doesn't return results, like "USE yelp" or
          * "INSERT INTO user VALUES ('Brandon', 28)".
@@ -90,6 +152,17 @@ class MySql {
          */
         MySqlPreparedStatement prepareStatement(const char* statement) const;
 
+        /**
+         * Prepares a statement and keeps it for the life of the connection.
+         * Afterward, runQuery, runScalar, runExists, runCommand,
+         * runMultiRowCommand and runExport use the kept statement when
+         * they're given the same query text instead of preparing it again.
+         * Preparing statements ahead of time, e.g. with MySqlConnectionWarmer,
+         * saves the first request a round trip.
+         */
+        void cacheStatement(const char* query);
+        size_t getCachedStatementCount() const;
+
         /**
          * Run the command version of a prepared statement.
          */
@@ -101,6 +174,25 @@ class MySql {
         my_ulonglong runCommand(const MySqlPreparedStatement& statement);
         /// @}
 
+        /**
+         * Runs a command once with every row's values bound in order, e.g. a
+         * multi-row INSERT with one "(?, ?)" group per row. This is much
+         * faster than running the command once per row.
+         * @param rows The rows to bind. The rows need to have as many values
+         *     between them as the command has parameters.
+         * @return The number of affected rows.
+         */
+        /// @{
+        template <typename... Args>
+        my_ulonglong runMultiRowCommand(
+            const char* const command,
+            const std::vector<std::tuple<Args...>>& rows);
+        template <typename... Args>
+        my_ulonglong runMultiRowCommand(
+            const MySqlPreparedStatement& statement,
+            const std::vector<std::tuple<Args...>>& rows);
+        /// @}
+
         /**
          * Run the query version of a prepared statement.
          */
@@ -110,8 +202,274 @@ class MySql {
             const MySqlPreparedStatement& statement,
             const InputArgs&...) const;
 
+        /**
+         * Query whose rows are written to an output iterator instead of a
+         * vector, e.g. a std::back_inserter for a std::deque, a pointer into
+         * a preallocated array, or a MySqlRowSink that hands each row to a
+         * function. The output types can't be deduced from the iterator, so
+         * they need to be given:
+         *
+         *     connection.runQueryInto<int, string>(
+         *         std::back_inserter(users),
+         *         "SELECT id, name FROM user");
+         *
+         * Rows are written as they're fetched, so the query isn't run again
+         * if the connection is lost.
+         * @return The iterator past the last row.
+         */
+        /// @{
+        template <
+            typename... OutputArgs,
+            typename OutputIterator,
+            typename... InputArgs>
+        OutputIterator runQueryInto(
+            OutputIterator output,
+            const char* const query,
+            const InputArgs&... args) const;
+        template <
+            typename... OutputArgs,
+            typename OutputIterator,
+            typename... InputArgs>
+        OutputIterator runQueryInto(
+            OutputIterator output,
+            const MySqlPreparedStatement& statement,
+            const InputArgs&... args) const;
+        /// @}
+
+        /**
+         * Query that calls function with each row's columns instead of
+         * storing the rows. The column types are the types of function's
+         * parameters, and numbers and MySqlStringRef parameters refer
+         * straight to the fetched data, so no tuples or strings are built:
+         *
+         *     int64_t total = 0;
+         *     connection.forEachRow(
+         *         "SELECT name, age FROM user",
+         *         [&](MySqlStringRef name, const int32_t& age) {
+         *             total += age;
+         *         });
+         *
+         * If function's only parameter is a MySqlLazyRow, its columns are
+         * only converted when they're read. See MySqlLazyRow.hpp.
+         *
+         * References are only valid during the call. Rows are handled as
+         * they're fetched, so the query isn't run again if the connection is
+         * lost.
+         * @return The number of rows.
+         */
+        /// @{
+        template <typename Function, typename... InputArgs>
+        my_ulonglong forEachRow(
+            const char* const query,
+            Function function,
+            const InputArgs&... args) const;
+        template <typename Function, typename... InputArgs>
+        my_ulonglong forEachRow(
+            const MySqlPreparedStatement& statement,
+            Function function,
+            const InputArgs&... args) const;
+        /// @}
+
+        /**
+         * Query for a single value, e.g. "SELECT COUNT(*) FROM user", that
+         * skips storing the results in a vector of tuples. Only the first
+         * row is read and the rest are discarded.
+         * @param value Set to the only column of the first row. NULLs need
+         *     a std::shared_ptr or std::unique_ptr, like in runQuery.
+         * @param query The query to run.
+         * @param args Arguments to bind to the query.
+         * @return If there was a row. If not, value isn't changed.
+         */
+        /// @{
+        template <typename T, typename... InputArgs>
+        bool runScalar(
+            T* const value,
+            const char* const query,
+            const InputArgs&... args) const;
+        template <typename T, typename... InputArgs>
+        bool runScalar(
+            T* const value,
+            const MySqlPreparedStatement& statement,
+            const InputArgs&... args) const;
+        /// @}
+
+        /**
+         * Returns if the query has any rows, without copying any values.
+         * Only the first row is read and the rest are discarded, but the
+         * server still sends them, so add LIMIT 1 to large queries.
+         */
+        /// @{
+        template <typename... InputArgs>
+        bool runExists(
+            const char* const query,
+            const InputArgs&... args) const;
+        template <typename... InputArgs>
+        bool runExists(
+            const MySqlPreparedStatement& statement,
+            const InputArgs&... args) const;
+        /// @}
+
+        /**
+         * Query whose results are appended to Arrow columnar buffers. See
+         * MySqlArrow.hpp.
+         * @param batch The batch to append the results to.
+         * @param query The query to run.
+         * @param args Arguments to bind to the query.
+         */
+        template <typename... InputArgs, typename... OutputArgs>
+        void runQuery(
+            MySqlArrowBatch<OutputArgs...>* const batch,
+            const char* const query,
+            const InputArgs&... args) const;
+
+        /**
+         * Runs a query and writes the results to sink as they are fetched,
+         * without storing them, e.g. to dump a table to a CSV file.
+         * @param sink Where to write the results.
+         * @param query The query to run.
+         * @param args Arguments to bind to the query.
+         * @return The number of rows written.
+         */
+        template <typename... InputArgs>
+        my_ulonglong runExport(
+            MySqlExportSink* const sink,
+            const char* const query,
+            const InputArgs&... args) const;
+
+        /**
+         * Versions of runCommand and runQuery that return errors from the
+         * server, like duplicate keys, instead of throwing them, for loops
+         * where such errors are expected. Mistakes like the wrong number of
+         * parameters still throw, and so does preparing query text that
+         * hasn't been cached, e.g. with a syntax error.
+         * @return The number of affected rows, or for queries, the number of
+         *     rows appended to results. Rows from a failed query aren't
+         *     kept.
+         */
+        /// @{
+        template <typename... Args>
+        MySqlExpected<my_ulonglong> tryRunCommand(
+            const char* const command,
+            const Args&... args);
+        template <typename... Args>
+        MySqlExpected<my_ulonglong> tryRunCommand(
+            const MySqlPreparedStatement& statement,
+            const Args&... args);
+        template <typename... InputArgs, typename... OutputArgs>
+        MySqlExpected<size_t> tryRunQuery(
+            std::vector<std::tuple<OutputArgs...>>* const results,
+            const char* const query,
+            const InputArgs&... args) const;
+        template <typename... InputArgs, typename... OutputArgs>
+        MySqlExpected<size_t> tryRunQuery(
+            std::vector<std::tuple<OutputArgs...>>* const results,
+            const MySqlPreparedStatement& statement,
+            const InputArgs&... args) const;
+        /// @}
+
     private:
-        MYSQL* connection_;
+        // Needs the raw connection to install its LOAD DATA handlers
+        friend class MySqlBulkLoader;
+
+        /**
+         * Reconnects if the last error on the connection, or on statement if
+         * given, was a lost connection and reconnecting is enabled.
+         * @return If the connection was opened again and the failed query
+         *     can be run again, i.e. no transaction was open.
+         */
+        bool reconnectIfLost(const MySqlPreparedStatement* statement) const;
+        /**
+         * The two halves of reconnectIfLost.
+         */
+        /// @{
+        bool isConnectionLost(const MySqlPreparedStatement* statement) const;
+        bool reconnect() const;
+        /// @}
+
+        bool isInTransaction() const;
+        /**
+         * Invalidates the query cache entries for the tables that statement
+         * wrote to. Inside a transaction, other connections can cache the
+         * old rows until it commits, so the tables are remembered and
+         * invalidated again once the transaction ends.
+         */
+        void invalidateCachedTables(const char* statement);
+
+        /**
+         * Runs query, and if it failed because the connection was lost,
+         * reconnects and runs it once more.
+         */
+        template <typename Query>
+        void retryIfReconnected(
+            const MySqlPreparedStatement* statement,
+            const Query& query) const;
+
+        /**
+         * Calls function with the cached statement for query, or with a newly
+         * prepared one if query hasn't been cached.
+         */
+        template <typename Function>
+        auto withStatement(const char* query, const Function& function) const
+            -> decltype(function(
+                std::declval<const MySqlPreparedStatement&>()));
+
+        /**
+         * Executes a command whose parameters have already been bound.
+         */
+        my_ulonglong runBoundCommand(
+            const MySqlPreparedStatement& statement,
+            std::vector<MYSQL_BIND>* bindParameters);
+        MySqlError tryRunBoundCommand(
+            const MySqlPreparedStatement& statement,
+            std::vector<MYSQL_BIND>* bindParameters,
+            my_ulonglong* affectedRows);
+
+        /**
+         * Checks that a command doesn't return results and binds its
+         * parameters.
+         */
+        template <typename... Args>
+        static void bindCommandInputs(
+            const MySqlPreparedStatement& statement,
+            std::vector<MYSQL_BIND>* bindParameters,
+            const Args&... args);
+
+        /**
+         * Checks that a query returns results and binds its input
+         * parameters.
+         * @param bindParameters Set to the bound parameters, which the
+         *     statement refers to until it's executed.
+         */
+        template <typename... InputArgs>
+        static void bindQueryInputs(
+            const MySqlPreparedStatement& statement,
+            std::vector<MYSQL_BIND>* bindParameters,
+            const InputArgs&... args);
+
+        /**
+         * Opens a new connection with the saved parameters.
+         */
+        MYSQL* connect() const;
+        /**
+         * Closes the connection, if this hasn't been moved from.
+         */
+        void close();
+
+        // Saved so that lost connections can be opened again
+        std::string hostname_;
+        std::string username_;
+        std::string password_;
+        std::string database_;
+        uint16_t port_;
+        MySqlOptions options_;
+        std::shared_ptr<MySqlConnectionState> connection_;
+        std::shared_ptr<MySqlQueryCache> queryCache_;
+        // Written in the open transaction, to invalidate when it ends
+        std::unordered_set<std::string> transactionTables_;
+        // If the open transaction ran a statement whose tables are unknown
+        bool transactionClearsCache_;
+        std::unordered_map<std::string, MySqlPreparedStatement>
+            cachedStatements_;
 };
 
 
@@ -120,8 +478,11 @@ my_ulonglong MySql::runCommand(
     const char* const command,
     const Args&... args
 ) {
-    MySqlPreparedStatement statement(prepareStatement(command));
-    return runCommand(statement, args...);
+    return withStatement(
+        command,
+        [&](const MySqlPreparedStatement& statement) {
+            return runCommand(statement, args...);
+        });
 }
 
 
@@ -129,6 +490,53 @@ template <typename... Args>
 my_ulonglong MySql::runCommand(
     const MySqlPreparedStatement& statement,
     const Args&... args
+) {
+    std::vector<MYSQL_BIND> bindParameters;
+    bindCommandInputs(statement, &bindParameters, args...);
+    return runBoundCommand(statement, &bindParameters);
+}
+
+
+template <typename... Args>
+MySqlExpected<my_ulonglong> MySql::tryRunCommand(
+    const char* const command,
+    const Args&... args
+) {
+    return withStatement(
+        command,
+        [&](const MySqlPreparedStatement& statement) {
+            MySqlExpected<my_ulonglong> result(
+                tryRunCommand(statement, args...));
+            // The statement is closed when this returns if it isn't cached,
+            // so the message can't be read from it later
+            result.getError().saveMessage();
+            return result;
+        });
+}
+
+
+template <typename... Args>
+MySqlExpected<my_ulonglong> MySql::tryRunCommand(
+    const MySqlPreparedStatement& statement,
+    const Args&... args
+) {
+    std::vector<MYSQL_BIND> bindParameters;
+    bindCommandInputs(statement, &bindParameters, args...);
+    my_ulonglong affectedRows = 0;
+    MySqlError error(
+        tryRunBoundCommand(statement, &bindParameters, &affectedRows));
+    if (error) {
+        return MySqlExpected<my_ulonglong>(std::move(error));
+    }
+    return MySqlExpected<my_ulonglong>(affectedRows);
+}
+
+
+template <typename... Args>
+void MySql::bindCommandInputs(
+    const MySqlPreparedStatement& statement,
+    std::vector<MYSQL_BIND>* const bindParameters,
+    const Args&... args
 ) {
     // Commands (e.g. INSERTs or DELETEs) should always have this set to 0
     if (0 != statement.getFieldCount()) {
@@ -146,51 +554,392 @@ my_ulonglong MySql::runCommand(
         throw MySqlException(errorMessage);
     }
 
+    bindParameters->resize(statement.getParameterCount());
+    bindInputs<Args...>(bindParameters, args...);
+}
+
+
+template <typename... Args>
+my_ulonglong MySql::runMultiRowCommand(
+    const char* const command,
+    const std::vector<std::tuple<Args...>>& rows
+) {
+    return withStatement(
+        command,
+        [&](const MySqlPreparedStatement& statement) {
+            return runMultiRowCommand(statement, rows);
+        });
+}
+
+
+template <typename... Args>
+my_ulonglong MySql::runMultiRowCommand(
+    const MySqlPreparedStatement& statement,
+    const std::vector<std::tuple<Args...>>& rows
+) {
+    // Commands (e.g. INSERTs or DELETEs) should always have this set to 0
+    if (0 != statement.getFieldCount()) {
+        throw MySqlException("Tried to run query with runCommand");
+    }
+
+    const size_t parameterCount = rows.size() * sizeof...(Args);
+    if (parameterCount != statement.getParameterCount()) {
+        std::string errorMessage;
+        errorMessage += "Incorrect number of parameters; command required ";
+        errorMessage += boost::lexical_cast<std::string>(
+            statement.getParameterCount());
+        errorMessage += " but ";
+        errorMessage += boost::lexical_cast<std::string>(parameterCount);
+        errorMessage += " parameters were provided.";
+        throw MySqlException(errorMessage);
+    }
+
     std::vector<MYSQL_BIND> bindParameters;
-    bindParameters.resize(statement.getParameterCount());
-    bindInputs<Args...>(&bindParameters, args...);
-    if (0 != mysql_stmt_bind_param(
-        statement.statementHandle_,
-        bindParameters.data())
-    ) {
-        throw MySqlException(statement);
+    bindParameters.resize(parameterCount);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        bindInputTuple(&bindParameters, i * sizeof...(Args), rows[i]);
     }
+    return runBoundCommand(statement, &bindParameters);
+}
 
-    if (0 != mysql_stmt_execute(statement.statementHandle_)) {
-        throw MySqlException(statement);
+
+template <typename... InputArgs, typename... OutputArgs>
+void MySql::runQuery(
+    std::vector<std::tuple<OutputArgs...>>* const results,
+    const char* const query,
+    const InputArgs&... args
+) const {
+    assert(nullptr != results);
+    assert(nullptr != query);
+    withStatement(query, [&](const MySqlPreparedStatement& statement) {
+        runQuery(results, statement, args...);
+    });
+}
+
+
+template <typename... InputArgs, typename... OutputArgs>
+void MySql::runCachedQuery(
+    std::shared_ptr<const std::vector<std::tuple<OutputArgs...>>>* const
+        results,
+    const char* const query,
+    const InputArgs&... args
+) const {
+    assert(nullptr != results);
+    assert(nullptr != query);
+    // Inside a transaction, the results can include uncommitted writes that
+    // might be rolled back, and cached results can be missing this
+    // transaction's writes, so skip the cache
+    const bool useCache = nullptr != queryCache_ && !isInTransaction();
+    if (useCache && queryCache_->get(results, query, args...)) {
+        return;
     }
 
-    // If the user ran a SELECT statement or something else, at least warn them
-    const auto affectedRows = mysql_stmt_affected_rows(
-        statement.statementHandle_);
-    if ((static_cast<decltype(affectedRows)>(-1)) == affectedRows) {
-        throw MySqlException("Tried to run query with runCommand");
+    // Take the snapshot before running the query, so that the results
+    // aren't cached if another connection writes to the tables meanwhile
+    MySqlQueryCache::Snapshot snapshot;
+    if (useCache) {
+        snapshot = queryCache_->getSnapshot(query);
+    }
+    std::shared_ptr<std::vector<std::tuple<OutputArgs...>>> newResults(
+        new std::vector<std::tuple<OutputArgs...>>());
+    runQuery(newResults.get(), query, args...);
+    if (useCache) {
+        queryCache_->put(
+            std::shared_ptr<const std::vector<std::tuple<OutputArgs...>>>(
+                newResults),
+            snapshot,
+            query,
+            args...);
     }
+    *results = std::move(newResults);
+}
 
-    return affectedRows;
+
+template <typename... InputArgs, typename... OutputArgs>
+void MySql::runQuery(
+    std::vector<std::tuple<OutputArgs...>>* const results,
+    const MySqlPreparedStatement& statement,
+    const InputArgs&... args
+) const {
+    assert(nullptr != results);
+    const size_t originalSize = results->size();
+    retryIfReconnected(&statement, [&]() {
+        // Drop any rows that were fetched before the connection was lost
+        results->erase(
+            results->begin() + static_cast<std::ptrdiff_t>(originalSize),
+            results->end());
+        std::vector<MYSQL_BIND> inputBindParameters;
+        bindQueryInputs(statement, &inputBindParameters, args...);
+        setResults<OutputArgs...>(statement, results);
+    });
+}
+
+
+template <
+    typename... OutputArgs,
+    typename OutputIterator,
+    typename... InputArgs>
+OutputIterator MySql::runQueryInto(
+    OutputIterator output,
+    const char* const query,
+    const InputArgs&... args
+) const {
+    assert(nullptr != query);
+    return withStatement(query, [&](const MySqlPreparedStatement& statement) {
+        return runQueryInto<OutputArgs...>(output, statement, args...);
+    });
+}
+
+
+template <
+    typename... OutputArgs,
+    typename OutputIterator,
+    typename... InputArgs>
+OutputIterator MySql::runQueryInto(
+    OutputIterator output,
+    const MySqlPreparedStatement& statement,
+    const InputArgs&... args
+) const {
+    // Rows may already have been written when the connection is lost, so
+    // this isn't run again
+    try {
+        std::vector<MYSQL_BIND> inputBindParameters;
+        bindQueryInputs(statement, &inputBindParameters, args...);
+        return copyResults<OutputArgs...>(statement, output);
+    } catch (const MySqlException&) {
+        reconnectIfLost(&statement);
+        throw;
+    }
+}
+
+
+template <typename Function, typename... InputArgs>
+my_ulonglong MySql::forEachRow(
+    const char* const query,
+    Function function,
+    const InputArgs&... args
+) const {
+    assert(nullptr != query);
+    return withStatement(query, [&](const MySqlPreparedStatement& statement) {
+        return forEachRow(statement, std::move(function), args...);
+    });
+}
+
+
+template <typename Function, typename... InputArgs>
+my_ulonglong MySql::forEachRow(
+    const MySqlPreparedStatement& statement,
+    Function function,
+    const InputArgs&... args
+) const {
+    // Rows may already have been handled when the connection is lost, so
+    // this isn't run again
+    try {
+        std::vector<MYSQL_BIND> inputBindParameters;
+        bindQueryInputs(statement, &inputBindParameters, args...);
+        return visitResults(statement, &function);
+    } catch (const MySqlException&) {
+        reconnectIfLost(&statement);
+        throw;
+    }
+}
+
+
+template <typename T, typename... InputArgs>
+bool MySql::runScalar(
+    T* const value,
+    const char* const query,
+    const InputArgs&... args
+) const {
+    assert(nullptr != value);
+    assert(nullptr != query);
+    return withStatement(query, [&](const MySqlPreparedStatement& statement) {
+        return runScalar(value, statement, args...);
+    });
+}
+
+
+template <typename T, typename... InputArgs>
+bool MySql::runScalar(
+    T* const value,
+    const MySqlPreparedStatement& statement,
+    const InputArgs&... args
+) const {
+    assert(nullptr != value);
+    bool found = false;
+    retryIfReconnected(&statement, [&]() {
+        std::vector<MYSQL_BIND> inputBindParameters;
+        bindQueryInputs(statement, &inputBindParameters, args...);
+        found = setScalarResult(statement, value);
+    });
+    return found;
+}
+
+
+template <typename... InputArgs>
+bool MySql::runExists(
+    const char* const query,
+    const InputArgs&... args
+) const {
+    assert(nullptr != query);
+    return withStatement(query, [&](const MySqlPreparedStatement& statement) {
+        return runExists(statement, args...);
+    });
+}
+
+
+template <typename... InputArgs>
+bool MySql::runExists(
+    const MySqlPreparedStatement& statement,
+    const InputArgs&... args
+) const {
+    bool exists = false;
+    retryIfReconnected(&statement, [&]() {
+        std::vector<MYSQL_BIND> inputBindParameters;
+        bindQueryInputs(statement, &inputBindParameters, args...);
+        exists = hasResults(statement);
+    });
+    return exists;
 }
 
 
 template <typename... InputArgs, typename... OutputArgs>
 void MySql::runQuery(
+    MySqlArrowBatch<OutputArgs...>* const batch,
+    const char* const query,
+    const InputArgs&... args
+) const {
+    assert(nullptr != batch);
+    withStatement(query, [&](const MySqlPreparedStatement& statement) {
+        // Rows may already have been appended when the connection is lost,
+        // so this isn't run again
+        try {
+            std::vector<MYSQL_BIND> inputBindParameters;
+            bindQueryInputs(statement, &inputBindParameters, args...);
+            batch->appendResults(statement);
+        } catch (const MySqlException&) {
+            reconnectIfLost(&statement);
+            throw;
+        }
+    });
+}
+
+
+template <typename... InputArgs>
+my_ulonglong MySql::runExport(
+    MySqlExportSink* const sink,
+    const char* const query,
+    const InputArgs&... args
+) const {
+    assert(nullptr != sink);
+    return withStatement(
+        query,
+        [&](const MySqlPreparedStatement& statement) {
+            // Rows may already have been written when the connection is
+            // lost, so this isn't run again
+            try {
+                std::vector<MYSQL_BIND> inputBindParameters;
+                bindQueryInputs(statement, &inputBindParameters, args...);
+                return sink->writeResults(statement);
+            } catch (const MySqlException&) {
+                reconnectIfLost(&statement);
+                throw;
+            }
+        });
+}
+
+
+template <typename... InputArgs, typename... OutputArgs>
+MySqlExpected<size_t> MySql::tryRunQuery(
     std::vector<std::tuple<OutputArgs...>>* const results,
     const char* const query,
     const InputArgs&... args
 ) const {
     assert(nullptr != results);
     assert(nullptr != query);
-    MySqlPreparedStatement statement(prepareStatement(query));
-    runQuery(results, statement, args...);
+    return withStatement(
+        query,
+        [&](const MySqlPreparedStatement& statement) {
+            MySqlExpected<size_t> result(
+                tryRunQuery(results, statement, args...));
+            // The statement is closed when this returns if it isn't cached,
+            // so the message can't be read from it later
+            result.getError().saveMessage();
+            return result;
+        });
 }
 
 
 template <typename... InputArgs, typename... OutputArgs>
-void MySql::runQuery(
+MySqlExpected<size_t> MySql::tryRunQuery(
     std::vector<std::tuple<OutputArgs...>>* const results,
     const MySqlPreparedStatement& statement,
     const InputArgs&... args
 ) const {
     assert(nullptr != results);
+    const size_t originalSize = results->size();
+    for (int attempt = 0; ; ++attempt) {
+        std::vector<MYSQL_BIND> inputBindParameters;
+        bindQueryInputs(statement, &inputBindParameters, args...);
+        if (trySetResults(statement, results)) {
+            return MySqlExpected<size_t>(results->size() - originalSize);
+        }
+
+        MySqlError error(statement);
+        // Drop any rows that were fetched before the error
+        results->erase(
+            results->begin() + static_cast<std::ptrdiff_t>(originalSize),
+            results->end());
+        if (0 == attempt && isConnectionLost(&statement)) {
+            error.saveMessage();
+            if (reconnect()) {
+                continue;
+            }
+        }
+        return MySqlExpected<size_t>(std::move(error));
+    }
+}
+
+
+template <typename Function>
+auto MySql::withStatement(
+    const char* const query,
+    const Function& function
+) const -> decltype(function(std::declval<const MySqlPreparedStatement&>())) {
+    if (!cachedStatements_.empty()) {
+        const auto cached = cachedStatements_.find(query);
+        if (cachedStatements_.end() != cached) {
+            return function(cached->second);
+        }
+    }
+    const MySqlPreparedStatement statement(prepareStatement(query));
+    return function(statement);
+}
+
+
+template <typename Query>
+void MySql::retryIfReconnected(
+    const MySqlPreparedStatement* const statement,
+    const Query& query
+) const {
+    try {
+        query();
+    } catch (const MySqlException&) {
+        if (!reconnectIfLost(statement)) {
+            throw;
+        }
+        query();
+    }
+}
+
+
+template <typename... InputArgs>
+void MySql::bindQueryInputs(
+    const MySqlPreparedStatement& statement,
+    std::vector<MYSQL_BIND>* const inputBindParameters,
+    const InputArgs&... args
+) {
+    statement.prepareIfReconnected();
 
     // SELECTs should always return something. Commands (e.g. INSERTs or
     // DELETEs) should always have this set to 0.
@@ -212,17 +961,14 @@ void MySql::runQuery(
         throw MySqlException(errorMessage);
     }
 
-    std::vector<MYSQL_BIND> inputBindParameters;
-    inputBindParameters.resize(statement.getParameterCount());
-    bindInputs<InputArgs...>(&inputBindParameters, args...);
+    inputBindParameters->resize(statement.getParameterCount());
+    bindInputs<InputArgs...>(inputBindParameters, args...);
     if (0 != mysql_stmt_bind_param(
         statement.statementHandle_,
-        inputBindParameters.data())
+        inputBindParameters->data())
     ) {
         throw MySqlException(statement);
     }
-
-    setResults<OutputArgs...>(statement, results);
 }
 
 
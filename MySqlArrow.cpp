@@ -0,0 +1,322 @@
+#include "MySqlArrow.hpp"
+#include "MySqlException.hpp"
+#include "MySqlPreparedStatement.hpp"
+#include "OutputBinder.hpp"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <mysql/mysql.h>
+
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using MySqlArrowPrivate::AlignedBuffer;
+using MySqlArrowPrivate::ColumnBuffers;
+using MySqlArrowPrivate::Columns;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// Arrow recommends this alignment and padding so that buffers can be read
+// with the widest SIMD instructions
+static const size_t ALIGNMENT = 64;
+
+
+AlignedBuffer::AlignedBuffer()
+    : data_(nullptr)
+    , size_(0)
+    , capacity_(0)
+{
+    // Arrow consumers expect buffers to exist even when they're empty
+    reserve(ALIGNMENT);
+}
+
+
+AlignedBuffer::~AlignedBuffer() {
+    std::free(data_);
+}
+
+
+void AlignedBuffer::append(const void* const data, const size_t length) {
+    reserve(size_ + length);
+    std::memcpy(data_ + size_, data, length);
+    size_ += length;
+}
+
+
+void AlignedBuffer::appendZeros(const size_t length) {
+    reserve(size_ + length);
+    std::memset(data_ + size_, 0, length);
+    size_ += length;
+}
+
+
+uint8_t* AlignedBuffer::getData() {
+    return data_;
+}
+
+
+const uint8_t* AlignedBuffer::getData() const {
+    return data_;
+}
+
+
+size_t AlignedBuffer::getSize() const {
+    return size_;
+}
+
+
+void AlignedBuffer::reserve(const size_t capacity) {
+    if (capacity <= capacity_) {
+        return;
+    }
+    size_t newCapacity = capacity_ < ALIGNMENT ? ALIGNMENT : capacity_ * 2;
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+    void* newData = nullptr;
+    if (0 != posix_memalign(&newData, ALIGNMENT, newCapacity)) {
+        throw std::bad_alloc();
+    }
+    if (nullptr != data_) {
+        std::memcpy(newData, data_, size_);
+    }
+    // Zero the padding, so that consumers never read uninitialized memory
+    std::memset(
+        static_cast<uint8_t*>(newData) + size_,
+        0,
+        newCapacity - size_);
+    std::free(data_);
+    data_ = static_cast<uint8_t*>(newData);
+    capacity_ = newCapacity;
+}
+
+
+ColumnBuffers::ColumnBuffers(const char* const format, const bool nullable)
+    : name_()
+    , format_(format)
+    , nullable_(nullable)
+    , nullCount_(0)
+    , validity_()
+    , values_()
+    , data_()
+{
+}
+
+
+void ColumnBuffers::appendValidity(const bool valid, const size_t row) {
+    if (0 == row % 8) {
+        validity_.appendZeros(1);
+    }
+    if (valid) {
+        validity_.getData()[row / 8] = static_cast<uint8_t>(
+            validity_.getData()[row / 8] | (1 << (row % 8)));
+    } else {
+        ++nullCount_;
+    }
+}
+
+
+void MySqlArrowPrivate::setColumnNames(
+    const MySqlPreparedStatement& statement,
+    Columns* const columns
+) {
+    assert(nullptr != columns);
+    MYSQL_RES* const metadata =
+        OutputBinderPrivate::Friend::getResultMetadata(statement);
+    const unsigned int fieldCount = mysql_num_fields(metadata);
+    const MYSQL_FIELD* const fields = mysql_fetch_fields(metadata);
+    for (size_t i = 0; i < columns->size() && i < fieldCount; ++i) {
+        columns->at(i)->name_ = fields[i].name;
+    }
+    mysql_free_result(metadata);
+}
+
+
+/**
+ * The private data of exported schemas, which owns everything that they
+ * point to.
+ */
+struct ExportedSchema {
+    ExportedSchema()
+        : format_()
+        , name_()
+        , children_()
+        , childPointers_()
+    {
+    }
+
+    ExportedSchema(const ExportedSchema& rhs) = delete;
+    ExportedSchema(ExportedSchema&& rhs) = delete;
+    ExportedSchema& operator=(const ExportedSchema& rhs) = delete;
+    ExportedSchema& operator=(ExportedSchema&& rhs) = delete;
+
+    string format_;
+    string name_;
+    vector<ArrowSchema> children_;
+    vector<ArrowSchema*> childPointers_;
+};
+
+
+/**
+ * The private data of exported arrays, which owns the column's buffers.
+ */
+struct ExportedArray {
+    ExportedArray()
+        : column_()
+        , buffers_()
+        , children_()
+        , childPointers_()
+    {
+    }
+
+    ExportedArray(const ExportedArray& rhs) = delete;
+    ExportedArray(ExportedArray&& rhs) = delete;
+    ExportedArray& operator=(const ExportedArray& rhs) = delete;
+    ExportedArray& operator=(ExportedArray&& rhs) = delete;
+
+    unique_ptr<ColumnBuffers> column_;
+    vector<const void*> buffers_;
+    vector<ArrowArray> children_;
+    vector<ArrowArray*> childPointers_;
+};
+
+
+static void releaseSchema(ArrowSchema* const schema) {
+    ExportedSchema* const exported =
+        static_cast<ExportedSchema*>(schema->private_data);
+    // Consumers may have moved children out, which leaves them released
+    for (auto& child : exported->children_) {
+        if (nullptr != child.release) {
+            child.release(&child);
+        }
+    }
+    delete exported;
+    schema->release = nullptr;
+}
+
+
+static void releaseArray(ArrowArray* const array) {
+    ExportedArray* const exported =
+        static_cast<ExportedArray*>(array->private_data);
+    for (auto& child : exported->children_) {
+        if (nullptr != child.release) {
+            child.release(&child);
+        }
+    }
+    delete exported;
+    array->release = nullptr;
+}
+
+
+static void initializeSchema(
+    ArrowSchema* const schema,
+    unique_ptr<ExportedSchema> exported,
+    const int64_t flags
+) {
+    std::memset(schema, 0, sizeof(*schema));
+    schema->format = exported->format_.c_str();
+    schema->name = exported->name_.c_str();
+    schema->flags = flags;
+    schema->n_children = static_cast<int64_t>(exported->children_.size());
+    schema->children =
+        exported->childPointers_.empty()
+        ? nullptr
+        : exported->childPointers_.data();
+    schema->release = releaseSchema;
+    schema->private_data = exported.release();
+}
+
+
+static void initializeArray(
+    ArrowArray* const array,
+    unique_ptr<ExportedArray> exported,
+    const size_t length,
+    const int64_t nullCount
+) {
+    std::memset(array, 0, sizeof(*array));
+    array->length = static_cast<int64_t>(length);
+    array->null_count = nullCount;
+    array->n_buffers = static_cast<int64_t>(exported->buffers_.size());
+    array->buffers = exported->buffers_.data();
+    array->n_children = static_cast<int64_t>(exported->children_.size());
+    array->children =
+        exported->childPointers_.empty()
+        ? nullptr
+        : exported->childPointers_.data();
+    array->release = releaseArray;
+    array->private_data = exported.release();
+}
+
+
+void MySqlArrowPrivate::exportColumns(
+    Columns* const columns,
+    const size_t rowCount,
+    ArrowArray* const array,
+    ArrowSchema* const schema
+) {
+    assert(nullptr != columns);
+    unique_ptr<ExportedSchema> structSchema(new ExportedSchema());
+    structSchema->format_ = "+s";
+    unique_ptr<ExportedArray> structArray(new ExportedArray());
+    // Structs have a validity buffer, but these rows are never NULL
+    structArray->buffers_.push_back(nullptr);
+
+    // Reserve first so that the children don't move once they're pointed to
+    structSchema->children_.reserve(columns->size());
+    structArray->children_.reserve(columns->size());
+    try {
+        for (auto& column : *columns) {
+            unique_ptr<ExportedSchema> childSchema(new ExportedSchema());
+            childSchema->format_ = column->format_;
+            childSchema->name_ = column->name_;
+            structSchema->children_.push_back(ArrowSchema());
+            initializeSchema(
+                &structSchema->children_.back(),
+                std::move(childSchema),
+                column->nullable_ ? ARROW_FLAG_NULLABLE : 0);
+
+            unique_ptr<ExportedArray> childArray(new ExportedArray());
+            // The validity buffer may be left out if nothing is NULL
+            childArray->buffers_.push_back(
+                0 == column->nullCount_
+                    ? nullptr
+                    : column->validity_.getData());
+            childArray->buffers_.push_back(column->values_.getData());
+            if (0 == std::strcmp("u", column->format_)) {
+                childArray->buffers_.push_back(column->data_.getData());
+            }
+            const int64_t nullCount = column->nullCount_;
+            childArray->column_ = std::move(column);
+            structArray->children_.push_back(ArrowArray());
+            initializeArray(
+                &structArray->children_.back(),
+                std::move(childArray),
+                rowCount,
+                nullCount);
+        }
+    } catch (...) {
+        // Release whatever was exported before the failure
+        ArrowSchema partialSchema;
+        initializeSchema(&partialSchema, std::move(structSchema), 0);
+        partialSchema.release(&partialSchema);
+        ArrowArray partialArray;
+        initializeArray(&partialArray, std::move(structArray), 0, 0);
+        partialArray.release(&partialArray);
+        columns->clear();
+        throw;
+    }
+    columns->clear();
+
+    for (auto& child : structSchema->children_) {
+        structSchema->childPointers_.push_back(&child);
+    }
+    for (auto& child : structArray->children_) {
+        structArray->childPointers_.push_back(&child);
+    }
+    initializeSchema(schema, std::move(structSchema), 0);
+    initializeArray(array, std::move(structArray), rowCount, 0);
+}
@@ -0,0 +1,515 @@
+#ifndef MYSQL_ARROW_HPP_
+#define MYSQL_ARROW_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <mysql/mysql.h>
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "MySqlException.hpp"
+#include "MySqlPreparedStatement.hpp"
+#include "MySqlStringRef.hpp"
+#include "OutputBinder.hpp"
+
+// The Arrow C data interface, copied from the Arrow specification so that
+// the Arrow library isn't needed. The guard is the one that the
+// specification asks every copy to use.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    // Array type description
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowSchema*);
+    // Opaque producer-specific data
+    void* private_data;
+};
+
+struct ArrowArray {
+    // Array data description
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowArray*);
+    // Opaque producer-specific data
+    void* private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+
+namespace MySqlArrowPrivate {
+
+template<int I> struct int_ {};  // Compile-time counter
+
+/**
+ * A growable buffer whose memory is 64 byte aligned and padded to a multiple
+ * of 64 bytes, as Arrow recommends.
+ */
+class AlignedBuffer {
+    public:
+        AlignedBuffer();
+        ~AlignedBuffer();
+
+        AlignedBuffer(const AlignedBuffer& rhs) = delete;
+        AlignedBuffer(AlignedBuffer&& rhs) = delete;
+        AlignedBuffer& operator=(const AlignedBuffer& rhs) = delete;
+        AlignedBuffer& operator=(AlignedBuffer&& rhs) = delete;
+
+        void append(const void* data, size_t length);
+        void appendZeros(size_t length);
+
+        uint8_t* getData();
+        const uint8_t* getData() const;
+        size_t getSize() const;
+
+    private:
+        void reserve(size_t capacity);
+
+        uint8_t* data_;
+        size_t size_;
+        size_t capacity_;
+};
+
+/**
+ * The Arrow buffers for one column.
+ */
+struct ColumnBuffers {
+    ColumnBuffers(const char* format, bool nullable);
+
+    ColumnBuffers(const ColumnBuffers& rhs) = delete;
+    ColumnBuffers(ColumnBuffers&& rhs) = delete;
+    ColumnBuffers& operator=(const ColumnBuffers& rhs) = delete;
+    ColumnBuffers& operator=(ColumnBuffers&& rhs) = delete;
+
+    /**
+     * Sets the validity bit for a row, counting it as NULL if it's not valid.
+     */
+    void appendValidity(bool valid, size_t row);
+
+    std::string name_;
+    const char* const format_;
+    const bool nullable_;
+    int64_t nullCount_;
+    AlignedBuffer validity_;
+    // Fixed width values, or offsets into data_ for strings
+    AlignedBuffer values_;
+    AlignedBuffer data_;
+};
+
+typedef std::vector<std::unique_ptr<ColumnBuffers>> Columns;
+
+/**
+ * Names the columns after the statement's result columns.
+ */
+void setColumnNames(const MySqlPreparedStatement& statement, Columns* columns);
+
+/**
+ * Moves the columns into an Arrow struct array and its schema, leaving
+ * columns empty. Both need to be released by the consumer.
+ */
+void exportColumns(
+    Columns* columns,
+    size_t rowCount,
+    ArrowArray* array,
+    ArrowSchema* schema);
+
+
+/**
+ * How each type of column is appended to its buffers.
+ */
+template <typename T>
+class ArrowColumn {
+    public:
+        static_assert(
+            // C++ guarantees that the sizeof any type >= 0, so this will
+            // always give a compile time error
+            sizeof(T) < 0,
+            "Unsupported Arrow column type");
+};
+
+// *************************************
+// Full specializations for fixed widths
+// *************************************
+#ifndef MYSQL_ARROW_COLUMN_SPECIALIZATION
+#define MYSQL_ARROW_COLUMN_SPECIALIZATION(type, format) \
+template <> \
+class ArrowColumn<type> { \
+    public: \
+        typedef type ViewType; \
+        static const bool NULLABLE = false; \
+        static const char* getFormat() { \
+            return format; \
+        } \
+        static void startColumn(ColumnBuffers* const) { \
+        } \
+        static void append( \
+            const MYSQL_BIND& bind, \
+            ColumnBuffers* const column, \
+            const size_t \
+        ) { \
+            if (*bind.is_null) { \
+                throw MySqlException( \
+                    OutputBinderPrivate::NULL_VALUE_ERROR_MESSAGE); \
+            } \
+            appendValue(bind, column); \
+        } \
+        static void appendValue( \
+            const MYSQL_BIND& bind, \
+            ColumnBuffers* const column \
+        ) { \
+            column->values_.append(bind.buffer, sizeof(type)); \
+        } \
+        static void appendEmpty(ColumnBuffers* const column) { \
+            column->values_.appendZeros(sizeof(type)); \
+        } \
+        static type getValue( \
+            const ColumnBuffers& column, \
+            const size_t row \
+        ) { \
+            type value; \
+            std::memcpy( \
+                &value, \
+                column.values_.getData() + row * sizeof(type), \
+                sizeof(type)); \
+            return value; \
+        } \
+};
+#endif
+MYSQL_ARROW_COLUMN_SPECIALIZATION(int8_t,   "c")
+MYSQL_ARROW_COLUMN_SPECIALIZATION(uint8_t,  "C")
+MYSQL_ARROW_COLUMN_SPECIALIZATION(int16_t,  "s")
+MYSQL_ARROW_COLUMN_SPECIALIZATION(uint16_t, "S")
+MYSQL_ARROW_COLUMN_SPECIALIZATION(int32_t,  "i")
+MYSQL_ARROW_COLUMN_SPECIALIZATION(uint32_t, "I")
+MYSQL_ARROW_COLUMN_SPECIALIZATION(int64_t,  "l")
+MYSQL_ARROW_COLUMN_SPECIALIZATION(uint64_t, "L")
+MYSQL_ARROW_COLUMN_SPECIALIZATION(float,    "f")
+MYSQL_ARROW_COLUMN_SPECIALIZATION(double,   "g")
+
+/**
+ * Strings are stored as UTF-8 with 32 bit offsets.
+ */
+template <>
+class ArrowColumn<std::string> {
+    public:
+        typedef MySqlStringRef ViewType;
+        static const bool NULLABLE = false;
+
+        static const char* getFormat() {
+            return "u";
+        }
+        static void startColumn(ColumnBuffers* const column) {
+            const int32_t offset = 0;
+            column->values_.append(&offset, sizeof(offset));
+        }
+        static void append(
+            const MYSQL_BIND& bind,
+            ColumnBuffers* const column,
+            const size_t
+        ) {
+            if (*bind.is_null) {
+                throw MySqlException(
+                    OutputBinderPrivate::NULL_VALUE_ERROR_MESSAGE);
+            }
+            appendValue(bind, column);
+        }
+        static void appendValue(
+            const MYSQL_BIND& bind,
+            ColumnBuffers* const column
+        ) {
+            const size_t maximum = static_cast<size_t>(INT32_MAX);
+            if (*bind.length > maximum - column->data_.getSize()) {
+                throw MySqlException(
+                    "Arrow string column is larger than 2 GiB");
+            }
+            column->data_.append(bind.buffer, *bind.length);
+            appendEmpty(column);
+        }
+        static void appendEmpty(ColumnBuffers* const column) {
+            const int32_t offset = static_cast<int32_t>(
+                column->data_.getSize());
+            column->values_.append(&offset, sizeof(offset));
+        }
+        static MySqlStringRef getValue(
+            const ColumnBuffers& column,
+            const size_t row
+        ) {
+            int32_t offsets[2];
+            std::memcpy(
+                offsets,
+                column.values_.getData() + row * sizeof(int32_t),
+                sizeof(offsets));
+            return MySqlStringRef(
+                reinterpret_cast<const char*>(column.data_.getData())
+                    + offsets[0],
+                static_cast<size_t>(offsets[1] - offsets[0]));
+        }
+};
+
+/**
+ * Smart pointers are nullable columns of their pointee.
+ */
+/// @{
+template <typename T>
+class NullableArrowColumn {
+    public:
+        typedef typename ArrowColumn<T>::ViewType ViewType;
+        static const bool NULLABLE = true;
+
+        static const char* getFormat() {
+            return ArrowColumn<T>::getFormat();
+        }
+        static void startColumn(ColumnBuffers* const column) {
+            ArrowColumn<T>::startColumn(column);
+        }
+        static void append(
+            const MYSQL_BIND& bind,
+            ColumnBuffers* const column,
+            const size_t row
+        ) {
+            column->appendValidity(!*bind.is_null, row);
+            if (*bind.is_null) {
+                // Null slots still take up space in the values
+                ArrowColumn<T>::appendEmpty(column);
+            } else {
+                ArrowColumn<T>::appendValue(bind, column);
+            }
+        }
+        static ViewType getValue(
+            const ColumnBuffers& column,
+            const size_t row
+        ) {
+            return ArrowColumn<T>::getValue(column, row);
+        }
+};
+
+template <typename T>
+class ArrowColumn<std::shared_ptr<T>> : public NullableArrowColumn<T> {
+};
+
+template <typename T>
+class ArrowColumn<std::unique_ptr<T>> : public NullableArrowColumn<T> {
+};
+/// @}
+
+}  // namespace MySqlArrowPrivate
+
+
+/**
+ * Query results decoded straight into Arrow columnar buffers: a validity
+ * bitmap for nullable columns, 64 byte aligned value buffers, and offsets
+ * plus data for strings. The column types are the same as runQuery's tuple
+ * types, with std::shared_ptr or std::unique_ptr for nullable columns.
+ *
+ *     MySqlArrowBatch<int64_t, std::string, std::shared_ptr<double>> batch;
+ *     connection.runQuery(&batch, "SELECT id, name, score FROM user");
+ *     ArrowArray array;
+ *     ArrowSchema schema;
+ *     batch.exportTo(&array, &schema);
+ *     // Hand array and schema to any consumer of the Arrow C data interface
+ *
+ * Exporting moves the buffers to the consumer without copying them.
+ */
+template <typename... Args>
+class MySqlArrowBatch {
+    public:
+        MySqlArrowBatch();
+
+        MySqlArrowBatch(const MySqlArrowBatch& rhs) = delete;
+        MySqlArrowBatch(MySqlArrowBatch&& rhs) = delete;
+        MySqlArrowBatch& operator=(const MySqlArrowBatch& rhs) = delete;
+        MySqlArrowBatch& operator=(MySqlArrowBatch&& rhs) = delete;
+
+        /**
+         * Executes the statement and appends every row. The columns are
+         * named after the first statement's result columns. If this throws,
+         * the batch may have part of a row in it and should be discarded.
+         */
+        void appendResults(const MySqlPreparedStatement& statement);
+
+        size_t getRowCount() const;
+
+        template <size_t I>
+        bool isNull(size_t row) const;
+
+        /**
+         * Reads a value in place. Strings are returned as a MySqlStringRef
+         * into the column, which is invalidated by appending. NULL values
+         * read as zero or an empty string.
+         */
+        template <size_t I>
+        typename MySqlArrowPrivate::ArrowColumn<
+            typename std::tuple_element<I, std::tuple<Args...>>::type
+        >::ViewType getValue(size_t row) const;
+
+        int64_t getNullCount(size_t column) const;
+
+        /**
+         * Moves the columns into an Arrow struct array with one child per
+         * column, and its schema. The consumer needs to call their release
+         * callbacks. The batch is empty afterwards.
+         */
+        void exportTo(ArrowArray* array, ArrowSchema* schema);
+
+    private:
+        template <int I>
+        void createColumns(MySqlArrowPrivate::int_<I>);
+        void createColumns(MySqlArrowPrivate::int_<-1>);
+
+        template <int I>
+        void appendRow(
+            const std::vector<MYSQL_BIND>& row,
+            MySqlArrowPrivate::int_<I>);
+        void appendRow(
+            const std::vector<MYSQL_BIND>&,
+            MySqlArrowPrivate::int_<-1>);
+
+        MySqlArrowPrivate::Columns columns_;
+        size_t rowCount_;
+};
+
+
+template <typename... Args>
+MySqlArrowBatch<Args...>::MySqlArrowBatch()
+    : columns_()
+    , rowCount_(0)
+{
+    static_assert(0 < sizeof...(Args), "Arrow batches need a column");
+    createColumns(MySqlArrowPrivate::int_<sizeof...(Args) - 1>());
+}
+
+
+template <typename... Args>
+void MySqlArrowBatch<Args...>::appendResults(
+    const MySqlPreparedStatement& statement
+) {
+    if (columns_.front()->name_.empty()) {
+        MySqlArrowPrivate::setColumnNames(statement, &columns_);
+    }
+    OutputBinderPrivate::fetchTypedRows<Args...>(
+        statement,
+        [this](const std::vector<MYSQL_BIND>& row) {
+            appendRow(row, MySqlArrowPrivate::int_<sizeof...(Args) - 1>());
+            ++rowCount_;
+        });
+}
+
+
+template <typename... Args>
+size_t MySqlArrowBatch<Args...>::getRowCount() const {
+    return rowCount_;
+}
+
+
+template <typename... Args>
+template <size_t I>
+bool MySqlArrowBatch<Args...>::isNull(const size_t row) const {
+    assert(row < rowCount_);
+    const MySqlArrowPrivate::ColumnBuffers& column = *columns_.at(I);
+    if (!column.nullable_) {
+        return false;
+    }
+    return 0 == (column.validity_.getData()[row / 8] & (1 << (row % 8)));
+}
+
+
+template <typename... Args>
+template <size_t I>
+typename MySqlArrowPrivate::ArrowColumn<
+    typename std::tuple_element<I, std::tuple<Args...>>::type
+>::ViewType MySqlArrowBatch<Args...>::getValue(const size_t row) const {
+    typedef typename std::tuple_element<I, std::tuple<Args...>>::type T;
+    if (row >= rowCount_) {
+        throw MySqlException("Arrow batch row is out of range");
+    }
+    return MySqlArrowPrivate::ArrowColumn<T>::getValue(*columns_.at(I), row);
+}
+
+
+template <typename... Args>
+int64_t MySqlArrowBatch<Args...>::getNullCount(const size_t column) const {
+    return columns_.at(column)->nullCount_;
+}
+
+
+template <typename... Args>
+void MySqlArrowBatch<Args...>::exportTo(
+    ArrowArray* const array,
+    ArrowSchema* const schema
+) {
+    assert(nullptr != array);
+    assert(nullptr != schema);
+    MySqlArrowPrivate::exportColumns(&columns_, rowCount_, array, schema);
+    rowCount_ = 0;
+    createColumns(MySqlArrowPrivate::int_<sizeof...(Args) - 1>());
+}
+
+
+template <typename... Args>
+template <int I>
+void MySqlArrowBatch<Args...>::createColumns(MySqlArrowPrivate::int_<I>) {
+    typedef MySqlArrowPrivate::ArrowColumn<
+        typename std::tuple_element<I, std::tuple<Args...>>::type
+    > Column;
+    // Columns are created in order, so do the earlier ones first
+    createColumns(MySqlArrowPrivate::int_<I - 1>());
+    columns_.push_back(std::unique_ptr<MySqlArrowPrivate::ColumnBuffers>(
+        new MySqlArrowPrivate::ColumnBuffers(
+            Column::getFormat(),
+            Column::NULLABLE)));
+    Column::startColumn(columns_.back().get());
+}
+
+
+template <typename... Args>
+void MySqlArrowBatch<Args...>::createColumns(MySqlArrowPrivate::int_<-1>) {
+}
+
+
+template <typename... Args>
+template <int I>
+void MySqlArrowBatch<Args...>::appendRow(
+    const std::vector<MYSQL_BIND>& row,
+    MySqlArrowPrivate::int_<I>
+) {
+    MySqlArrowPrivate::ArrowColumn<
+        typename std::tuple_element<I, std::tuple<Args...>>::type
+    >::append(row.at(I), columns_.at(I).get(), rowCount_);
+    appendRow(row, MySqlArrowPrivate::int_<I - 1>());
+}
+
+
+template <typename... Args>
+void MySqlArrowBatch<Args...>::appendRow(
+    const std::vector<MYSQL_BIND>&,
+    MySqlArrowPrivate::int_<-1>
+) {
+}
+
+
+#endif  // MYSQL_ARROW_HPP_
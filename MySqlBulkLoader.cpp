@@ -0,0 +1,194 @@
+#include "MySql.hpp"
+#include "MySqlBulkLoader.hpp"
+#include "MySqlException.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <mysql/errmsg.h>
+#include <mysql/mysql.h>
+
+#include <exception>
+#include <string>
+
+using MySqlBulkLoaderPrivate::RowSource;
+using std::current_exception;
+using std::exception_ptr;
+using std::max;
+using std::min;
+using std::rethrow_exception;
+using std::string;
+
+
+void MySqlBulkLoaderPrivate::appendEscaped(
+    const char* const value,
+    const size_t length,
+    string* const out
+) {
+    out->reserve(out->size() + length);
+    for (size_t i = 0; i < length; ++i) {
+        switch (value[i]) {
+            case '\\':
+                out->append("\\\\");
+                break;
+            case '\t':
+                out->append("\\t");
+                break;
+            case '\n':
+                out->append("\\n");
+                break;
+            case '\r':
+                out->append("\\r");
+                break;
+            case '\0':
+                out->append("\\0");
+                break;
+            default:
+                out->push_back(value[i]);
+                break;
+        }
+    }
+}
+
+
+// The client library reads the stream in chunks of about this size
+static const size_t STREAM_BUFFER_BYTES = 64 * 1024;
+
+struct LoadState {
+    explicit LoadState(RowSource* const source)
+        : source_(source)
+        , buffer_()
+        , offset_(0)
+        , hasMoreRows_(true)
+        , error_()
+    {
+    }
+
+    LoadState(const LoadState& rhs) = delete;
+    LoadState(LoadState&& rhs) = delete;
+    LoadState& operator=(const LoadState& rhs) = delete;
+    LoadState& operator=(LoadState&& rhs) = delete;
+
+    RowSource* const source_;
+    string buffer_;
+    size_t offset_;
+    bool hasMoreRows_;
+    exception_ptr error_;
+};
+
+
+static int initLoad(
+    void** const state,
+    const char* const,
+    void* const userData
+) {
+    *state = userData;
+    return 0;
+}
+
+
+static int readLoad(
+    void* const statePointer,
+    char* const buffer,
+    const unsigned int length
+) {
+    LoadState* const state = static_cast<LoadState*>(statePointer);
+    // Exceptions can't unwind through the client library
+    try {
+        if (state->offset_ == state->buffer_.size()) {
+            state->buffer_.clear();
+            state->offset_ = 0;
+            if (state->hasMoreRows_) {
+                state->hasMoreRows_ = state->source_->appendRows(
+                    &state->buffer_,
+                    max(static_cast<size_t>(length), STREAM_BUFFER_BYTES));
+            }
+        }
+        const size_t copied = min(
+            static_cast<size_t>(length),
+            state->buffer_.size() - state->offset_);
+        std::memcpy(buffer, state->buffer_.data() + state->offset_, copied);
+        state->offset_ += copied;
+        return static_cast<int>(copied);
+    } catch (...) {
+        state->error_ = current_exception();
+        return -1;
+    }
+}
+
+
+static void endLoad(void* const) {
+}
+
+
+static int getLoadError(
+    void* const,
+    char* const errorMessage,
+    const unsigned int length
+) {
+    const char message[] = "Bulk load row source failed";
+    std::strncpy(errorMessage, message, length);
+    if (0 < length) {
+        errorMessage[length - 1] = '\0';
+    }
+    return CR_UNKNOWN_ERROR;
+}
+
+
+MySqlBulkLoader::MySqlBulkLoader(MySql* const connection)
+    : connection_(connection)
+{
+    assert(nullptr != connection_);
+}
+
+
+MySqlBulkLoader::Result MySqlBulkLoader::load(
+    const char* const table,
+    const char* const columns,
+    RowSource* const source
+) {
+    assert(nullptr != table);
+    assert(nullptr != source);
+    // The file name is ignored by the handlers, but the server sends it back
+    // so it needs to be something
+    string statement(
+        "LOAD DATA LOCAL INFILE 'mysql-cpp-bulk-load' INTO TABLE ");
+    statement += table;
+    statement +=
+        " FIELDS TERMINATED BY '\\t' ESCAPED BY '\\\\'"
+        " LINES TERMINATED BY '\\n'";
+    if (nullptr != columns) {
+        statement += " (";
+        statement += columns;
+        statement += ')';
+    }
+
+    MYSQL* const connection = connection_->connection_->handle;
+    LoadState state(source);
+    mysql_set_local_infile_handler(
+        connection,
+        initLoad,
+        readLoad,
+        endLoad,
+        getLoadError,
+        &state);
+    const int status = mysql_real_query(
+        connection,
+        statement.c_str(),
+        statement.length());
+    mysql_set_local_infile_default(connection);
+
+    if (state.error_) {
+        rethrow_exception(state.error_);
+    }
+    if (0 != status) {
+        throw MySqlException(connection);
+    }
+
+    connection_->invalidateCachedTables(statement.c_str());
+
+    Result result;
+    result.rowCount = mysql_affected_rows(connection);
+    result.warningCount = mysql_warning_count(connection);
+    return result;
+}
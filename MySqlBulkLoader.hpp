@@ -0,0 +1,272 @@
+#ifndef MYSQL_BULK_LOADER_HPP_
+#define MYSQL_BULK_LOADER_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <mysql/mysql.h>
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+class MySql;
+
+namespace MySqlBulkLoaderPrivate {
+
+template<int I> struct int_ {};  // Compile-time counter
+
+/**
+ * Appends a value as a LOAD DATA field, using the default format: fields are
+ * separated by tabs, rows end with a newline, backslash is the escape
+ * character and \N is NULL.
+ */
+template <typename T>
+class FieldFormatter {
+    public:
+        static void append(const T&, std::string* const) {
+            static_assert(
+                // C++ guarantees that the sizeof any type >= 0, so this will
+                // always give a compile time error
+                sizeof(T) < 0,
+                "All types need to have template specialized instances"
+                " defined for them, but one is missing for type T.");
+        }
+};
+
+void appendEscaped(const char* value, size_t length, std::string* out);
+
+#ifndef BULK_LOADER_INTEGRAL_FORMATTER_SPECIALIZATION
+#define BULK_LOADER_INTEGRAL_FORMATTER_SPECIALIZATION(type, promotedType) \
+template <> \
+class FieldFormatter<type> { \
+    public: \
+        static void append(const type& value, std::string* const out) { \
+            out->append(std::to_string(static_cast<promotedType>(value))); \
+        } \
+};
+#endif
+BULK_LOADER_INTEGRAL_FORMATTER_SPECIALIZATION(int8_t, long long)
+BULK_LOADER_INTEGRAL_FORMATTER_SPECIALIZATION(uint8_t, unsigned long long)
+BULK_LOADER_INTEGRAL_FORMATTER_SPECIALIZATION(int16_t, long long)
+BULK_LOADER_INTEGRAL_FORMATTER_SPECIALIZATION(uint16_t, unsigned long long)
+BULK_LOADER_INTEGRAL_FORMATTER_SPECIALIZATION(int32_t, long long)
+BULK_LOADER_INTEGRAL_FORMATTER_SPECIALIZATION(uint32_t, unsigned long long)
+BULK_LOADER_INTEGRAL_FORMATTER_SPECIALIZATION(int64_t, long long)
+BULK_LOADER_INTEGRAL_FORMATTER_SPECIALIZATION(uint64_t, unsigned long long)
+
+#ifndef BULK_LOADER_FLOATING_FORMATTER_SPECIALIZATION
+#define BULK_LOADER_FLOATING_FORMATTER_SPECIALIZATION(type, format) \
+template <> \
+class FieldFormatter<type> { \
+    public: \
+        static void append(const type& value, std::string* const out) { \
+            /* Enough digits to read back the exact same value */ \
+            char buffer[32]; \
+            const int length = std::snprintf( \
+                buffer, \
+                sizeof(buffer), \
+                format, \
+                static_cast<double>(value)); \
+            out->append(buffer, static_cast<size_t>(length)); \
+        } \
+};
+#endif
+BULK_LOADER_FLOATING_FORMATTER_SPECIALIZATION(float, "%.9g")
+BULK_LOADER_FLOATING_FORMATTER_SPECIALIZATION(double, "%.17g")
+
+template <>
+class FieldFormatter<std::string> {
+    public:
+        static void append(const std::string& value, std::string* const out) {
+            appendEscaped(value.data(), value.length(), out);
+        }
+};
+template <>
+class FieldFormatter<char*> {
+    public:
+        static void append(const char* const& value, std::string* const out) {
+            if (nullptr == value) {
+                out->append("\\N");
+            } else {
+                appendEscaped(
+                    value,
+                    std::char_traits<char>::length(value),
+                    out);
+            }
+        }
+};
+template <>
+class FieldFormatter<const char*> {
+    public:
+        static void append(const char* const& value, std::string* const out) {
+            FieldFormatter<char*>::append(value, out);
+        }
+};
+
+// Smart pointers are NULL when they're empty
+template <typename T>
+class FieldFormatter<std::shared_ptr<T>> {
+    public:
+        static void append(
+            const std::shared_ptr<T>& value,
+            std::string* const out
+        ) {
+            if (nullptr == value) {
+                out->append("\\N");
+            } else {
+                FieldFormatter<T>::append(*value, out);
+            }
+        }
+};
+template <typename T>
+class FieldFormatter<std::unique_ptr<T>> {
+    public:
+        static void append(
+            const std::unique_ptr<T>& value,
+            std::string* const out
+        ) {
+            if (nullptr == value) {
+                out->append("\\N");
+            } else {
+                FieldFormatter<T>::append(*value, out);
+            }
+        }
+};
+
+// The counter goes down, but the fields need to go in order, so I counts
+// the fields that are left
+template <typename Tuple>
+void appendFields(const Tuple&, std::string* const, int_<-1>) {
+}
+template <typename Tuple, int I>
+void appendFields(const Tuple& tuple, std::string* const out, int_<I>) {
+    static const size_t index =
+        std::tuple_size<Tuple>::value - 1 - static_cast<size_t>(I);
+    FieldFormatter<
+        typename std::tuple_element<index, Tuple>::type
+    >::append(std::get<index>(tuple), out);
+    out->push_back(0 == I ? '\n' : '\t');
+    appendFields(tuple, out, int_<I - 1>());
+}
+
+/**
+ * Produces the LOAD DATA stream a few rows at a time.
+ */
+class RowSource {
+    public:
+        RowSource() {}
+        virtual ~RowSource() {}
+
+        RowSource(const RowSource& rhs) = delete;
+        RowSource(RowSource&& rhs) = delete;
+        RowSource& operator=(const RowSource& rhs) = delete;
+        RowSource& operator=(RowSource&& rhs) = delete;
+
+        /**
+         * Appends rows until buffer holds at least minimumBytes.
+         * @return False once there are no more rows.
+         */
+        virtual bool appendRows(std::string* buffer, size_t minimumBytes) = 0;
+};
+
+template <typename Iterator>
+class IteratorRowSource : public RowSource {
+    public:
+        IteratorRowSource(Iterator begin, Iterator end)
+            : RowSource()
+            , current_(begin)
+            , end_(end)
+        {
+        }
+
+        bool appendRows(
+            std::string* const buffer,
+            const size_t minimumBytes
+        ) override {
+            while (buffer->size() < minimumBytes && current_ != end_) {
+                typedef typename std::decay<decltype(*current_)>::type Tuple;
+                appendFields(
+                    *current_,
+                    buffer,
+                    int_<std::tuple_size<Tuple>::value - 1>());
+                ++current_;
+            }
+            return current_ != end_;
+        }
+
+    private:
+        Iterator current_;
+        const Iterator end_;
+};
+
+}  // namespace MySqlBulkLoaderPrivate
+
+
+/**
+ * Loads rows with LOAD DATA LOCAL INFILE, which is much faster than INSERTs
+ * for large loads. The rows are formatted as they're streamed to the server,
+ * so no file is written and the whole load is never in memory at once.
+ *
+ * The connection needs MySqlOptions::setLocalInfile and the server needs
+ * local_infile enabled. Strings are sent as they are, so they're interpreted
+ * in the database's default character set.
+ *
+ *     MySqlBulkLoader loader(&connection);
+ *     const auto result = loader.load(
+ *         "user", "name, password", users.begin(), users.end());
+ */
+class MySqlBulkLoader {
+    public:
+        struct Result {
+            my_ulonglong rowCount;
+            unsigned int warningCount;
+        };
+
+        explicit MySqlBulkLoader(MySql* connection);
+
+        MySqlBulkLoader(const MySqlBulkLoader& rhs) = delete;
+        MySqlBulkLoader(MySqlBulkLoader&& rhs) = delete;
+        MySqlBulkLoader& operator=(const MySqlBulkLoader& rhs) = delete;
+        MySqlBulkLoader& operator=(MySqlBulkLoader&& rhs) = delete;
+
+        /**
+         * Loads a range of tuples into a table. The tuples can hold any of
+         * the types that runCommand can bind, and empty shared_ptrs and
+         * unique_ptrs are loaded as NULL.
+         * @param table The table to load into. This is put into the statement
+         *     as is, so it must not come from an untrusted source.
+         * @param columns Comma separated columns that the tuple elements go
+         *     into, or nullptr for every column in table order. Also put into
+         *     the statement as is.
+         */
+        template <typename Iterator>
+        Result load(
+            const char* table,
+            const char* columns,
+            Iterator begin,
+            Iterator end);
+
+    private:
+        Result load(
+            const char* table,
+            const char* columns,
+            MySqlBulkLoaderPrivate::RowSource* source);
+
+        MySql* const connection_;
+};
+
+
+template <typename Iterator>
+MySqlBulkLoader::Result MySqlBulkLoader::load(
+    const char* const table,
+    const char* const columns,
+    const Iterator begin,
+    const Iterator end
+) {
+    MySqlBulkLoaderPrivate::IteratorRowSource<Iterator> source(begin, end);
+    return load(table, columns, &source);
+}
+
+
+#endif  // MYSQL_BULK_LOADER_HPP_
@@ -0,0 +1,169 @@
+#include "MySql.hpp"
+#include "MySqlConnectionWarmer.hpp"
+#include "MySqlException.hpp"
+#include "MySqlOptions.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::atomic;
+using std::exception_ptr;
+using std::ifstream;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+
+// MySql treats empty strings the same as nullptr
+static string toString(const char* const value) {
+    return nullptr == value ? string() : string(value);
+}
+
+
+MySqlConnectionWarmer::MySqlConnectionWarmer(
+    const char* const hostname,
+    const char* const username,
+    const char* const password,
+    const char* const database,
+    const MySqlOptions& options,
+    const uint16_t port
+)
+    : hostname_(toString(hostname))
+    , username_(toString(username))
+    , password_(toString(password))
+    , database_(toString(database))
+    , options_(options)
+    , port_(port)
+    , statements_()
+    , maximumThreads_(8)
+{
+}
+
+
+void MySqlConnectionWarmer::addStatement(const char* const query) {
+    assert(nullptr != query);
+    if (statements_.end()
+        == std::find(statements_.begin(), statements_.end(), query)
+    ) {
+        statements_.push_back(query);
+    }
+}
+
+
+void MySqlConnectionWarmer::loadManifest(const char* const path) {
+    assert(nullptr != path);
+    ifstream manifest(path);
+    if (!manifest) {
+        throw MySqlException(string("Unable to open manifest ") + path);
+    }
+
+    const char* const whitespace = " \t\r";
+    string line;
+    while (std::getline(manifest, line)) {
+        const size_t first = line.find_first_not_of(whitespace);
+        if (string::npos == first
+            || '#' == line[first]
+            || 0 == line.compare(first, 2, "--")
+        ) {
+            continue;
+        }
+        const size_t last = line.find_last_not_of(whitespace);
+        addStatement(line.substr(first, last - first + 1).c_str());
+    }
+    if (manifest.bad()) {
+        throw MySqlException(string("Unable to read manifest ") + path);
+    }
+}
+
+
+const vector<string>& MySqlConnectionWarmer::getStatements() const {
+    return statements_;
+}
+
+
+void MySqlConnectionWarmer::setMaximumThreads(const size_t threads) {
+    if (0 == threads) {
+        throw MySqlException("Warming up needs at least 1 thread");
+    }
+    maximumThreads_ = threads;
+}
+
+
+vector<MySql> MySqlConnectionWarmer::open(const size_t connectionCount) const {
+    // MySql can't be default constructed, so the threads fill in slots that
+    // are moved out of once they're all open
+    vector<unique_ptr<MySql>> slots(connectionCount);
+    atomic<size_t> nextConnection(0);
+    atomic<bool> failed(false);
+
+    const size_t threadCount = std::min(maximumThreads_, connectionCount);
+    vector<std::future<void>> futures;
+    futures.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        futures.push_back(std::async(
+            std::launch::async,
+            [this, connectionCount, &slots, &nextConnection, &failed]() {
+                try {
+                    while (!failed.load()) {
+                        const size_t index = nextConnection.fetch_add(1);
+                        if (index >= connectionCount) {
+                            return;
+                        }
+                        slots.at(index) = openOne();
+                    }
+                } catch (...) {
+                    // Stop the other threads from opening more connections
+                    failed.store(true);
+                    throw;
+                }
+            }));
+    }
+
+    // Wait for every thread before throwing so that no thread outlives the
+    // locals that it references
+    exception_ptr firstError;
+    for (auto& future : futures) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+
+    vector<MySql> connections;
+    connections.reserve(connectionCount);
+    for (auto& slot : slots) {
+        connections.push_back(std::move(*slot));
+    }
+    return connections;
+}
+
+
+unique_ptr<MySql> MySqlConnectionWarmer::openOne() const {
+    unique_ptr<MySql> connection(new MySql(
+        hostname_.c_str(),
+        username_.c_str(),
+        password_.c_str(),
+        database_.c_str(),
+        options_,
+        port_));
+    for (const string& statement : statements_) {
+        connection->cacheStatement(statement.c_str());
+    }
+    return connection;
+}
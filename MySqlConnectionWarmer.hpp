@@ -0,0 +1,81 @@
+#ifndef MYSQL_CONNECTION_WARMER_HPP_
+#define MYSQL_CONNECTION_WARMER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MySql.hpp"
+#include "MySqlOptions.hpp"
+
+/**
+ * Opens a set of connections at startup, several at a time, and prepares a
+ * list of statements on each of them, so that the first real request doesn't
+ * wait for a connect or a prepare. The statements are cached on each
+ * connection; see MySql::cacheStatement.
+ *
+ *     MySqlConnectionWarmer warmer("db.example.com", "user", "password", "db");
+ *     warmer.loadManifest("statements.sql");
+ *     warmer.addStatement("SELECT name FROM user WHERE id = ?");
+ *     std::vector<MySql> pool(warmer.open(32));
+ */
+class MySqlConnectionWarmer {
+    public:
+        /**
+         * The connections are opened with these parameters. See MySql.
+         */
+        MySqlConnectionWarmer(
+            const char* hostname,
+            const char* username,
+            const char* password,
+            const char* database,
+            const MySqlOptions& options = MySqlOptions(),
+            uint16_t port = 3306);
+
+        MySqlConnectionWarmer(const MySqlConnectionWarmer& rhs) = delete;
+        MySqlConnectionWarmer(MySqlConnectionWarmer&& rhs) = delete;
+        MySqlConnectionWarmer& operator=(
+            const MySqlConnectionWarmer& rhs) = delete;
+        MySqlConnectionWarmer& operator=(
+            MySqlConnectionWarmer&& rhs) = delete;
+
+        /**
+         * Adds a statement to prepare on every connection.
+         */
+        void addStatement(const char* query);
+        /**
+         * Adds every statement in a manifest file, one per line. Blank lines
+         * and lines starting with # or -- are skipped.
+         */
+        void loadManifest(const char* path);
+        const std::vector<std::string>& getStatements() const;
+
+        /**
+         * How many connections are opened at once. Defaults to 8.
+         */
+        void setMaximumThreads(size_t threads);
+
+        /**
+         * Opens connections and prepares the statements on each. If any
+         * connection or statement fails, the connections that were opened
+         * are closed and the first error is rethrown.
+         */
+        std::vector<MySql> open(size_t connectionCount) const;
+
+    private:
+        std::unique_ptr<MySql> openOne() const;
+
+        const std::string hostname_;
+        const std::string username_;
+        const std::string password_;
+        const std::string database_;
+        const MySqlOptions options_;
+        const uint16_t port_;
+        std::vector<std::string> statements_;
+        size_t maximumThreads_;
+};
+
+#endif  // MYSQL_CONNECTION_WARMER_HPP_
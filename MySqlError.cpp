@@ -0,0 +1,134 @@
+#include "MySqlError.hpp"
+#include "MySqlException.hpp"
+#include "MySqlPreparedStatement.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <mysql/errmsg.h>
+#include <mysql/mysql.h>
+
+#include <string>
+#include <utility>
+
+using std::move;
+using std::string;
+
+
+// SQLSTATE for "no error"
+static const char* const SUCCESS_SQL_STATE = "00000";
+
+
+static void copySqlState(char* const destination, const char* const source) {
+    strncpy(destination, source, SQLSTATE_LENGTH);
+    destination[SQLSTATE_LENGTH] = '\0';
+}
+
+
+MySqlError::MySqlError()
+    : errorNumber_(0)
+    , sqlState_()
+    , connection_(nullptr)
+    , statement_(nullptr)
+    , message_()
+{
+    copySqlState(sqlState_, SUCCESS_SQL_STATE);
+}
+
+
+MySqlError::MySqlError(MYSQL* const connection)
+    : errorNumber_(mysql_errno(connection))
+    , sqlState_()
+    , connection_(connection)
+    , statement_(nullptr)
+    , message_()
+{
+    assert(nullptr != connection);
+    copySqlState(sqlState_, mysql_sqlstate(connection));
+    // This is only created after a call has failed
+    if (0 == errorNumber_) {
+        errorNumber_ = CR_UNKNOWN_ERROR;
+    }
+}
+
+
+MySqlError::MySqlError(const MySqlPreparedStatement& statement)
+    : errorNumber_(mysql_stmt_errno(statement.statementHandle_))
+    , sqlState_()
+    , connection_(nullptr)
+    , statement_(statement.statementHandle_)
+    , message_()
+{
+    copySqlState(sqlState_, mysql_stmt_sqlstate(statement_));
+    if (0 == errorNumber_) {
+        errorNumber_ = CR_UNKNOWN_ERROR;
+    }
+}
+
+
+MySqlError::MySqlError(const MySqlError& rhs)
+    : errorNumber_(rhs.errorNumber_)
+    , sqlState_()
+    , connection_(nullptr)
+    , statement_(nullptr)
+    , message_(rhs.getMessage())
+{
+    copySqlState(sqlState_, rhs.sqlState_);
+}
+
+
+MySqlError::MySqlError(MySqlError&& rhs)
+    : errorNumber_(rhs.errorNumber_)
+    , sqlState_()
+    , connection_(rhs.connection_)
+    , statement_(rhs.statement_)
+    , message_(move(rhs.message_))
+{
+    copySqlState(sqlState_, rhs.sqlState_);
+}
+
+
+MySqlError& MySqlError::operator=(const MySqlError& rhs) {
+    if (this != &rhs) {
+        errorNumber_ = rhs.errorNumber_;
+        copySqlState(sqlState_, rhs.sqlState_);
+        message_ = rhs.getMessage();
+        connection_ = nullptr;
+        statement_ = nullptr;
+    }
+    return *this;
+}
+
+
+MySqlError& MySqlError::operator=(MySqlError&& rhs) {
+    if (this != &rhs) {
+        errorNumber_ = rhs.errorNumber_;
+        copySqlState(sqlState_, rhs.sqlState_);
+        message_ = move(rhs.message_);
+        connection_ = rhs.connection_;
+        statement_ = rhs.statement_;
+    }
+    return *this;
+}
+
+
+const char* MySqlError::getMessage() const {
+    if (nullptr != statement_) {
+        return MySqlException::getServerErrorMessage(statement_);
+    }
+    if (nullptr != connection_) {
+        return MySqlException::getServerErrorMessage(connection_);
+    }
+    return message_.c_str();
+}
+
+
+void MySqlError::saveMessage() const {
+    message_ = getMessage();
+    connection_ = nullptr;
+    statement_ = nullptr;
+}
+
+
+MySqlException MySqlError::toException() const {
+    return MySqlException(string(getMessage()), errorNumber_, sqlState_);
+}
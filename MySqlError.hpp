@@ -0,0 +1,128 @@
+#ifndef MYSQL_ERROR_HPP_
+#define MYSQL_ERROR_HPP_
+
+#include <mysql/mysql.h>
+
+#include <string>
+#include <utility>
+
+#include "MySqlException.hpp"
+
+class MySqlPreparedStatement;
+
+/**
+ * An error from the server or the connection, returned instead of thrown by
+ * MySql::tryRunCommand and MySql::tryRunQuery. Creating one copies the error
+ * number and SQLSTATE, but not the message, which is only read from the
+ * connection when it's asked for. Ask for it before the next call on the same
+ * connection or statement, or before the statement is destroyed, or it may
+ * have been overwritten or freed; copying the error reads it first. Errors
+ * from the overloads that take query text have already read it, because
+ * those statements are destroyed before the error is returned.
+ */
+class MySqlError {
+    public:
+        /**
+         * No error.
+         */
+        MySqlError();
+        /**
+         * The last error on the connection or statement.
+         */
+        /// @{
+        explicit MySqlError(MYSQL* connection);
+        explicit MySqlError(const MySqlPreparedStatement& statement);
+        /// @}
+
+        MySqlError(const MySqlError& rhs);
+        MySqlError(MySqlError&& rhs);
+        MySqlError& operator=(const MySqlError& rhs);
+        MySqlError& operator=(MySqlError&& rhs);
+
+        /**
+         * If there's an error.
+         */
+        explicit operator bool() const {
+            return 0 != errorNumber_;
+        }
+
+        /**
+         * The client or server error number, e.g. ER_DUP_ENTRY. 0 if there's
+         * no error.
+         */
+        unsigned int getErrorNumber() const {
+            return errorNumber_;
+        }
+
+        /**
+         * The five character SQLSTATE, e.g. "23000".
+         */
+        const char* getSqlState() const {
+            return sqlState_;
+        }
+
+        const char* getMessage() const;
+
+        /**
+         * Reads the message now, so that it survives later calls on the
+         * connection.
+         */
+        void saveMessage() const;
+
+        MySqlException toException() const;
+
+    private:
+        unsigned int errorNumber_;
+        char sqlState_[SQLSTATE_LENGTH + 1];
+        // Where the message is read from, until it's been saved
+        mutable MYSQL* connection_;
+        mutable MYSQL_STMT* statement_;
+        mutable std::string message_;
+};
+
+
+/**
+ * Either a value or the MySqlError that kept it from being produced.
+ */
+template <typename T>
+class MySqlExpected {
+    public:
+        explicit MySqlExpected(T value)
+            : value_(std::move(value))
+            , error_()
+        {
+        }
+
+        explicit MySqlExpected(MySqlError error)
+            : value_()
+            , error_(std::move(error))
+        {
+        }
+
+        /**
+         * If there's a value, i.e. there wasn't an error.
+         */
+        explicit operator bool() const {
+            return !error_;
+        }
+
+        /**
+         * Returns the value, or throws the error.
+         */
+        const T& getValue() const {
+            if (error_) {
+                throw error_.toException();
+            }
+            return value_;
+        }
+
+        const MySqlError& getError() const {
+            return error_;
+        }
+
+    private:
+        T value_;
+        MySqlError error_;
+};
+
+#endif  // MYSQL_ERROR_HPP_
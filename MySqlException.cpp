@@ -1,26 +1,54 @@
 #include "MySqlException.hpp"
 #include "MySqlPreparedStatement.hpp"
 
+#include <cstring>
 #include <mysql/mysql.h>
 #include <string>
 
 using std::string;
 
+// SQLSTATE for "general error", which MySQL uses for errors that don't have
+// their own
+static const char* const GENERAL_ERROR_SQL_STATE = "HY000";
+
+
 MySqlException::MySqlException(const string& message)
     : message_(message)
+    , errorNumber_(0)
+    , sqlState_()
+{
+    setSqlState(GENERAL_ERROR_SQL_STATE);
+}
+
+
+MySqlException::MySqlException(
+    const string& message,
+    const unsigned int errorNumber,
+    const char* const sqlState
+)
+    : message_(message)
+    , errorNumber_(errorNumber)
+    , sqlState_()
 {
+    setSqlState(sqlState);
 }
 
 
 MySqlException::MySqlException(const MYSQL* const connection)
     : message_(getServerErrorMessage(connection))
+    , errorNumber_(mysql_errno(const_cast<MYSQL*>(connection)))
+    , sqlState_()
 {
+    setSqlState(mysql_sqlstate(const_cast<MYSQL*>(connection)));
 }
 
 
 MySqlException::MySqlException(const MySqlPreparedStatement& statement)
     : message_(getServerErrorMessage(statement.statementHandle_))
+    , errorNumber_(mysql_stmt_errno(statement.statementHandle_))
+    , sqlState_()
 {
+    setSqlState(mysql_stmt_sqlstate(statement.statementHandle_));
 }
 
 
@@ -33,6 +61,22 @@ const char* MySqlException::what() const noexcept {
 }
 
 
+unsigned int MySqlException::getErrorNumber() const noexcept {
+    return errorNumber_;
+}
+
+
+const char* MySqlException::getSqlState() const noexcept {
+    return sqlState_;
+}
+
+
+void MySqlException::setSqlState(const char* const sqlState) {
+    strncpy(sqlState_, sqlState, SQLSTATE_LENGTH);
+    sqlState_[SQLSTATE_LENGTH] = '\0';
+}
+
+
 const char* MySqlException::getServerErrorMessage(const MYSQL* const conn) {
     // This error should be unique per connection, so it should be thread safe
     // The MySQL C interface is backward compatible with C89, so it doesn't
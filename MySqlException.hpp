@@ -8,9 +8,18 @@
 
 class MySqlPreparedStatement;
 
+/**
+ * Errors from the server and the client library keep their error number and
+ * SQLSTATE, so callers can tell them apart without parsing the message. Other
+ * errors, such as binding the wrong number of arguments, have error number 0.
+ */
 class MySqlException : public std::exception {
     public:
         explicit MySqlException(const std::string& message);
+        MySqlException(
+            const std::string& message,
+            unsigned int errorNumber,
+            const char* sqlState);
         explicit MySqlException(const MYSQL* const connection);
         explicit MySqlException(const MySqlPreparedStatement& statement);
         ~MySqlException() noexcept;
@@ -20,12 +29,26 @@ class MySqlException : public std::exception {
 
         const char* what() const noexcept;
 
+        /**
+         * The client or server error number, e.g. ER_LOCK_DEADLOCK, or 0 if
+         * the error didn't come from MySQL.
+         */
+        unsigned int getErrorNumber() const noexcept;
+        /**
+         * The five character SQLSTATE, e.g. "40001".
+         */
+        const char* getSqlState() const noexcept;
+
         static const char* getServerErrorMessage(
             const MYSQL* const connection);
         static const char* getServerErrorMessage(
             const MYSQL_STMT* const statement);
     private:
+        void setSqlState(const char* sqlState);
+
         const std::string message_;
+        const unsigned int errorNumber_;
+        char sqlState_[SQLSTATE_LENGTH + 1];
 };
 
 #endif  // MY_SQL_EXCEPTION_HPP_
@@ -0,0 +1,565 @@
+#include "MySqlException.hpp"
+#include "MySqlExportSink.hpp"
+#include "MySqlPreparedStatement.hpp"
+#include "OutputBinder.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <mysql/mysql.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+using std::numeric_limits;
+using std::string;
+using std::vector;
+
+typedef MySqlExportSink::Column Column;
+typedef MySqlExportSink::ColumnType ColumnType;
+
+// Rows are written to the file once the buffer has this much in it
+static const size_t WRITE_BYTES = 1024 * 1024;
+// Text columns start with buffers this big and grow as needed
+static const size_t INITIAL_TEXT_BYTES = 64;
+
+
+static string getSystemErrorMessage(
+    const char* const action,
+    const int error
+) {
+    string message(action);
+    message += ": ";
+    message += std::strerror(error);
+    return message;
+}
+
+
+MySqlExportSink::MySqlExportSink(const char* const path)
+    : buffer_()
+    , fileDescriptor_(-1)
+    , toMemory_(nullptr == path)
+{
+    if (!toMemory_) {
+        fileDescriptor_ = open(
+            path,
+            O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            0644);
+        if (-1 == fileDescriptor_) {
+            throw MySqlException(getSystemErrorMessage(
+                "Unable to open export file",
+                errno));
+        }
+        // Leave room for the last row to run over
+        buffer_.reserve(WRITE_BYTES * 2);
+    }
+}
+
+
+MySqlExportSink::~MySqlExportSink() {
+    if (-1 != fileDescriptor_) {
+        try {
+            writeBuffer();
+        } catch (const MySqlException&) {
+            // Destructors can't throw; call close to see errors
+        }
+        ::close(fileDescriptor_);
+    }
+}
+
+
+my_ulonglong MySqlExportSink::writeResults(
+    const MySqlPreparedStatement& statement
+) {
+    const vector<Column> columns(getColumns(statement));
+    writeHeader(columns);
+
+    vector<MYSQL_BIND> parameters(columns.size());
+    vector<vector<char>> buffers(columns.size());
+    vector<mysql_bind_length_t> lengths(columns.size());
+    vector<my_bool> nullFlags(columns.size());
+    for (size_t i = 0; i < columns.size(); ++i) {
+        MYSQL_BIND& bind = parameters.at(i);
+        vector<char>& buffer = buffers.at(i);
+        switch (columns.at(i).type) {
+            case ColumnType::INTEGER:
+            case ColumnType::UNSIGNED_INTEGER:
+                bind.buffer_type = MYSQL_TYPE_LONGLONG;
+                bind.is_unsigned =
+                    ColumnType::UNSIGNED_INTEGER == columns.at(i).type;
+                buffer.resize(sizeof(int64_t));
+                break;
+            case ColumnType::REAL:
+                bind.buffer_type = MYSQL_TYPE_DOUBLE;
+                buffer.resize(sizeof(double));
+                break;
+            case ColumnType::DECIMAL:
+            case ColumnType::TEXT:
+                bind.buffer_type = MYSQL_TYPE_STRING;
+                buffer.resize(INITIAL_TEXT_BYTES);
+                break;
+            default:
+                assert(false && "Unknown column type");
+                break;
+        }
+        bind.buffer = buffer.data();
+        bind.buffer_length = buffer.size();
+        bind.is_null = &nullFlags.at(i);
+    }
+
+    my_ulonglong rowCount = 0;
+    OutputBinderPrivate::fetchRows(
+        statement,
+        &parameters,
+        &buffers,
+        &lengths,
+        [this, &columns, &rowCount](const vector<MYSQL_BIND>& row) {
+            writeRow(columns, row);
+            ++rowCount;
+            flushIfFull();
+        });
+    return rowCount;
+}
+
+
+void MySqlExportSink::close() {
+    if (-1 == fileDescriptor_) {
+        return;
+    }
+    writeBuffer();
+    const int fileDescriptor = fileDescriptor_;
+    fileDescriptor_ = -1;
+    if (0 != ::close(fileDescriptor)) {
+        throw MySqlException(getSystemErrorMessage(
+            "Unable to close export file",
+            errno));
+    }
+}
+
+
+const string& MySqlExportSink::getOutput() const {
+    return buffer_;
+}
+
+
+void MySqlExportSink::append(const char* const data, const size_t length) {
+    buffer_.append(data, length);
+}
+
+
+void MySqlExportSink::append(const char c) {
+    buffer_.push_back(c);
+}
+
+
+void MySqlExportSink::appendInteger(const int64_t value) {
+    if (value < 0) {
+        buffer_.push_back('-');
+        // Negating in unsigned arithmetic works for the minimum value too
+        appendUnsignedInteger(0 - static_cast<uint64_t>(value));
+    } else {
+        appendUnsignedInteger(static_cast<uint64_t>(value));
+    }
+}
+
+
+void MySqlExportSink::appendUnsignedInteger(uint64_t value) {
+    char digits[numeric_limits<uint64_t>::digits10 + 1];
+    char* const end = digits + sizeof(digits);
+    char* begin = end;
+    do {
+        --begin;
+        *begin = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (0 != value);
+    buffer_.append(begin, static_cast<size_t>(end - begin));
+}
+
+
+void MySqlExportSink::appendReal(const double value) {
+    // Use the shorter form if it reads back as the same number
+    char text[32];
+    int length = std::snprintf(text, sizeof(text), "%.15g", value);
+    const double parsed = std::strtod(text, nullptr);
+    if (std::isfinite(value) && (parsed < value || parsed > value)) {
+        length = std::snprintf(text, sizeof(text), "%.17g", value);
+    }
+    assert(0 < length && static_cast<size_t>(length) < sizeof(text));
+    buffer_.append(text, static_cast<size_t>(length));
+}
+
+
+string* MySqlExportSink::getBuffer() {
+    return &buffer_;
+}
+
+
+bool MySqlExportSink::isNull(const MYSQL_BIND& bind) {
+    return 0 != *bind.is_null;
+}
+
+
+int64_t MySqlExportSink::getInteger(const MYSQL_BIND& bind) {
+    int64_t value;
+    std::memcpy(&value, bind.buffer, sizeof(value));
+    return value;
+}
+
+
+uint64_t MySqlExportSink::getUnsignedInteger(const MYSQL_BIND& bind) {
+    uint64_t value;
+    std::memcpy(&value, bind.buffer, sizeof(value));
+    return value;
+}
+
+
+double MySqlExportSink::getReal(const MYSQL_BIND& bind) {
+    double value;
+    std::memcpy(&value, bind.buffer, sizeof(value));
+    return value;
+}
+
+
+const char* MySqlExportSink::getText(const MYSQL_BIND& bind) {
+    return static_cast<const char*>(bind.buffer);
+}
+
+
+size_t MySqlExportSink::getTextLength(const MYSQL_BIND& bind) {
+    return *bind.length;
+}
+
+
+static ColumnType getColumnType(const MYSQL_FIELD& field) {
+    // Switched as an int because the field types depend on the client
+    // library version, and every type not listed here is fetched as text
+    switch (static_cast<int>(field.type)) {
+        case MYSQL_TYPE_TINY:
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_INT24:
+        case MYSQL_TYPE_LONG:
+        case MYSQL_TYPE_LONGLONG:
+        case MYSQL_TYPE_YEAR:
+            return 0 != (field.flags & UNSIGNED_FLAG)
+                ? ColumnType::UNSIGNED_INTEGER
+                : ColumnType::INTEGER;
+        case MYSQL_TYPE_FLOAT:
+        case MYSQL_TYPE_DOUBLE:
+            return ColumnType::REAL;
+        case MYSQL_TYPE_DECIMAL:
+        case MYSQL_TYPE_NEWDECIMAL:
+            return ColumnType::DECIMAL;
+        default:
+            return ColumnType::TEXT;
+    }
+}
+
+
+vector<Column> MySqlExportSink::getColumns(
+    const MySqlPreparedStatement& statement
+) {
+    MYSQL_RES* const metadata =
+        OutputBinderPrivate::Friend::getResultMetadata(statement);
+    vector<Column> columns;
+    try {
+        const unsigned int fieldCount = mysql_num_fields(metadata);
+        const MYSQL_FIELD* const fields = mysql_fetch_fields(metadata);
+        columns.reserve(fieldCount);
+        for (unsigned int i = 0; i < fieldCount; ++i) {
+            columns.push_back(Column{fields[i].name, getColumnType(fields[i])});
+        }
+    } catch (...) {
+        mysql_free_result(metadata);
+        throw;
+    }
+    mysql_free_result(metadata);
+    return columns;
+}
+
+
+void MySqlExportSink::flushIfFull() {
+    if (!toMemory_ && buffer_.size() >= WRITE_BYTES) {
+        writeBuffer();
+    }
+}
+
+
+void MySqlExportSink::writeBuffer() {
+    size_t written = 0;
+    while (written < buffer_.size()) {
+        const ssize_t status = write(
+            fileDescriptor_,
+            buffer_.data() + written,
+            buffer_.size() - written);
+        if (-1 == status) {
+            if (EINTR == errno) {
+                continue;
+            }
+            throw MySqlException(getSystemErrorMessage(
+                "Unable to write export file",
+                errno));
+        }
+        written += static_cast<size_t>(status);
+    }
+    // Keeps the capacity, so the buffer is only allocated once
+    buffer_.clear();
+}
+
+
+MySqlCsvSink::MySqlCsvSink(const char* const path)
+    : MySqlExportSink(path)
+{
+}
+
+
+void MySqlCsvSink::writeHeader(const vector<Column>& columns) {
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (0 != i) {
+            append(',');
+        }
+        appendField(columns.at(i).name.data(), columns.at(i).name.size());
+    }
+    append("\r\n", 2);
+}
+
+
+void MySqlCsvSink::writeRow(
+    const vector<Column>& columns,
+    const vector<MYSQL_BIND>& row
+) {
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (0 != i) {
+            append(',');
+        }
+        const MYSQL_BIND& bind = row.at(i);
+        if (isNull(bind)) {
+            continue;
+        }
+        switch (columns.at(i).type) {
+            case ColumnType::INTEGER:
+                appendInteger(getInteger(bind));
+                break;
+            case ColumnType::UNSIGNED_INTEGER:
+                appendUnsignedInteger(getUnsignedInteger(bind));
+                break;
+            case ColumnType::REAL:
+                appendReal(getReal(bind));
+                break;
+            case ColumnType::DECIMAL:
+                append(getText(bind), getTextLength(bind));
+                break;
+            case ColumnType::TEXT:
+                appendField(getText(bind), getTextLength(bind));
+                break;
+            default:
+                assert(false && "Unknown column type");
+                break;
+        }
+    }
+    append("\r\n", 2);
+}
+
+
+void MySqlCsvSink::appendField(const char* const data, const size_t length) {
+    // Empty strings are quoted so that they aren't read back as NULL
+    bool needsQuotes = 0 == length;
+    for (size_t i = 0; i < length && !needsQuotes; ++i) {
+        const char c = data[i];
+        needsQuotes = ',' == c || '"' == c || '\n' == c || '\r' == c;
+    }
+    if (!needsQuotes) {
+        append(data, length);
+        return;
+    }
+
+    append('"');
+    size_t start = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if ('"' == data[i]) {
+            // Quotes are escaped by doubling them
+            append(data + start, i + 1 - start);
+            start = i;
+        }
+    }
+    append(data + start, length - start);
+    append('"');
+}
+
+
+/**
+ * Appends a quoted, escaped JSON string.
+ */
+static void appendJsonString(
+    const char* const data,
+    const size_t length,
+    string* const out
+) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    out->push_back('"');
+    size_t start = 0;
+    for (size_t i = 0; i < length; ++i) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        if ('"' != c && '\\' != c && c >= 0x20) {
+            continue;
+        }
+        out->append(data + start, i - start);
+        start = i + 1;
+        switch (c) {
+            case '"':
+                out->append("\\\"");
+                break;
+            case '\\':
+                out->append("\\\\");
+                break;
+            case '\n':
+                out->append("\\n");
+                break;
+            case '\r':
+                out->append("\\r");
+                break;
+            case '\t':
+                out->append("\\t");
+                break;
+            default:
+                out->append("\\u00");
+                out->push_back(HEX_DIGITS[c >> 4]);
+                out->push_back(HEX_DIGITS[c & 0xF]);
+                break;
+        }
+    }
+    out->append(data + start, length - start);
+    out->push_back('"');
+}
+
+
+MySqlJsonLinesSink::MySqlJsonLinesSink(const char* const path)
+    : MySqlExportSink(path)
+    , keys_()
+{
+}
+
+
+void MySqlJsonLinesSink::writeHeader(const vector<Column>& columns) {
+    keys_.clear();
+    keys_.reserve(columns.size());
+    for (const auto& column : columns) {
+        string key;
+        appendJsonString(column.name.data(), column.name.size(), &key);
+        key.push_back(':');
+        keys_.push_back(key);
+    }
+}
+
+
+void MySqlJsonLinesSink::writeRow(
+    const vector<Column>& columns,
+    const vector<MYSQL_BIND>& row
+) {
+    append('{');
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (0 != i) {
+            append(',');
+        }
+        append(keys_.at(i).data(), keys_.at(i).size());
+        const MYSQL_BIND& bind = row.at(i);
+        if (isNull(bind)) {
+            append("null", 4);
+            continue;
+        }
+        switch (columns.at(i).type) {
+            case ColumnType::INTEGER:
+                appendInteger(getInteger(bind));
+                break;
+            case ColumnType::UNSIGNED_INTEGER:
+                appendUnsignedInteger(getUnsignedInteger(bind));
+                break;
+            case ColumnType::REAL:
+                // JSON has no NaN or infinity
+                if (std::isfinite(getReal(bind))) {
+                    appendReal(getReal(bind));
+                } else {
+                    append("null", 4);
+                }
+                break;
+            case ColumnType::DECIMAL:
+                append(getText(bind), getTextLength(bind));
+                break;
+            case ColumnType::TEXT:
+                appendJsonString(
+                    getText(bind),
+                    getTextLength(bind),
+                    getBuffer());
+                break;
+            default:
+                assert(false && "Unknown column type");
+                break;
+        }
+    }
+    append("}\n", 2);
+}
+
+
+MySqlBinarySink::MySqlBinarySink(const char* const path)
+    : MySqlExportSink(path)
+{
+}
+
+
+void MySqlBinarySink::writeHeader(const vector<Column>& columns) {
+    static const char MAGIC[] = "MYSQLCPP1";
+    append(MAGIC, sizeof(MAGIC) - 1);
+    appendLength(columns.size());
+    for (const auto& column : columns) {
+        append(static_cast<char>(column.type));
+        appendLength(column.name.size());
+        append(column.name.data(), column.name.size());
+    }
+}
+
+
+void MySqlBinarySink::writeRow(
+    const vector<Column>& columns,
+    const vector<MYSQL_BIND>& row
+) {
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const MYSQL_BIND& bind = row.at(i);
+        if (isNull(bind)) {
+            append('\1');
+            continue;
+        }
+        append('\0');
+        switch (columns.at(i).type) {
+            case ColumnType::INTEGER:
+            case ColumnType::UNSIGNED_INTEGER:
+            case ColumnType::REAL:
+                // These are all fetched into 8 byte buffers
+                append(static_cast<const char*>(bind.buffer), 8);
+                break;
+            case ColumnType::DECIMAL:
+            case ColumnType::TEXT:
+                appendLength(getTextLength(bind));
+                append(getText(bind), getTextLength(bind));
+                break;
+            default:
+                assert(false && "Unknown column type");
+                break;
+        }
+    }
+}
+
+
+void MySqlBinarySink::appendLength(const size_t length) {
+    if (length > numeric_limits<uint32_t>::max()) {
+        throw MySqlException("Value is too long for the binary export format");
+    }
+    const uint32_t length32 = static_cast<uint32_t>(length);
+    char bytes[sizeof(length32)];
+    std::memcpy(bytes, &length32, sizeof(length32));
+    append(bytes, sizeof(bytes));
+}
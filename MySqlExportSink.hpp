@@ -0,0 +1,186 @@
+#ifndef MYSQL_EXPORT_SINK_HPP_
+#define MYSQL_EXPORT_SINK_HPP_
+
+#include <cstdint>
+#include <mysql/mysql.h>
+
+#include <string>
+#include <vector>
+
+#include "MySqlPreparedStatement.hpp"
+
+/**
+ * Writes query results straight from the fetched MYSQL_BIND buffers into a
+ * large output buffer, without building tuples first. Each row is formatted
+ * in place, so once the buffers have grown to fit the widest row, exporting
+ * doesn't allocate.
+ *
+ * The output goes to a file, written whenever the buffer fills up, or is
+ * kept in memory if no file name is given. Use it with MySql::runExport:
+ *
+ *     MySqlCsvSink sink("users.csv");
+ *     connection.runExport(&sink, "SELECT id, name FROM user");
+ *     sink.close();
+ */
+class MySqlExportSink {
+    public:
+        /**
+         * How a column is fetched and written.
+         */
+        enum class ColumnType {
+            INTEGER,
+            UNSIGNED_INTEGER,
+            REAL,
+            // Exact numbers, like DECIMAL, fetched as their text
+            DECIMAL,
+            TEXT
+        };
+
+        struct Column {
+            std::string name;
+            ColumnType type;
+        };
+
+        virtual ~MySqlExportSink();
+
+        MySqlExportSink(const MySqlExportSink& rhs) = delete;
+        MySqlExportSink(MySqlExportSink&& rhs) = delete;
+        MySqlExportSink& operator=(const MySqlExportSink& rhs) = delete;
+        MySqlExportSink& operator=(MySqlExportSink&& rhs) = delete;
+
+        /**
+         * Fetches every row of an executed statement and writes it.
+         * @return The number of rows written.
+         */
+        my_ulonglong writeResults(const MySqlPreparedStatement& statement);
+
+        /**
+         * Writes anything that's still buffered and closes the file. Errors
+         * are thrown from here; the destructor closes the file silently.
+         */
+        void close();
+
+        /**
+         * The output so far, if no file name was given.
+         */
+        const std::string& getOutput() const;
+
+    protected:
+        /**
+         * @param path The file to write to, or nullptr to keep the output in
+         *     memory.
+         */
+        explicit MySqlExportSink(const char* path);
+
+        /**
+         * Called once per result set, before any rows.
+         */
+        virtual void writeHeader(const std::vector<Column>& columns) = 0;
+        /**
+         * Called for each row, with the columns' binds in order.
+         */
+        virtual void writeRow(
+            const std::vector<Column>& columns,
+            const std::vector<MYSQL_BIND>& row) = 0;
+
+        /**
+         * Formatting helpers for subclasses.
+         */
+        /// @{
+        void append(const char* data, size_t length);
+        void append(char c);
+        void appendInteger(int64_t value);
+        void appendUnsignedInteger(uint64_t value);
+        void appendReal(double value);
+        /**
+         * The output buffer, for formatting that the helpers don't cover.
+         */
+        std::string* getBuffer();
+        /// @}
+
+        /**
+         * Accessors for the bound values. getText also works for DECIMAL
+         * columns.
+         */
+        /// @{
+        static bool isNull(const MYSQL_BIND& bind);
+        static int64_t getInteger(const MYSQL_BIND& bind);
+        static uint64_t getUnsignedInteger(const MYSQL_BIND& bind);
+        static double getReal(const MYSQL_BIND& bind);
+        static const char* getText(const MYSQL_BIND& bind);
+        static size_t getTextLength(const MYSQL_BIND& bind);
+        /// @}
+
+    private:
+        static std::vector<Column> getColumns(
+            const MySqlPreparedStatement& statement);
+        void flushIfFull();
+        void writeBuffer();
+
+        std::string buffer_;
+        int fileDescriptor_;
+        bool toMemory_;
+};
+
+
+/**
+ * RFC 4180 CSV with a header line. Fields with commas, quotes or line breaks
+ * are quoted. NULL is an empty field and an empty string is "", so they can
+ * be told apart.
+ */
+class MySqlCsvSink : public MySqlExportSink {
+    public:
+        explicit MySqlCsvSink(const char* path = nullptr);
+
+    private:
+        void writeHeader(const std::vector<Column>& columns) override;
+        void writeRow(
+            const std::vector<Column>& columns,
+            const std::vector<MYSQL_BIND>& row) override;
+        void appendField(const char* data, size_t length);
+};
+
+
+/**
+ * One JSON object per line, keyed by column name. Numbers are written
+ * unquoted, including DECIMAL columns, so that no precision is lost. Text is
+ * written as it is apart from escaping, so it needs to be UTF-8.
+ */
+class MySqlJsonLinesSink : public MySqlExportSink {
+    public:
+        explicit MySqlJsonLinesSink(const char* path = nullptr);
+
+    private:
+        void writeHeader(const std::vector<Column>& columns) override;
+        void writeRow(
+            const std::vector<Column>& columns,
+            const std::vector<MYSQL_BIND>& row) override;
+
+        // The escaped, quoted key and colon for each column, so that rows
+        // don't need to escape the names again
+        std::vector<std::string> keys_;
+};
+
+
+/**
+ * A compact binary format in native byte order:
+ *
+ *     "MYSQLCPP1"
+ *     uint32 column count
+ *     per column: uint8 column type, uint32 name length, name
+ *     per row, per column: uint8 null flag, then if not null an 8 byte
+ *         integer or double, or a uint32 length and the bytes
+ */
+class MySqlBinarySink : public MySqlExportSink {
+    public:
+        explicit MySqlBinarySink(const char* path = nullptr);
+
+    private:
+        void writeHeader(const std::vector<Column>& columns) override;
+        void writeRow(
+            const std::vector<Column>& columns,
+            const std::vector<MYSQL_BIND>& row) override;
+        void appendLength(size_t length);
+};
+
+#endif  // MYSQL_EXPORT_SINK_HPP_
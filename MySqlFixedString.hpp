@@ -0,0 +1,119 @@
+#ifndef MYSQL_FIXED_STRING_HPP_
+#define MYSQL_FIXED_STRING_HPP_
+
+#include <cstddef>
+#include <cstring>
+#include <mysql/mysql.h>
+
+#include <boost/lexical_cast.hpp>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "MySqlException.hpp"
+#include "OutputBinder.hpp"
+
+/**
+ * A string of at most N bytes stored inline, for short columns like country
+ * codes, statuses and hashes, so that reading them doesn't allocate. Columns
+ * are bound to a buffer of exactly N bytes that's shared by every row, and a
+ * value that doesn't fit throws without being refetched.
+ *
+ *     std::vector<std::tuple<int64_t, MySqlFixedString<2>>> countries;
+ *     connection.runQuery(&countries, "SELECT id, country_code FROM user");
+ */
+template <size_t N>
+class MySqlFixedString {
+    public:
+        static_assert(N > 0, "MySqlFixedString needs room for a character");
+
+        MySqlFixedString()
+            : size_(0)
+            , data_()
+        {
+        }
+
+        explicit MySqlFixedString(const std::string& value)
+            : size_(0)
+            , data_()
+        {
+            assign(value.data(), value.size());
+        }
+
+        /**
+         * @throws MySqlException If size is more than N.
+         */
+        void assign(const char* const data, const size_t size) {
+            if (size > N) {
+                std::string errorMessage("Value of length ");
+                errorMessage += boost::lexical_cast<std::string>(size);
+                errorMessage += " doesn't fit in MySqlFixedString<";
+                errorMessage += boost::lexical_cast<std::string>(N);
+                errorMessage += ">";
+                throw MySqlException(errorMessage);
+            }
+            memcpy(data_, data, size);
+            size_ = size;
+        }
+
+        const char* data() const { return data_; }
+        size_t size() const { return size_; }
+        static size_t capacity() { return N; }
+        std::string str() const { return std::string(data_, size_); }
+
+        bool operator==(const MySqlFixedString& rhs) const {
+            return size_ == rhs.size_ && 0 == memcmp(data_, rhs.data_, size_);
+        }
+        bool operator!=(const MySqlFixedString& rhs) const {
+            return !(*this == rhs);
+        }
+
+    private:
+        size_t size_;
+        // Not null terminated
+        char data_[N];
+};
+
+
+namespace OutputBinderPrivate {
+
+template <size_t N>
+class OutputBinderParameterSetter<MySqlFixedString<N>> {
+    public:
+        static void setParameter(
+            MYSQL_BIND* const bind,
+            std::vector<char>* const buffer,
+            my_bool* const isNullFlag
+        ) {
+            bind->buffer_type = MYSQL_TYPE_STRING;
+            buffer->resize(N);
+            bind->buffer = buffer->data();
+            bind->is_null = isNullFlag;
+            bind->buffer_length = N;
+        }
+};
+
+template <size_t N>
+struct OutputBinderFixedCapacity<MySqlFixedString<N>> : std::true_type {};
+
+template <size_t N>
+class OutputBinderResultSetter<MySqlFixedString<N>> {
+    public:
+        /**
+         * Truncated values aren't refetched, but bind.length is still the
+         * value's full length, so assign throws if the value didn't fit.
+         */
+        static void setResult(
+            MySqlFixedString<N>* const value,
+            const MYSQL_BIND& bind
+        ) {
+            if (*bind.is_null) {
+                throw MySqlException(NULL_VALUE_ERROR_MESSAGE);
+            }
+            value->assign(static_cast<const char*>(bind.buffer), *bind.length);
+        }
+};
+
+}  // namespace OutputBinderPrivate
+
+#endif  // MYSQL_FIXED_STRING_HPP_
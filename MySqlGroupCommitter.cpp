@@ -0,0 +1,189 @@
+#include "MySqlException.hpp"
+#include "MySqlGroupCommitter.hpp"
+#include "MySqlTransaction.hpp"
+
+#include <mysql/mysql.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+using std::current_exception;
+using std::future;
+using std::lock_guard;
+using std::min;
+using std::move;
+using std::mutex;
+using std::thread;
+using std::unique_lock;
+using std::unique_ptr;
+using std::vector;
+
+
+MySqlGroupCommitter::Request::Request(Command command)
+    : command_(move(command))
+    , promise_()
+    , enqueued_(steady_clock::now())
+{
+}
+
+
+MySqlGroupCommitter::MySqlGroupCommitter(
+    unique_ptr<MySql> connection,
+    const size_t maximumStatements,
+    const microseconds maximumDelay
+)
+    : connection_(move(connection))
+    , maximumStatements_(maximumStatements)
+    , maximumDelay_(maximumDelay)
+    , mutex_()
+    , workAvailable_()
+    , batchCommitted_()
+    , pending_()
+    , submitted_(0)
+    , completed_(0)
+    , flushWaiters_(0)
+    , stopping_(false)
+    , worker_()
+{
+    if (nullptr == connection_) {
+        throw MySqlException("Group committer connection is required");
+    }
+    if (0 == maximumStatements_) {
+        throw MySqlException("Group commit batches need at least 1 statement");
+    }
+    // Start the thread last so that it never sees a partially constructed
+    // object
+    worker_ = thread(&MySqlGroupCommitter::run, this);
+}
+
+
+MySqlGroupCommitter::~MySqlGroupCommitter() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workAvailable_.notify_one();
+    worker_.join();
+}
+
+
+void MySqlGroupCommitter::enqueue(
+    Command command,
+    future<my_ulonglong>* const result
+) {
+    lock_guard<mutex> lock(mutex_);
+    if (stopping_) {
+        throw MySqlException("Group committer is stopping");
+    }
+    pending_.emplace_back(move(command));
+    *result = pending_.back().promise_.get_future();
+    ++submitted_;
+    // Only wake up the worker if it can do something right away; otherwise
+    // it's already waiting for the oldest request's deadline
+    if (1 == pending_.size() || pending_.size() >= maximumStatements_) {
+        workAvailable_.notify_one();
+    }
+}
+
+
+void MySqlGroupCommitter::flush() {
+    unique_lock<mutex> lock(mutex_);
+    const uint64_t target = submitted_;
+    ++flushWaiters_;
+    workAvailable_.notify_one();
+    batchCommitted_.wait(lock, [this, target]() {
+        return completed_ >= target;
+    });
+    --flushWaiters_;
+}
+
+
+void MySqlGroupCommitter::run() {
+    unique_lock<mutex> lock(mutex_);
+    while (true) {
+        workAvailable_.wait(lock, [this]() {
+            return stopping_ || !pending_.empty();
+        });
+        if (pending_.empty()) {
+            // Stopping and there's nothing left to commit
+            return;
+        }
+
+        // Wait for the batch to fill up, unless somebody wants it now. The
+        // oldest request might have been queued while the last batch was
+        // committing, in which case its deadline might have passed already.
+        const steady_clock::time_point deadline =
+            pending_.front().enqueued_ + maximumDelay_;
+        workAvailable_.wait_until(lock, deadline, [this]() {
+            return stopping_
+                || 0 != flushWaiters_
+                || pending_.size() >= maximumStatements_;
+        });
+
+        vector<Request> batch;
+        const size_t batchSize = min(pending_.size(), maximumStatements_);
+        batch.reserve(batchSize);
+        for (size_t i = 0; i < batchSize; ++i) {
+            batch.push_back(move(pending_.front()));
+            pending_.pop_front();
+        }
+
+        lock.unlock();
+        commitBatch(&batch);
+        lock.lock();
+
+        completed_ += batch.size();
+        batchCommitted_.notify_all();
+    }
+}
+
+
+void MySqlGroupCommitter::commitBatch(vector<Request>* const batch) {
+    vector<my_ulonglong> affectedRows;
+    affectedRows.reserve(batch->size());
+    try {
+        MySqlTransaction transaction(connection_.get());
+        for (auto& request : *batch) {
+            affectedRows.push_back(request.command_(*connection_));
+        }
+        transaction.commit();
+    } catch (...) {
+        if (affectedRows.size() < batch->size()) {
+            // One of the commands failed and the transaction destructor
+            // rolled back the rest, so run them one at a time to find out
+            // which ones fail
+            runIndividually(batch);
+        } else {
+            // Nobody knows if the commit happened, so everybody has to find
+            // out
+            for (auto& request : *batch) {
+                request.promise_.set_exception(current_exception());
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < batch->size(); ++i) {
+        batch->at(i).promise_.set_value(affectedRows.at(i));
+    }
+}
+
+
+void MySqlGroupCommitter::runIndividually(vector<Request>* const batch) {
+    for (auto& request : *batch) {
+        try {
+            request.promise_.set_value(request.command_(*connection_));
+        } catch (...) {
+            request.promise_.set_exception(current_exception());
+        }
+    }
+}
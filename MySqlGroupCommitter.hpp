@@ -0,0 +1,136 @@
+#ifndef MYSQL_GROUP_COMMITTER_HPP_
+#define MYSQL_GROUP_COMMITTER_HPP_
+
+#include <mysql/mysql.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MySql.hpp"
+
+/**
+ * Collects small commands from many callers and commits them together in one
+ * transaction, so that they share one durable commit instead of paying for
+ * one each. A batch is committed once it has maximumStatements commands or
+ * once its oldest command has waited maximumDelay, whichever comes first.
+ *
+ * Each caller gets a future that's ready once its command is committed. If
+ * any command in a batch fails, the batch is rolled back and every command
+ * is rerun on its own, so only the commands that actually fail get an
+ * exception. Commands run on a background thread with a dedicated
+ * connection.
+ *
+ *     MySqlGroupCommitter committer(
+ *         std::move(connection), 100, std::chrono::microseconds(500));
+ *     auto inserted = committer.submit(
+ *         "INSERT INTO event (name) VALUES (?)", name);
+ *     inserted.get();  // Waits for the commit
+ */
+class MySqlGroupCommitter {
+    public:
+        MySqlGroupCommitter(
+            std::unique_ptr<MySql> connection,
+            size_t maximumStatements,
+            std::chrono::microseconds maximumDelay);
+        /**
+         * Commits everything that was submitted, then stops.
+         */
+        ~MySqlGroupCommitter();
+
+        MySqlGroupCommitter(const MySqlGroupCommitter& rhs) = delete;
+        MySqlGroupCommitter(MySqlGroupCommitter&& rhs) = delete;
+        MySqlGroupCommitter& operator=(const MySqlGroupCommitter& rhs) = delete;
+        MySqlGroupCommitter& operator=(MySqlGroupCommitter&& rhs) = delete;
+
+        /**
+         * Queues a command. The arguments are copied, but a const char*
+         * argument only copies the pointer, so pass std::string instead if
+         * the text might not outlive the commit.
+         * @return The number of affected rows, once committed.
+         */
+        template <typename... Args>
+        std::future<my_ulonglong> submit(
+            const char* const command,
+            const Args&... args);
+
+        /**
+         * Commits everything that has been submitted so far without waiting
+         * for the batch to fill up, and waits for it to finish.
+         */
+        void flush();
+
+    private:
+        typedef std::function<my_ulonglong(MySql&)> Command;
+        struct Request {
+            Request(Command command);
+
+            Command command_;
+            std::promise<my_ulonglong> promise_;
+            std::chrono::steady_clock::time_point enqueued_;
+        };
+
+        template <typename... Args>
+        static my_ulonglong runBound(
+            MySql& connection,
+            const std::string& command,
+            const Args&... args);
+
+        void enqueue(Command command, std::future<my_ulonglong>* future);
+        void run();
+        void commitBatch(std::vector<Request>* batch);
+        void runIndividually(std::vector<Request>* batch);
+
+        const std::unique_ptr<MySql> connection_;
+        const size_t maximumStatements_;
+        const std::chrono::steady_clock::duration maximumDelay_;
+
+        std::mutex mutex_;
+        std::condition_variable workAvailable_;
+        std::condition_variable batchCommitted_;
+        std::deque<Request> pending_;
+        uint64_t submitted_;
+        uint64_t completed_;
+        size_t flushWaiters_;
+        bool stopping_;
+        std::thread worker_;
+};
+
+
+template <typename... Args>
+my_ulonglong MySqlGroupCommitter::runBound(
+    MySql& connection,
+    const std::string& command,
+    const Args&... args
+) {
+    return connection.runCommand(command.c_str(), args...);
+}
+
+
+template <typename... Args>
+std::future<my_ulonglong> MySqlGroupCommitter::submit(
+    const char* const command,
+    const Args&... args
+) {
+    // std::bind stores copies of the arguments, so the caller's values can
+    // go away before the command runs
+    std::future<my_ulonglong> future;
+    enqueue(
+        std::bind(
+            &MySqlGroupCommitter::runBound<Args...>,
+            std::placeholders::_1,
+            std::string(command),
+            args...),
+        &future);
+    return future;
+}
+
+
+#endif  // MYSQL_GROUP_COMMITTER_HPP_
@@ -0,0 +1,190 @@
+#ifndef MYSQL_KEYSET_PAGER_HPP_
+#define MYSQL_KEYSET_PAGER_HPP_
+
+#include <cassert>
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <vector>
+
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+#include "MySqlPreparedStatement.hpp"
+
+/**
+ * Reads a large ordered result one page at a time by remembering the last
+ * key instead of using OFFSET, so every page costs the same no matter how
+ * deep into the results it is, and nothing is held open on the server
+ * between pages.
+ *
+ * The query needs two parameters, the key to start after and the page size,
+ * and needs to order by a unique key:
+ *
+ *     MySqlKeysetPager<0, int64_t, std::string> pager(
+ *         &connection,
+ *         "SELECT id, name FROM user WHERE id > ? ORDER BY id LIMIT ?",
+ *         0);  // Start before the first id
+ *     std::vector<std::tuple<int64_t, std::string>> page;
+ *     while (pager.nextPage(&page)) {
+ *         ...
+ *     }
+ *
+ * The page size adapts to how long pages take: it grows while pages are
+ * much faster than the target latency and shrinks when they're slower.
+ *
+ * @tparam KeyColumn The index of the key in the result tuples.
+ */
+template <size_t KeyColumn, typename... OutputArgs>
+class MySqlKeysetPager {
+    public:
+        typedef std::tuple<OutputArgs...> Row;
+        typedef typename std::tuple_element<KeyColumn, Row>::type Key;
+
+        /**
+         * @param after Only rows with keys after this are read.
+         */
+        MySqlKeysetPager(
+            const MySql* connection,
+            const char* query,
+            const Key& after);
+
+        MySqlKeysetPager(const MySqlKeysetPager& rhs) = delete;
+        MySqlKeysetPager(MySqlKeysetPager&& rhs) = delete;
+        MySqlKeysetPager& operator=(const MySqlKeysetPager& rhs) = delete;
+        MySqlKeysetPager& operator=(MySqlKeysetPager&& rhs) = delete;
+
+        /**
+         * Replaces the contents of rows with the next page.
+         * @return False, with rows empty, once every row has been read.
+         */
+        bool nextPage(std::vector<Row>* rows);
+
+        /**
+         * Page sizes, in rows. The page size starts at the minimum. Defaults
+         * to 100 and 10000.
+         */
+        void setPageSizeLimits(uint32_t minimum, uint32_t maximum);
+        /**
+         * How long a page should take. Defaults to 50 milliseconds.
+         */
+        void setTargetLatency(std::chrono::milliseconds latency);
+
+        /**
+         * The number of rows that the next page will ask for.
+         */
+        uint32_t getPageSize() const;
+
+    private:
+        void adjustPageSize(std::chrono::steady_clock::duration latency);
+
+        const MySql* const connection_;
+        const MySqlPreparedStatement statement_;
+        Key lastKey_;
+        uint32_t pageSize_;
+        uint32_t minimumPageSize_;
+        uint32_t maximumPageSize_;
+        std::chrono::steady_clock::duration targetLatency_;
+        bool done_;
+};
+
+
+template <size_t KeyColumn, typename... OutputArgs>
+MySqlKeysetPager<KeyColumn, OutputArgs...>::MySqlKeysetPager(
+    const MySql* const connection,
+    const char* const query,
+    const Key& after
+)
+    : connection_(connection)
+    , statement_(connection->prepareStatement(query))
+    , lastKey_(after)
+    , pageSize_(100)
+    , minimumPageSize_(100)
+    , maximumPageSize_(10000)
+    , targetLatency_(std::chrono::milliseconds(50))
+    , done_(false)
+{
+    static_assert(
+        KeyColumn < sizeof...(OutputArgs),
+        "Key column is out of range");
+    if (2 != statement_.getParameterCount()) {
+        throw MySqlException(
+            "Keyset pagination queries need a key parameter and a limit"
+            " parameter");
+    }
+}
+
+
+template <size_t KeyColumn, typename... OutputArgs>
+bool MySqlKeysetPager<KeyColumn, OutputArgs...>::nextPage(
+    std::vector<Row>* const rows
+) {
+    assert(nullptr != rows);
+    rows->clear();
+    if (done_) {
+        return false;
+    }
+
+    const uint32_t pageSize = pageSize_;
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    connection_->runQuery(rows, statement_, lastKey_, pageSize);
+    adjustPageSize(std::chrono::steady_clock::now() - start);
+
+    // A short page is the last one, so skip the round trip that would just
+    // return nothing
+    if (rows->size() < pageSize) {
+        done_ = true;
+    }
+    if (rows->empty()) {
+        return false;
+    }
+    lastKey_ = std::get<KeyColumn>(rows->back());
+    return true;
+}
+
+
+template <size_t KeyColumn, typename... OutputArgs>
+void MySqlKeysetPager<KeyColumn, OutputArgs...>::adjustPageSize(
+    const std::chrono::steady_clock::duration latency
+) {
+    if (latency * 2 < targetLatency_) {
+        pageSize_ = static_cast<uint32_t>(std::min(
+            static_cast<uint64_t>(pageSize_) * 2,
+            static_cast<uint64_t>(maximumPageSize_)));
+    } else if (latency > targetLatency_) {
+        pageSize_ = std::max(pageSize_ / 2, minimumPageSize_);
+    }
+}
+
+
+template <size_t KeyColumn, typename... OutputArgs>
+void MySqlKeysetPager<KeyColumn, OutputArgs...>::setPageSizeLimits(
+    const uint32_t minimum,
+    const uint32_t maximum
+) {
+    if (0 == minimum || minimum > maximum) {
+        throw MySqlException("Invalid page size limits");
+    }
+    minimumPageSize_ = minimum;
+    maximumPageSize_ = maximum;
+    pageSize_ = minimum;
+}
+
+
+template <size_t KeyColumn, typename... OutputArgs>
+void MySqlKeysetPager<KeyColumn, OutputArgs...>::setTargetLatency(
+    const std::chrono::milliseconds latency
+) {
+    targetLatency_ = latency;
+}
+
+
+template <size_t KeyColumn, typename... OutputArgs>
+uint32_t MySqlKeysetPager<KeyColumn, OutputArgs...>::getPageSize() const {
+    return pageSize_;
+}
+
+
+#endif  // MYSQL_KEYSET_PAGER_HPP_
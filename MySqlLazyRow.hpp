@@ -0,0 +1,112 @@
+#ifndef MYSQL_LAZY_ROW_HPP_
+#define MYSQL_LAZY_ROW_HPP_
+
+#include <cstddef>
+#include <mysql/mysql.h>
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "OutputBinder.hpp"
+
+/**
+ * A row whose columns are only converted when they're read, for wide rows
+ * where most columns are skipped for most rows. forEachRow passes these to
+ * a function whose only parameter is a MySqlLazyRow:
+ *
+ *     connection.forEachRow(
+ *         "SELECT id, status, name, biography FROM user",
+ *         [&](const MySqlLazyRow<int64_t, int32_t, string, string>& user) {
+ *             if (ACTIVE == user.get<1>()) {
+ *                 names.push_back(user.get<2>());
+ *             }
+ *         });
+ *
+ * The row refers to the fetched data, so it's only valid during the call.
+ * Numbers and MySqlStringRef columns are read in place, like forEachRow's
+ * parameters; other types are converted every time they're read.
+ */
+template <typename... Args>
+class MySqlLazyRow {
+    private:
+        template <size_t I>
+        using Reader = OutputBinderPrivate::OutputBinderColumnReader<
+            typename std::tuple_element<I, std::tuple<Args...>>::type>;
+
+    public:
+        explicit MySqlLazyRow(const std::vector<MYSQL_BIND>& row)
+            : row_(row)
+        {
+        }
+
+        MySqlLazyRow(const MySqlLazyRow& rhs) = delete;
+        MySqlLazyRow(MySqlLazyRow&& rhs) = delete;
+        MySqlLazyRow& operator=(const MySqlLazyRow& rhs) = delete;
+        MySqlLazyRow& operator=(MySqlLazyRow&& rhs) = delete;
+
+        /**
+         * Converts column I.
+         * @throws MySqlException If the column is NULL and its type isn't a
+         *     smart pointer.
+         */
+        template <size_t I>
+        auto get() const
+            -> decltype(Reader<I>::read(std::declval<const MYSQL_BIND&>()))
+        {
+            return Reader<I>::read(row_[I]);
+        }
+
+        /**
+         * If column I is NULL, without converting it.
+         */
+        template <size_t I>
+        bool isNull() const {
+            static_assert(I < sizeof...(Args), "Column index out of range");
+            return 0 != *row_[I].is_null;
+        }
+
+        /**
+         * Converts every column.
+         */
+        std::tuple<Args...> toTuple() const {
+            std::tuple<Args...> tuple;
+            OutputBinderPrivate::setResultTuple(
+                &tuple,
+                row_,
+                OutputBinderPrivate::int_<sizeof...(Args) - 1>{});
+            return tuple;
+        }
+
+    private:
+        const std::vector<MYSQL_BIND>& row_;
+};
+
+
+namespace OutputBinderPrivate {
+
+/**
+ * Binds the lazy row's column types instead of the function's parameter
+ * types.
+ */
+template <typename... Columns>
+class RowVisitor<std::tuple<MySqlLazyRow<Columns...>>> {
+    public:
+        template <typename Function>
+        static int tryVisit(
+            const MySqlPreparedStatement& statement,
+            Function* const function,
+            my_ulonglong* const rowCount
+        ) {
+            return tryFetchTypedRows<Columns...>(
+                statement,
+                [function, rowCount](const std::vector<MYSQL_BIND>& row) {
+                    (*function)(MySqlLazyRow<Columns...>(row));
+                    ++*rowCount;
+                });
+        }
+};
+
+}  // namespace OutputBinderPrivate
+
+#endif  // MYSQL_LAZY_ROW_HPP_
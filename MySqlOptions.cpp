@@ -0,0 +1,250 @@
+#include "MySqlException.hpp"
+#include "MySqlOptions.hpp"
+
+#include <cassert>
+#include <mysql/mysql.h>
+
+#include <string>
+
+using std::string;
+
+
+// A value of 0 for any of the numeric options means "not set", so the client
+// library default is used
+MySqlOptions::MySqlOptions()
+    : compression_(Compression::NONE)
+    , zstdCompressionLevel_(0)
+    , connectTimeout_(0)
+    , readTimeout_(0)
+    , writeTimeout_(0)
+    , unixSocket_()
+    , protocolSet_(false)
+    , protocol_(MYSQL_PROTOCOL_DEFAULT)
+    , maxAllowedPacket_(0)
+    , netBufferLength_(0)
+    , localInfile_(false)
+    , reconnectAttempts_(0)
+    , reconnectInitialDelay_(100)
+    , reconnectMaximumDelay_(5000)
+{
+}
+
+
+MySqlOptions& MySqlOptions::setCompression(const Compression compression) {
+    compression_ = compression;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setZstdCompressionLevel(const unsigned int level) {
+    zstdCompressionLevel_ = level;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setConnectTimeout(const unsigned int seconds) {
+    connectTimeout_ = seconds;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setReadTimeout(const unsigned int seconds) {
+    readTimeout_ = seconds;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setWriteTimeout(const unsigned int seconds) {
+    writeTimeout_ = seconds;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setUnixSocket(const char* const path) {
+    assert(nullptr != path);
+    unixSocket_ = path;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setProtocol(const mysql_protocol_type protocol) {
+    protocol_ = protocol;
+    protocolSet_ = true;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setMaxAllowedPacket(const unsigned long bytes) {
+    maxAllowedPacket_ = bytes;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setNetBufferLength(const unsigned long bytes) {
+    netBufferLength_ = bytes;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setLocalInfile(const bool enabled) {
+    localInfile_ = enabled;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setReconnectAttempts(const unsigned int attempts) {
+    reconnectAttempts_ = attempts;
+    return *this;
+}
+
+
+MySqlOptions& MySqlOptions::setReconnectBackoff(
+    const unsigned int initialMilliseconds,
+    const unsigned int maximumMilliseconds
+) {
+    assert(initialMilliseconds <= maximumMilliseconds);
+    reconnectInitialDelay_ = initialMilliseconds;
+    reconnectMaximumDelay_ = maximumMilliseconds;
+    return *this;
+}
+
+
+const char* MySqlOptions::getUnixSocket() const {
+    if (unixSocket_.empty()) {
+        return nullptr;
+    }
+    return unixSocket_.c_str();
+}
+
+
+unsigned int MySqlOptions::getReconnectAttempts() const {
+    return reconnectAttempts_;
+}
+
+
+unsigned int MySqlOptions::getReconnectInitialDelay() const {
+    return reconnectInitialDelay_;
+}
+
+
+unsigned int MySqlOptions::getReconnectMaximumDelay() const {
+    return reconnectMaximumDelay_;
+}
+
+
+static void setOption(
+    MYSQL* const connection,
+    const mysql_option option,
+    const void* const value,
+    const char* const name
+) {
+    if (0 != mysql_options(connection, option, value)) {
+        string errorMessage("Unable to set MySQL option ");
+        errorMessage += name;
+        throw MySqlException(errorMessage);
+    }
+}
+
+
+void MySqlOptions::apply(MYSQL* const connection) const {
+    assert(nullptr != connection);
+
+    switch (compression_) {
+        case Compression::NONE:
+            break;
+        case Compression::ZLIB:
+#ifdef MYSQL_OPTIONS_HAVE_COMPRESSION_ALGORITHMS
+            setOption(
+                connection,
+                MYSQL_OPT_COMPRESSION_ALGORITHMS,
+                "zlib",
+                "MYSQL_OPT_COMPRESSION_ALGORITHMS");
+#else
+            setOption(
+                connection,
+                MYSQL_OPT_COMPRESS,
+                nullptr,
+                "MYSQL_OPT_COMPRESS");
+#endif
+            break;
+        case Compression::ZSTD:
+#ifdef MYSQL_OPTIONS_HAVE_COMPRESSION_ALGORITHMS
+            setOption(
+                connection,
+                MYSQL_OPT_COMPRESSION_ALGORITHMS,
+                "zstd",
+                "MYSQL_OPT_COMPRESSION_ALGORITHMS");
+            if (0 != zstdCompressionLevel_) {
+                setOption(
+                    connection,
+                    MYSQL_OPT_ZSTD_COMPRESSION_LEVEL,
+                    &zstdCompressionLevel_,
+                    "MYSQL_OPT_ZSTD_COMPRESSION_LEVEL");
+            }
+#else
+            throw MySqlException(
+                "zstd compression requires a MySQL 8.0.18 or newer client"
+                " library");
+#endif
+            break;
+        default:
+            assert(false && "Unknown compression algorithm");
+            break;
+    }
+
+    if (0 != connectTimeout_) {
+        setOption(
+            connection,
+            MYSQL_OPT_CONNECT_TIMEOUT,
+            &connectTimeout_,
+            "MYSQL_OPT_CONNECT_TIMEOUT");
+    }
+    if (0 != readTimeout_) {
+        setOption(
+            connection,
+            MYSQL_OPT_READ_TIMEOUT,
+            &readTimeout_,
+            "MYSQL_OPT_READ_TIMEOUT");
+    }
+    if (0 != writeTimeout_) {
+        setOption(
+            connection,
+            MYSQL_OPT_WRITE_TIMEOUT,
+            &writeTimeout_,
+            "MYSQL_OPT_WRITE_TIMEOUT");
+    }
+
+    if (protocolSet_) {
+        // MYSQL_OPT_PROTOCOL expects an unsigned int, not the enum
+        const unsigned int protocol = static_cast<unsigned int>(protocol_);
+        setOption(
+            connection,
+            MYSQL_OPT_PROTOCOL,
+            &protocol,
+            "MYSQL_OPT_PROTOCOL");
+    }
+
+    if (0 != maxAllowedPacket_) {
+        setOption(
+            connection,
+            MYSQL_OPT_MAX_ALLOWED_PACKET,
+            &maxAllowedPacket_,
+            "MYSQL_OPT_MAX_ALLOWED_PACKET");
+    }
+    if (0 != netBufferLength_) {
+        setOption(
+            connection,
+            MYSQL_OPT_NET_BUFFER_LENGTH,
+            &netBufferLength_,
+            "MYSQL_OPT_NET_BUFFER_LENGTH");
+    }
+
+    if (localInfile_) {
+        const unsigned int enabled = 1;
+        setOption(
+            connection,
+            MYSQL_OPT_LOCAL_INFILE,
+            &enabled,
+            "MYSQL_OPT_LOCAL_INFILE");
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef MYSQL_OPTIONS_HPP_
+#define MYSQL_OPTIONS_HPP_
+
+// MYSQL is a typedef so we have to include mysql.h
+#include <mysql/mysql.h>
+
+#include <string>
+
+// zstd and the compression algorithm option were added in MySQL 8.0.18;
+// MariaDB doesn't support them at all
+#if MYSQL_VERSION_ID >= 80018 && !defined(MARIADB_BASE_VERSION)
+#define MYSQL_OPTIONS_HAVE_COMPRESSION_ALGORITHMS
+#endif
+
+/**
+ * Connection options that are applied with mysql_options before connecting.
+ * Options that haven't been set are left at the client library's defaults.
+ * Every setter returns *this so that they can be chained:
+ *
+ *     MySqlOptions options;
+ *     options.setCompression(MySqlOptions::Compression::ZSTD)
+ *         .setReadTimeout(30)
+ *         .setWriteTimeout(30);
+ *     MySql connection("db.example.com", "user", "password", "db", options);
+ */
+class MySqlOptions {
+    public:
+        enum class Compression {
+            NONE,
+            ZLIB,
+            // Requires a MySQL 8.0.18 or newer client library
+            ZSTD
+        };
+
+        MySqlOptions();
+
+        /**
+         * Enables protocol compression. Both the client library and the
+         * server need to support the chosen algorithm.
+         */
+        MySqlOptions& setCompression(Compression compression);
+        /**
+         * Sets the zstd compression level, 1 (fastest) to 22 (smallest).
+         * zlib always uses the library's default level.
+         */
+        MySqlOptions& setZstdCompressionLevel(unsigned int level);
+
+        /**
+         * Timeouts, in seconds. The client library retries reads and writes
+         * a few times, so the effective timeout may be a multiple of these.
+         */
+        /// @{
+        MySqlOptions& setConnectTimeout(unsigned int seconds);
+        MySqlOptions& setReadTimeout(unsigned int seconds);
+        MySqlOptions& setWriteTimeout(unsigned int seconds);
+        /// @}
+
+        /**
+         * Connects through this Unix domain socket when the host is
+         * "localhost".
+         */
+        MySqlOptions& setUnixSocket(const char* path);
+        MySqlOptions& setProtocol(mysql_protocol_type protocol);
+
+        /**
+         * Network buffer sizes, in bytes.
+         */
+        /// @{
+        MySqlOptions& setMaxAllowedPacket(unsigned long bytes);
+        MySqlOptions& setNetBufferLength(unsigned long bytes);
+        /// @}
+
+        /**
+         * Allows LOAD DATA LOCAL INFILE, which MySqlBulkLoader needs. The
+         * server also needs local_infile enabled.
+         */
+        MySqlOptions& setLocalInfile(bool enabled);
+
+        /**
+         * Reconnects when the server goes away or the connection is lost,
+         * e.g. because the server restarted or the connection timed out.
+         * Prepared statements stay valid and are prepared again the next
+         * time they're used. Reconnecting is tried up to attempts times,
+         * the first time right away, and then waiting initialMilliseconds,
+         * doubled after each failure up to maximumMilliseconds. Disabled
+         * by default.
+         */
+        /// @{
+        MySqlOptions& setReconnectAttempts(unsigned int attempts);
+        MySqlOptions& setReconnectBackoff(
+            unsigned int initialMilliseconds,
+            unsigned int maximumMilliseconds);
+        /// @}
+
+        /**
+         * Applies the options to a connection handle that hasn't connected
+         * yet.
+         */
+        void apply(MYSQL* connection) const;
+
+        /**
+         * Returns the Unix socket path, or nullptr if none was set.
+         */
+        const char* getUnixSocket() const;
+
+        /// @{
+        unsigned int getReconnectAttempts() const;
+        unsigned int getReconnectInitialDelay() const;
+        unsigned int getReconnectMaximumDelay() const;
+        /// @}
+
+    private:
+        Compression compression_;
+        unsigned int zstdCompressionLevel_;
+        unsigned int connectTimeout_;
+        unsigned int readTimeout_;
+        unsigned int writeTimeout_;
+        std::string unixSocket_;
+        bool protocolSet_;
+        mysql_protocol_type protocol_;
+        unsigned long maxAllowedPacket_;
+        unsigned long netBufferLength_;
+        bool localInfile_;
+        unsigned int reconnectAttempts_;
+        unsigned int reconnectInitialDelay_;
+        unsigned int reconnectMaximumDelay_;
+};
+
+#endif  // MYSQL_OPTIONS_HPP_
@@ -0,0 +1,56 @@
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+#include "MySqlParallelBulkLoader.hpp"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+
+using std::chrono::milliseconds;
+using std::move;
+using std::unique_ptr;
+
+
+MySqlParallelBulkLoader::MySqlParallelBulkLoader()
+    : connections_()
+    , chunkSize_(100000)
+    , maximumAttempts_(3)
+{
+}
+
+
+void MySqlParallelBulkLoader::addConnection(unique_ptr<MySql> connection) {
+    if (nullptr == connection) {
+        throw MySqlException("Bulk load connection is required");
+    }
+    connections_.push_back(move(connection));
+}
+
+
+size_t MySqlParallelBulkLoader::getConnectionCount() const {
+    return connections_.size();
+}
+
+
+void MySqlParallelBulkLoader::setChunkSize(const size_t rows) {
+    if (0 == rows) {
+        throw MySqlException("Bulk load chunks need at least 1 row");
+    }
+    chunkSize_ = rows;
+}
+
+
+void MySqlParallelBulkLoader::setMaximumAttempts(const unsigned int attempts) {
+    if (0 == attempts) {
+        throw MySqlException("Bulk load chunks need at least 1 attempt");
+    }
+    maximumAttempts_ = attempts;
+}
+
+
+void MySqlParallelBulkLoader::waitBeforeRetry(const unsigned int attempt) {
+    // Failures are usually lock waits or deadlocks with the other
+    // connections, so give them a moment to finish
+    std::this_thread::sleep_for(milliseconds(100 * attempt));
+}
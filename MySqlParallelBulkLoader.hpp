@@ -0,0 +1,202 @@
+#ifndef MYSQL_PARALLEL_BULK_LOADER_HPP_
+#define MYSQL_PARALLEL_BULK_LOADER_HPP_
+
+#include <mysql/mysql.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "MySql.hpp"
+#include "MySqlBulkLoader.hpp"
+#include "MySqlException.hpp"
+
+/**
+ * Bulk loads a range of tuples over several connections at once. The range
+ * is cut into chunks, and every connection keeps taking the next chunk that
+ * nobody has started until there are none left, so a connection that's
+ * stuck on a slow chunk doesn't hold up the rest of the load.
+ *
+ * A chunk that fails is retried on the same connection, which is only safe
+ * if the table is transactional so that a failed LOAD DATA leaves nothing
+ * behind. Once a chunk runs out of attempts, no new chunks are started and
+ * the error is rethrown, but chunks that were already loaded stay loaded.
+ *
+ *     MySqlParallelBulkLoader loader;
+ *     for (int i = 0; i < 8; ++i) {
+ *         loader.addConnection(std::unique_ptr<MySql>(new MySql(...)));
+ *     }
+ *     loader.load("event", nullptr, events.begin(), events.end());
+ */
+class MySqlParallelBulkLoader {
+    public:
+        struct Result {
+            my_ulonglong rowCount;
+            unsigned int warningCount;
+            size_t chunkCount;
+            size_t retryCount;
+        };
+
+        MySqlParallelBulkLoader();
+
+        MySqlParallelBulkLoader(const MySqlParallelBulkLoader& rhs) = delete;
+        MySqlParallelBulkLoader(MySqlParallelBulkLoader&& rhs) = delete;
+        MySqlParallelBulkLoader& operator=(
+            const MySqlParallelBulkLoader& rhs) = delete;
+        MySqlParallelBulkLoader& operator=(
+            MySqlParallelBulkLoader&& rhs) = delete;
+
+        /**
+         * Adds a connection. Each connection loads one chunk at a time, so
+         * the number of connections is the parallelism. The connections need
+         * MySqlOptions::setLocalInfile.
+         */
+        void addConnection(std::unique_ptr<MySql> connection);
+        size_t getConnectionCount() const;
+
+        /**
+         * Rows per chunk. Smaller chunks balance better and lose less work
+         * to a retry, but each one is a separate statement. Defaults to
+         * 100000.
+         */
+        void setChunkSize(size_t rows);
+        /**
+         * How many times a chunk is tried before giving up. Defaults to 3.
+         */
+        void setMaximumAttempts(unsigned int attempts);
+
+        /**
+         * Loads a range of tuples. See MySqlBulkLoader::load. The iterators
+         * need to be random access, and the range can't change until this
+         * returns.
+         */
+        template <typename Iterator>
+        Result load(
+            const char* table,
+            const char* columns,
+            Iterator begin,
+            Iterator end);
+
+    private:
+        static void waitBeforeRetry(unsigned int attempt);
+
+        std::vector<std::unique_ptr<MySql>> connections_;
+        size_t chunkSize_;
+        unsigned int maximumAttempts_;
+};
+
+
+template <typename Iterator>
+MySqlParallelBulkLoader::Result MySqlParallelBulkLoader::load(
+    const char* const table,
+    const char* const columns,
+    const Iterator begin,
+    const Iterator end
+) {
+    static_assert(
+        std::is_base_of<
+            std::random_access_iterator_tag,
+            typename std::iterator_traits<Iterator>::iterator_category
+        >::value,
+        "Parallel bulk loads need random access iterators");
+    typedef typename std::iterator_traits<Iterator>::difference_type
+        Difference;
+
+    if (connections_.empty()) {
+        throw MySqlException("No connections have been added");
+    }
+
+    const size_t rowCount = static_cast<size_t>(std::distance(begin, end));
+    const size_t chunkCount = (rowCount + chunkSize_ - 1) / chunkSize_;
+    std::atomic<size_t> nextChunk(0);
+    std::atomic<bool> failed(false);
+    std::vector<Result> connectionResults(connections_.size(), Result());
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(connections_.size());
+    for (size_t i = 0; i < connections_.size(); ++i) {
+        MySql* const connection = connections_.at(i).get();
+        Result* const result = &connectionResults.at(i);
+        futures.push_back(std::async(
+            std::launch::async,
+            [this, connection, result, table, columns, begin, rowCount,
+                chunkCount, &nextChunk, &failed]() {
+                MySqlBulkLoader loader(connection);
+                try {
+                    while (!failed.load()) {
+                        const size_t chunk = nextChunk.fetch_add(1);
+                        if (chunk >= chunkCount) {
+                            return;
+                        }
+                        const size_t first = chunk * chunkSize_;
+                        const size_t last = std::min(
+                            first + chunkSize_,
+                            rowCount);
+                        const Iterator chunkBegin =
+                            begin + static_cast<Difference>(first);
+                        const Iterator chunkEnd =
+                            begin + static_cast<Difference>(last);
+
+                        for (unsigned int attempt = 1; ; ++attempt) {
+                            try {
+                                const MySqlBulkLoader::Result chunkResult =
+                                    loader.load(
+                                        table,
+                                        columns,
+                                        chunkBegin,
+                                        chunkEnd);
+                                result->rowCount += chunkResult.rowCount;
+                                result->warningCount +=
+                                    chunkResult.warningCount;
+                                ++result->chunkCount;
+                                break;
+                            } catch (const MySqlException&) {
+                                if (attempt >= maximumAttempts_) {
+                                    throw;
+                                }
+                                ++result->retryCount;
+                                waitBeforeRetry(attempt);
+                            }
+                        }
+                    }
+                } catch (...) {
+                    // Stop the other connections from starting new chunks
+                    failed.store(true);
+                    throw;
+                }
+            }));
+    }
+
+    // Wait for every connection before throwing so that no thread outlives
+    // the locals that it references
+    std::exception_ptr firstError;
+    for (auto& future : futures) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+
+    Result total = Result();
+    for (const auto& result : connectionResults) {
+        total.rowCount += result.rowCount;
+        total.warningCount += result.warningCount;
+        total.chunkCount += result.chunkCount;
+        total.retryCount += result.retryCount;
+    }
+    return total;
+}
+
+
+#endif  // MYSQL_PARALLEL_BULK_LOADER_HPP_
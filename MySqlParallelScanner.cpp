@@ -0,0 +1,97 @@
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+#include "MySqlParallelScanner.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using std::get;
+using std::move;
+using std::shared_ptr;
+using std::string;
+using std::tuple;
+using std::unique_ptr;
+using std::vector;
+
+
+MySqlParallelScanner::MySqlParallelScanner()
+    : connections_()
+    , rangesPerConnection_(4)
+{
+}
+
+
+void MySqlParallelScanner::addConnection(unique_ptr<MySql> connection) {
+    if (nullptr == connection) {
+        throw MySqlException("Scan connection is required");
+    }
+    connections_.push_back(move(connection));
+}
+
+
+size_t MySqlParallelScanner::getConnectionCount() const {
+    return connections_.size();
+}
+
+
+void MySqlParallelScanner::setRangesPerConnection(const size_t ranges) {
+    if (0 == ranges) {
+        throw MySqlException("Scans need at least 1 range per connection");
+    }
+    rangesPerConnection_ = ranges;
+}
+
+
+vector<MySqlParallelScanner::KeyRange> MySqlParallelScanner::getKeyRanges(
+    const MySql& connection,
+    const char* const table,
+    const char* const key,
+    const size_t rangeCount
+) {
+    assert(0 < rangeCount);
+    string query("SELECT MIN(");
+    query += key;
+    query += "), MAX(";
+    query += key;
+    query += ") FROM ";
+    query += table;
+
+    vector<tuple<shared_ptr<int64_t>, shared_ptr<int64_t>>> bounds;
+    connection.runQuery(&bounds, query.c_str());
+    vector<KeyRange> ranges;
+    if (bounds.empty() || nullptr == get<0>(bounds.at(0))) {
+        // Empty table
+        return ranges;
+    }
+    const int64_t minimum = *get<0>(bounds.at(0));
+    const int64_t maximum = *get<1>(bounds.at(0));
+
+    // Work with offsets from the minimum so that keys near the ends of the
+    // int64_t range don't overflow
+    const uint64_t span =
+        static_cast<uint64_t>(maximum) - static_cast<uint64_t>(minimum);
+    const uint64_t width = span / rangeCount + 1;
+    if (0 == width) {
+        // The span covers every int64_t and there's only one range
+        ranges.push_back(KeyRange(minimum, maximum));
+        return ranges;
+    }
+    ranges.reserve(rangeCount);
+    for (uint64_t offset = 0; ; offset += width) {
+        const uint64_t last = span - offset < width ? span : offset + width - 1;
+        ranges.push_back(KeyRange(
+            static_cast<int64_t>(static_cast<uint64_t>(minimum) + offset),
+            static_cast<int64_t>(static_cast<uint64_t>(minimum) + last)));
+        if (last == span) {
+            break;
+        }
+    }
+    assert(ranges.size() <= rangeCount);
+    return ranges;
+}
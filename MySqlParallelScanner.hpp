@@ -0,0 +1,274 @@
+#ifndef MYSQL_PARALLEL_SCANNER_HPP_
+#define MYSQL_PARALLEL_SCANNER_HPP_
+
+#include <cassert>
+#include <cstdint>
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+
+/**
+ * Scans a whole table over several connections at once by splitting it into
+ * ranges of an integer primary key. The key's minimum and maximum are split
+ * into evenly sized ranges, more ranges than connections, and every
+ * connection keeps taking the next range that nobody has started, so ranges
+ * that are denser than the others don't leave the other connections idle.
+ *
+ * The scan isn't a consistent snapshot: each range is a separate query, so
+ * rows that change during the scan may or may not be seen.
+ *
+ *     MySqlParallelScanner scanner;
+ *     for (int i = 0; i < 8; ++i) {
+ *         scanner.addConnection(std::unique_ptr<MySql>(new MySql(...)));
+ *     }
+ *     scanner.scanEach<int64_t, std::string>(
+ *         "user",
+ *         "id",
+ *         "id, name",
+ *         [](size_t connection, std::vector<std::tuple<int64_t, std::string>>&
+ *             rows) {
+ *             ...
+ *         });
+ */
+class MySqlParallelScanner {
+    public:
+        /**
+         * An inclusive range of keys.
+         */
+        typedef std::pair<int64_t, int64_t> KeyRange;
+
+        MySqlParallelScanner();
+
+        MySqlParallelScanner(const MySqlParallelScanner& rhs) = delete;
+        MySqlParallelScanner(MySqlParallelScanner&& rhs) = delete;
+        MySqlParallelScanner& operator=(
+            const MySqlParallelScanner& rhs) = delete;
+        MySqlParallelScanner& operator=(MySqlParallelScanner&& rhs) = delete;
+
+        /**
+         * Adds a connection. Each connection scans one range at a time, so
+         * the number of connections is the parallelism.
+         */
+        void addConnection(std::unique_ptr<MySql> connection);
+        size_t getConnectionCount() const;
+
+        /**
+         * How many ranges to split the key space into for each connection.
+         * More ranges balance better but mean more queries. Defaults to 4.
+         */
+        void setRangesPerConnection(size_t ranges);
+
+        /**
+         * Scans the table and appends every row to results, sorted by key.
+         * The table, key and columns are put into the query as they are, so
+         * they must not come from an untrusted source.
+         * @param columns Comma separated columns to select.
+         */
+        template <typename... OutputArgs>
+        void scan(
+            std::vector<std::tuple<OutputArgs...>>* const results,
+            const char* table,
+            const char* key,
+            const char* columns);
+
+        /**
+         * Scans the table and calls consumer with each range's rows, sorted
+         * by key, as soon as the range has been read. Ranges finish in no
+         * particular order. The consumer is called from one thread per
+         * connection, and its first argument is that connection's index, so
+         * it can keep per-connection state without locking.
+         */
+        template <typename... OutputArgs, typename Consumer>
+        void scanEach(
+            const char* table,
+            const char* key,
+            const char* columns,
+            Consumer consumer);
+
+        /**
+         * Splits the key space of a table into about rangeCount ranges.
+         * Returns no ranges if the table is empty.
+         */
+        static std::vector<KeyRange> getKeyRanges(
+            const MySql& connection,
+            const char* table,
+            const char* key,
+            size_t rangeCount);
+
+    private:
+        /**
+         * Called with each range's rows. This is a nested typedef so that
+         * OutputArgs isn't deduced from the argument.
+         */
+        template <typename... OutputArgs>
+        struct RangeConsumer {
+            typedef std::function<void(
+                size_t connection,
+                size_t range,
+                std::vector<std::tuple<OutputArgs...>>& rows)> type;
+        };
+
+        template <typename... OutputArgs>
+        void forEachRange(
+            const char* table,
+            const char* key,
+            const char* columns,
+            const typename RangeConsumer<OutputArgs...>::type& consumer);
+
+        std::vector<std::unique_ptr<MySql>> connections_;
+        size_t rangesPerConnection_;
+};
+
+
+template <typename... OutputArgs>
+void MySqlParallelScanner::scan(
+    std::vector<std::tuple<OutputArgs...>>* const results,
+    const char* const table,
+    const char* const key,
+    const char* const columns
+) {
+    assert(nullptr != results);
+    // Every range is written by only one thread, so no locking is needed
+    std::vector<std::vector<std::tuple<OutputArgs...>>> rangeResults(
+        connections_.size() * rangesPerConnection_);
+    forEachRange<OutputArgs...>(
+        table,
+        key,
+        columns,
+        [&rangeResults](
+            const size_t,
+            const size_t range,
+            std::vector<std::tuple<OutputArgs...>>& rows
+        ) {
+            rangeResults.at(range).swap(rows);
+        });
+
+    size_t total = results->size();
+    for (const auto& rangeResult : rangeResults) {
+        total += rangeResult.size();
+    }
+    results->reserve(total);
+    for (auto& rangeResult : rangeResults) {
+        std::move(
+            rangeResult.begin(),
+            rangeResult.end(),
+            std::back_inserter(*results));
+    }
+}
+
+
+template <typename... OutputArgs, typename Consumer>
+void MySqlParallelScanner::scanEach(
+    const char* const table,
+    const char* const key,
+    const char* const columns,
+    Consumer consumer
+) {
+    forEachRange<OutputArgs...>(
+        table,
+        key,
+        columns,
+        [&consumer](
+            const size_t connection,
+            const size_t,
+            std::vector<std::tuple<OutputArgs...>>& rows
+        ) {
+            consumer(connection, rows);
+        });
+}
+
+
+template <typename... OutputArgs>
+void MySqlParallelScanner::forEachRange(
+    const char* const table,
+    const char* const key,
+    const char* const columns,
+    const typename RangeConsumer<OutputArgs...>::type& consumer
+) {
+    assert(nullptr != table);
+    assert(nullptr != key);
+    assert(nullptr != columns);
+    if (connections_.empty()) {
+        throw MySqlException("No connections have been added");
+    }
+
+    const std::vector<KeyRange> ranges(getKeyRanges(
+        *connections_.front(),
+        table,
+        key,
+        connections_.size() * rangesPerConnection_));
+
+    std::string query("SELECT ");
+    query += columns;
+    query += " FROM ";
+    query += table;
+    query += " WHERE ";
+    query += key;
+    query += " BETWEEN ? AND ? ORDER BY ";
+    query += key;
+
+    std::atomic<size_t> nextRange(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::future<void>> futures;
+    futures.reserve(connections_.size());
+    for (size_t i = 0; i < connections_.size(); ++i) {
+        const MySql* const connection = connections_.at(i).get();
+        futures.push_back(std::async(
+            std::launch::async,
+            [i, connection, &ranges, &query, &consumer, &nextRange,
+                &failed]() {
+                try {
+                    const MySqlPreparedStatement statement(
+                        connection->prepareStatement(query.c_str()));
+                    std::vector<std::tuple<OutputArgs...>> rows;
+                    while (!failed.load()) {
+                        const size_t range = nextRange.fetch_add(1);
+                        if (range >= ranges.size()) {
+                            return;
+                        }
+                        rows.clear();
+                        connection->runQuery(
+                            &rows,
+                            statement,
+                            ranges.at(range).first,
+                            ranges.at(range).second);
+                        consumer(i, range, rows);
+                    }
+                } catch (...) {
+                    // Stop the other connections from starting new ranges
+                    failed.store(true);
+                    throw;
+                }
+            }));
+    }
+
+    // Wait for every connection before throwing so that no thread outlives
+    // the locals that it references
+    std::exception_ptr firstError;
+    for (auto& future : futures) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+
+#endif  // MYSQL_PARALLEL_SCANNER_HPP_
@@ -1,52 +1,142 @@
 
 #include <cassert>
-#include <cstring>
 #include <mysql/mysql.h>
 
+#include <memory>
 #include <string>
+#include <utility>
 
 #include "MySqlException.hpp"
 #include "MySqlPreparedStatement.hpp"
 
+using std::move;
+using std::shared_ptr;
 using std::string;
-using std::strlen;
 
 MySqlPreparedStatement::MySqlPreparedStatement(
     const char* query,
-    MYSQL* const connection
+    shared_ptr<MySqlConnectionState> connection
 )
-    : statementHandle_(mysql_stmt_init(connection))
+    : statementHandle_(nullptr)
     , parameterCount_()
     , fieldCount_()
+    , query_(query)
+    , connection_(move(connection))
+    , generation_()
 {
-    assert(nullptr != connection);
+    assert(nullptr != connection_);
+    assert(nullptr != connection_->handle);
+    generation_ = connection_->generation;
+    statementHandle_ = prepare(query_, connection_->handle);
+    parameterCount_ = mysql_stmt_param_count(statementHandle_);
+    fieldCount_ = mysql_stmt_field_count(statementHandle_);
+}
+
+
+MySqlPreparedStatement::MySqlPreparedStatement(
+    MySqlPreparedStatement&& rhs
+) noexcept
+    : statementHandle_(rhs.statementHandle_)
+    , parameterCount_(rhs.parameterCount_)
+    , fieldCount_(rhs.fieldCount_)
+    , query_(move(rhs.query_))
+    , connection_(move(rhs.connection_))
+    , generation_(rhs.generation_)
+{
+    rhs.statementHandle_ = nullptr;
+}
+
+
+MySqlPreparedStatement& MySqlPreparedStatement::operator=(
+    MySqlPreparedStatement&& rhs
+) noexcept {
+    if (this != &rhs) {
+        close();
+        statementHandle_ = rhs.statementHandle_;
+        parameterCount_ = rhs.parameterCount_;
+        fieldCount_ = rhs.fieldCount_;
+        query_ = move(rhs.query_);
+        connection_ = move(rhs.connection_);
+        generation_ = rhs.generation_;
+        rhs.statementHandle_ = nullptr;
+    }
+    return *this;
+}
+
+
+MySqlPreparedStatement::~MySqlPreparedStatement() {
+    close();
+}
+
+
+void MySqlPreparedStatement::close() {
     if (nullptr == statementHandle_) {
+        return;
+    }
+    if (0 != mysql_stmt_free_result(statementHandle_)) {
+        // TODO Log an error
+    }
+    if (0 != mysql_stmt_close(statementHandle_)) {
+        // TODO Log an error
+    }
+    statementHandle_ = nullptr;
+}
+
+
+MYSQL_STMT* MySqlPreparedStatement::prepare(
+    const string& query,
+    MYSQL* const connection
+) {
+    MYSQL_STMT* const statementHandle = mysql_stmt_init(connection);
+    if (nullptr == statementHandle) {
         throw MySqlException("MySQL out of memory");
     }
 
-    const size_t length = strlen(query);
-    if (0 != mysql_stmt_prepare(statementHandle_, query, length)) {
+    if (0 != mysql_stmt_prepare(
+        statementHandle,
+        query.c_str(),
+        query.length())
+    ) {
         string errorMessage(
-            MySqlException::getServerErrorMessage(statementHandle_));
-        if (0 != mysql_stmt_free_result(statementHandle_)) {
+            MySqlException::getServerErrorMessage(statementHandle));
+        const unsigned int errorNumber = mysql_stmt_errno(statementHandle);
+        const string sqlState(mysql_stmt_sqlstate(statementHandle));
+        if (0 != mysql_stmt_free_result(statementHandle)) {
             errorMessage += "; There was an error freeing this statement";
         }
-        if (0 != mysql_stmt_close(statementHandle_)) {
+        if (0 != mysql_stmt_close(statementHandle)) {
             errorMessage += "; There was an error closing this statement";
         }
-        throw MySqlException(errorMessage);
+        throw MySqlException(errorMessage, errorNumber, sqlState.c_str());
     }
-
-    parameterCount_ = mysql_stmt_param_count(statementHandle_);
-    fieldCount_ = mysql_stmt_field_count(statementHandle_);
+    return statementHandle;
 }
 
 
-MySqlPreparedStatement::~MySqlPreparedStatement() {
-    if (0 != mysql_stmt_free_result(statementHandle_)) {
-        // TODO Log an error
+void MySqlPreparedStatement::prepareIfReconnected() const {
+    if (generation_ == connection_->generation) {
+        return;
     }
-    if (0 != mysql_stmt_close(statementHandle_)) {
-        // TODO Log an error
+    if (nullptr == connection_->handle) {
+        throw MySqlException("The statement's connection has been closed");
     }
+
+    MYSQL_STMT* const statementHandle = prepare(
+        query_,
+        connection_->handle);
+    // The tables could have been altered while the connection was down
+    if (mysql_stmt_param_count(statementHandle) != parameterCount_
+        || mysql_stmt_field_count(statementHandle) != fieldCount_
+    ) {
+        mysql_stmt_close(statementHandle);
+        throw MySqlException(
+            "The statement's parameters or fields changed when it was"
+            " prepared again after reconnecting");
+    }
+
+    // The old handle was detached when its connection was closed, so this
+    // only frees it
+    mysql_stmt_close(statementHandle_);
+    statementHandle_ = statementHandle;
+    generation_ = connection_->generation;
 }
@@ -6,6 +6,8 @@
 // Otherwise, I would just forward declare them.
 #include <mysql/mysql.h>
 
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace OutputBinderPrivate {
@@ -13,9 +15,40 @@ namespace OutputBinderPrivate {
     class Friend;
 }
 
+/**
+ * The connection handle that a MySql shares with the statements it prepares.
+ * Reconnecting replaces the handle and increments the generation, which tells
+ * the statements to prepare themselves again before they're next used.
+ */
+struct MySqlConnectionState {
+    MySqlConnectionState()
+        : handle(nullptr)
+        , generation(0)
+    {
+    }
+
+    MySqlConnectionState(const MySqlConnectionState& rhs) = delete;
+    MySqlConnectionState(MySqlConnectionState&& rhs) = delete;
+    MySqlConnectionState& operator=(const MySqlConnectionState& rhs) = delete;
+    MySqlConnectionState& operator=(MySqlConnectionState&& rhs) = delete;
+
+    // nullptr once the MySql has been destroyed
+    MYSQL* handle;
+    unsigned int generation;
+};
+
+
+/**
+ * A statement prepared on a MySql connection. Statements can be moved, e.g.
+ * into containers, and a moved-from statement can only be destroyed or
+ * assigned to. A statement stays tied to its connection even if the MySql is
+ * moved, and throws if it's used after the connection has been destroyed.
+ */
 class MySqlPreparedStatement {
     public:
-        MySqlPreparedStatement(MySqlPreparedStatement&& rhs) = default;
+        MySqlPreparedStatement(MySqlPreparedStatement&& rhs) noexcept;
+        MySqlPreparedStatement& operator=(
+            MySqlPreparedStatement&& rhs) noexcept;
         ~MySqlPreparedStatement();
 
         size_t getParameterCount() const {
@@ -26,6 +59,10 @@ class MySqlPreparedStatement {
             return fieldCount_;
         }
 
+        const std::string& getQuery() const {
+            return query_;
+        }
+
 
     private:
         // I don't want external uses to mess with this class, but these
@@ -33,23 +70,44 @@ class MySqlPreparedStatement {
         // stuff.
         friend class MySql;
         friend class OutputBinderPrivate::Friend;
+        friend class MySqlError;
         friend class MySqlException;
 
         // External users should call MySQL::prepareStatement
-        MySqlPreparedStatement(const char* query, MYSQL* connection);
+        MySqlPreparedStatement(
+            const char* query,
+            std::shared_ptr<MySqlConnectionState> connection);
 
         MySqlPreparedStatement() = delete;
         MySqlPreparedStatement(const MySqlPreparedStatement&) = delete;
         const MySqlPreparedStatement& operator=(
             const MySqlPreparedStatement&) = delete;
-        MySqlPreparedStatement& operator=(MySqlPreparedStatement&&) = default;
+
+        /**
+         * Frees the statement handle, if there is one.
+         */
+        void close();
+
+        /**
+         * Prepares the statement again if its connection has reconnected
+         * since it was last prepared. The handle is replaced in place, so
+         * callers can keep using the same MySqlPreparedStatement.
+         */
+        void prepareIfReconnected() const;
+
+        static MYSQL_STMT* prepare(const std::string& query, MYSQL* connection);
 
         // This should be const, but the MySQL C interface doesn't use const
         // anywhere, so I'd have to typecast the constness whenever I'd want
-        // to use it
-        MYSQL_STMT* statementHandle_;
+        // to use it. Mutable because re-preparing after a reconnect replaces
+        // it. nullptr once the statement has been moved from.
+        mutable MYSQL_STMT* statementHandle_;
         size_t parameterCount_;
         size_t fieldCount_;
+        std::string query_;
+        std::shared_ptr<MySqlConnectionState> connection_;
+        // The connection generation that statementHandle_ was prepared on
+        mutable unsigned int generation_;
 };
 
 #endif  // MYSQL_PREPARED_STATEMENT_HPP_
@@ -0,0 +1,499 @@
+#include "MySqlQueryCache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <mysql/mysql.h>
+
+#include <chrono>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::lock_guard;
+using std::move;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::type_info;
+using std::vector;
+
+
+MySqlQueryCache::MySqlQueryCache(
+    const size_t maximumBytes,
+    const milliseconds timeToLive
+)
+    : maximumBytes_(maximumBytes)
+    , timeToLive_(timeToLive)
+    , mutex_()
+    , entries_()
+    , index_()
+    , keysByTable_()
+    , generations_()
+    , clearCount_(0)
+    , bytes_(0)
+{
+}
+
+
+MySqlQueryCache::~MySqlQueryCache() {
+}
+
+
+MySqlQueryCache::Entry::Entry(
+    const string& key,
+    shared_ptr<const void> results,
+    const size_t bytes,
+    const steady_clock::time_point expires,
+    vector<string> tables
+)
+    : key_(key)
+    , results_(move(results))
+    , bytes_(bytes)
+    , expires_(expires)
+    , tables_(move(tables))
+{
+}
+
+
+MySqlQueryCache::Snapshot::Snapshot()
+    : tables_()
+    , generations_()
+    , clearCount_(0)
+    , cacheable_(false)
+{
+}
+
+
+MySqlQueryCache::Snapshot MySqlQueryCache::getSnapshot(
+    const char* const query
+) const {
+    Snapshot snapshot;
+    // Parse outside of the lock. If the tables aren't known, then a write
+    // might not invalidate the entry, so don't cache it.
+    snapshot.cacheable_ = getTables(query, &snapshot.tables_);
+    if (!snapshot.cacheable_) {
+        return snapshot;
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    snapshot.clearCount_ = clearCount_;
+    snapshot.generations_.reserve(snapshot.tables_.size());
+    for (const auto& table : snapshot.tables_) {
+        const auto generation = generations_.find(table);
+        snapshot.generations_.push_back(
+            generations_.end() == generation ? 0 : generation->second);
+    }
+    return snapshot;
+}
+
+
+static size_t getParameterLength(const MYSQL_BIND& parameter) {
+    // Switch on int so that -Wswitch-enum doesn't want every field type
+    switch (static_cast<int>(parameter.buffer_type)) {
+        case MYSQL_TYPE_TINY:
+            return 1;
+        case MYSQL_TYPE_SHORT:
+            return 2;
+        case MYSQL_TYPE_LONG:
+        case MYSQL_TYPE_FLOAT:
+            return 4;
+        case MYSQL_TYPE_LONGLONG:
+        case MYSQL_TYPE_DOUBLE:
+            return 8;
+        case MYSQL_TYPE_NULL:
+            return 0;
+        // Everything else is sent as a string
+        default:
+            return parameter.buffer_length;
+    }
+}
+
+
+string MySqlQueryCache::makeKeyFromParameters(
+    const char* const query,
+    const type_info& resultType,
+    const vector<MYSQL_BIND>& parameters
+) {
+    assert(nullptr != query);
+    // The parts are separated by '\0' so that, e.g., a query that ends with
+    // the type name can't collide with another query
+    string key(query);
+    key.push_back('\0');
+    key += resultType.name();
+    key.push_back('\0');
+    for (const auto& parameter : parameters) {
+        // Include the type so that, e.g., the integer 1 and the string "1"
+        // are different keys
+        key.push_back(static_cast<char>(parameter.buffer_type));
+        key.push_back(static_cast<char>(parameter.is_unsigned));
+        const size_t length = getParameterLength(parameter);
+        key.append(
+            reinterpret_cast<const char*>(&length),
+            sizeof(length));
+        key.append(static_cast<const char*>(parameter.buffer), length);
+    }
+    return key;
+}
+
+
+shared_ptr<const void> MySqlQueryCache::find(const string& key) {
+    lock_guard<mutex> lock(mutex_);
+    const auto found = index_.find(key);
+    if (index_.end() == found) {
+        return shared_ptr<const void>();
+    }
+
+    const EntryList::iterator entry = found->second;
+    if (steady_clock::now() >= entry->expires_) {
+        erase(entry);
+        return shared_ptr<const void>();
+    }
+
+    // Move it to the front of the LRU list
+    entries_.splice(entries_.begin(), entries_, entry);
+    return entry->results_;
+}
+
+
+void MySqlQueryCache::insert(
+    const string& key,
+    shared_ptr<const void> results,
+    size_t bytes,
+    const Snapshot& snapshot
+) {
+    bytes += 2 * key.size();
+    if (bytes > maximumBytes_ || !snapshot.cacheable_) {
+        return;
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    // If any of the tables were invalidated while the query ran, then the
+    // results might already be stale
+    if (snapshot.clearCount_ != clearCount_) {
+        return;
+    }
+    for (size_t i = 0; i < snapshot.tables_.size(); ++i) {
+        const auto generation = generations_.find(snapshot.tables_[i]);
+        if (
+            generations_.end() != generation
+            && snapshot.generations_[i] != generation->second
+        ) {
+            return;
+        }
+    }
+
+    const auto existing = index_.find(key);
+    if (index_.end() != existing) {
+        erase(existing->second);
+    }
+
+    entries_.push_front(Entry(
+        key,
+        move(results),
+        bytes,
+        steady_clock::now() + timeToLive_,
+        snapshot.tables_));
+    index_[key] = entries_.begin();
+    for (const auto& table : entries_.front().tables_) {
+        keysByTable_[table].insert(key);
+    }
+    bytes_ += bytes;
+    evict();
+}
+
+
+void MySqlQueryCache::erase(const EntryList::iterator entry) {
+    for (const auto& table : entry->tables_) {
+        const auto keys = keysByTable_.find(table);
+        if (keysByTable_.end() != keys) {
+            keys->second.erase(entry->key_);
+            if (keys->second.empty()) {
+                keysByTable_.erase(keys);
+            }
+        }
+    }
+    bytes_ -= entry->bytes_;
+    index_.erase(entry->key_);
+    entries_.erase(entry);
+}
+
+
+void MySqlQueryCache::evict() {
+    while (bytes_ > maximumBytes_ && !entries_.empty()) {
+        erase(--entries_.end());
+    }
+}
+
+
+void MySqlQueryCache::invalidateTable(const string& table) {
+    string lowercase(table);
+    for (auto& c : lowercase) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    // Count invalidations even if nothing is cached yet, so that a query
+    // that is running now doesn't cache its results
+    ++generations_[lowercase];
+    const auto keys = keysByTable_.find(lowercase);
+    if (keysByTable_.end() == keys) {
+        return;
+    }
+    // Erasing entries modifies keysByTable_, so copy the keys first
+    const vector<string> toErase(keys->second.begin(), keys->second.end());
+    for (const auto& key : toErase) {
+        const auto found = index_.find(key);
+        if (index_.end() != found) {
+            erase(found->second);
+        }
+    }
+}
+
+
+void MySqlQueryCache::invalidateTablesIn(const char* const statement) {
+    vector<string> tables;
+    if (!getTables(statement, &tables)) {
+        // It might have written to any table
+        clear();
+        return;
+    }
+    for (const auto& table : tables) {
+        invalidateTable(table);
+    }
+}
+
+
+void MySqlQueryCache::clear() {
+    lock_guard<mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    keysByTable_.clear();
+    ++clearCount_;
+    bytes_ = 0;
+}
+
+
+size_t MySqlQueryCache::getByteCount() const {
+    lock_guard<mutex> lock(mutex_);
+    return bytes_;
+}
+
+
+size_t MySqlQueryCache::getEntryCount() const {
+    lock_guard<mutex> lock(mutex_);
+    return entries_.size();
+}
+
+
+/**
+ * Reads the next token from a statement. Identifiers are lowercased and
+ * backtick quoted identifiers are unquoted. Database qualified names are
+ * returned as a single token, e.g. "db.table". Commas and parentheses are
+ * returned as their own tokens. String literals and comments are skipped.
+ * Returns false at the end of the statement.
+ */
+static bool nextToken(const char** const position, string* const token) {
+    const char* p = *position;
+    token->clear();
+    while ('\0' != *p) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if (std::isspace(c) || ';' == c) {
+            ++p;
+        } else if ('\'' == c || '"' == c) {
+            // Skip string literals
+            const char quote = *p++;
+            while ('\0' != *p && quote != *p) {
+                if ('\\' == *p && '\0' != p[1]) {
+                    ++p;
+                }
+                ++p;
+            }
+            if ('\0' != *p) {
+                ++p;
+            }
+        } else if ('-' == c && '-' == p[1]) {
+            while ('\0' != *p && '\n' != *p) {
+                ++p;
+            }
+        } else if ('#' == c) {
+            while ('\0' != *p && '\n' != *p) {
+                ++p;
+            }
+        } else if ('/' == c && '*' == p[1]) {
+            const char* const end = std::strstr(p + 2, "*/");
+            p = (nullptr == end ? p + std::strlen(p) : end + 2);
+        } else {
+            break;
+        }
+    }
+    if ('\0' == *p) {
+        *position = p;
+        return false;
+    }
+
+    while ('\0' != *p) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if ('`' == c) {
+            ++p;
+            while ('\0' != *p && '`' != *p) {
+                token->push_back(static_cast<char>(
+                    std::tolower(static_cast<unsigned char>(*p))));
+                ++p;
+            }
+            if ('\0' != *p) {
+                ++p;
+            }
+        } else if (std::isalnum(c) || '_' == c || '$' == c || '.' == c) {
+            token->push_back(static_cast<char>(std::tolower(c)));
+            ++p;
+        } else {
+            break;
+        }
+    }
+    if (token->empty()) {
+        // Some other punctuation, e.g. ',', '=' or '*'
+        token->push_back(*p++);
+    }
+    *position = p;
+    return true;
+}
+
+
+static bool isOneOf(
+    const string& token,
+    const std::initializer_list<const char*> words
+) {
+    for (const char* const word : words) {
+        if (token == word) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool MySqlQueryCache::getTables(
+    const char* const statement,
+    vector<string>* const tables
+) {
+    assert(nullptr != statement);
+    assert(nullptr != tables);
+    tables->clear();
+    const char* position = statement;
+    string token;
+    string previous;
+    // The first keyword, e.g. "select" or "insert"
+    string verb;
+    bool tableIsNext = false;
+    // Whether a comma at each parenthesis depth starts another table, e.g.
+    // FROM a, b or UPDATE a, b SET ...
+    vector<bool> inTableList(1, false);
+    for (; nextToken(&position, &token); previous = token) {
+        if (verb.empty() && "(" != token) {
+            verb = token;
+            // INSERT and REPLACE don't need INTO, TRUNCATE doesn't need
+            // TABLE, and UPDATE is followed by its tables
+            tableIsNext = isOneOf(
+                verb,
+                {"insert", "replace", "truncate", "update"});
+            inTableList.back() = tableIsNext;
+            continue;
+        }
+
+        if ("(" == token) {
+            // e.g. JOIN (a, b) or FROM (SELECT ...)
+            inTableList.push_back(tableIsNext);
+            continue;
+        }
+        if (")" == token) {
+            if (inTableList.size() > 1) {
+                inTableList.pop_back();
+            }
+            tableIsNext = false;
+            continue;
+        }
+        if ("," == token) {
+            tableIsNext = inTableList.back();
+            continue;
+        }
+
+        if (
+            isOneOf(token, {"from", "join", "straight_join", "into", "table"})
+            || ("using" == token && "delete" == verb)
+            // Not ON DUPLICATE KEY UPDATE or SELECT ... FOR UPDATE
+            || ("update" == token && !isOneOf(previous, {"key", "for"}))
+        ) {
+            tableIsNext = true;
+            inTableList.back() = true;
+        } else if (
+            isOneOf(
+                token,
+                {
+                    "where", "set", "values", "value", "select", "group",
+                    "order", "limit", "having", "window", "union", "for",
+                    "procedure", "lock", "returning"
+                })
+        ) {
+            // Commas after these separate columns or values, not tables
+            tableIsNext = false;
+            inTableList.back() = false;
+        } else if (tableIsNext) {
+            // e.g. DROP TABLE IF NOT EXISTS or INSERT IGNORE INTO
+            if (
+                isOneOf(
+                    token,
+                    {
+                        "if", "not", "exists", "ignore", "low_priority",
+                        "high_priority", "delayed", "quick", "lateral"
+                    })
+            ) {
+                continue;
+            }
+            tableIsNext = false;
+            // Variables, e.g. SELECT ... INTO @total, aren't tables
+            const unsigned char first = static_cast<unsigned char>(token[0]);
+            if (!std::isalnum(first) && '_' != first && '$' != first) {
+                continue;
+            }
+            const size_t dot = token.rfind('.');
+            const string table(
+                string::npos == dot ? token : token.substr(dot + 1));
+            if (
+                !table.empty()
+                && tables->end()
+                    == std::find(tables->begin(), tables->end(), table)
+            ) {
+                tables->push_back(table);
+            }
+        }
+    }
+
+    // Statements that write to tables have to name at least one
+    if (
+        isOneOf(
+            verb,
+            {
+                "insert", "replace", "update", "delete", "truncate", "load",
+                "create", "alter", "drop", "rename"
+            })
+    ) {
+        return !tables->empty();
+    }
+    // Statements that read from tables might not name any, e.g. SELECT 1,
+    // and some statements don't touch any table data
+    return isOneOf(
+        verb,
+        {
+            "select", "with", "begin", "start", "commit", "rollback",
+            "savepoint", "release", "set", "show", "use", "describe", "desc",
+            "explain", "lock", "unlock"
+        });
+}
@@ -0,0 +1,281 @@
+#ifndef MYSQL_QUERY_CACHE_HPP_
+#define MYSQL_QUERY_CACHE_HPP_
+
+#include <cstdint>
+#include <mysql/mysql.h>
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "InputBinder.hpp"
+
+namespace MySqlQueryCachePrivate {
+
+template<int I> struct int_ {};  // Compile-time counter
+
+/**
+ * Rough estimates of how much memory a cached value uses, including any heap
+ * memory that it owns.
+ */
+/// @{
+template <typename T>
+size_t estimateBytes(const T&) {
+    return sizeof(T);
+}
+inline size_t estimateBytes(const std::string& value) {
+    return sizeof(value) + value.capacity();
+}
+template <typename T>
+size_t estimateBytes(const std::shared_ptr<T>& value) {
+    return sizeof(value) + (nullptr == value ? 0 : estimateBytes(*value));
+}
+template <typename T>
+size_t estimateBytes(const std::unique_ptr<T>& value) {
+    return sizeof(value) + (nullptr == value ? 0 : estimateBytes(*value));
+}
+/// @}
+
+template <typename Tuple>
+size_t estimateTupleBytes(const Tuple&, int_<-1>) {
+    return 0;
+}
+template <typename Tuple, int I>
+size_t estimateTupleBytes(const Tuple& tuple, int_<I>) {
+    // estimateBytes includes the size of the value itself, which is already
+    // counted in sizeof(Tuple)
+    const auto& value = std::get<I>(tuple);
+    return estimateBytes(value) - sizeof(value)
+        + estimateTupleBytes(tuple, int_<I - 1>());
+}
+
+}  // namespace MySqlQueryCachePrivate
+
+
+/**
+ * Caches query results on the client. Entries are keyed by the query, the
+ * bound parameter values and the result type, and are shared and immutable,
+ * so a hit is just a hash lookup. Entries expire after a time to live, and
+ * the least recently used entries are evicted when the cache goes over its
+ * byte budget.
+ *
+ * Every entry is tagged with the tables that its query reads from, and a
+ * command that writes to one of those tables invalidates the entry. Tables
+ * are found by looking for the identifiers after FROM, JOIN, INTO, UPDATE and
+ * TABLE, including comma separated lists, which covers common statements.
+ * Queries whose tables can't be found aren't cached, and commands whose
+ * tables can't be found, e.g. CALL, clear the whole cache. Use
+ * invalidateTable for writes from other clients.
+ *
+ * This class is thread safe, so one cache can be shared by several
+ * connections.
+ */
+class MySqlQueryCache {
+    public:
+        MySqlQueryCache(
+            size_t maximumBytes,
+            std::chrono::milliseconds timeToLive);
+        ~MySqlQueryCache();
+
+        MySqlQueryCache(const MySqlQueryCache& rhs) = delete;
+        MySqlQueryCache(MySqlQueryCache&& rhs) = delete;
+        MySqlQueryCache& operator=(const MySqlQueryCache& rhs) = delete;
+        MySqlQueryCache& operator=(MySqlQueryCache&& rhs) = delete;
+
+        /**
+         * The tables that a query reads from, and how many times each one
+         * had been invalidated, when the query started. Results are only
+         * cached if none of those tables has been invalidated since, so
+         * that a write from another connection while the query ran can't
+         * leave a stale result in the cache.
+         */
+        class Snapshot {
+            public:
+                Snapshot();
+
+            private:
+                friend class MySqlQueryCache;
+                std::vector<std::string> tables_;
+                std::vector<uint64_t> generations_;
+                uint64_t clearCount_;
+                bool cacheable_;
+        };
+
+        /**
+         * Takes a snapshot to pass to put. This should be called before
+         * running the query.
+         */
+        Snapshot getSnapshot(const char* query) const;
+
+        /**
+         * Looks up a cached result.
+         * @return True if the results were found.
+         */
+        template <typename... InputArgs, typename... OutputArgs>
+        bool get(
+            std::shared_ptr<const std::vector<std::tuple<OutputArgs...>>>*
+                const results,
+            const char* const query,
+            const InputArgs&... args);
+
+        /**
+         * Caches a result. Results that are bigger than the whole cache, or
+         * that read from a table that was invalidated after the snapshot
+         * was taken, aren't stored.
+         */
+        template <typename... InputArgs, typename... OutputArgs>
+        void put(
+            const std::shared_ptr<
+                const std::vector<std::tuple<OutputArgs...>>>& results,
+            const Snapshot& snapshot,
+            const char* const query,
+            const InputArgs&... args);
+
+        /**
+         * Removes every entry that reads from a table.
+         */
+        void invalidateTable(const std::string& table);
+        /**
+         * Removes every entry that reads from a table that this statement
+         * writes to, or every entry if the tables can't be found.
+         */
+        void invalidateTablesIn(const char* statement);
+        void clear();
+
+        size_t getByteCount() const;
+        size_t getEntryCount() const;
+
+        /**
+         * Finds the lowercased names, without database qualifiers, of the
+         * tables that a statement refers to.
+         * @return False if the statement isn't understood well enough to
+         * know which tables it refers to, e.g. CALL.
+         */
+        static bool getTables(
+            const char* statement,
+            std::vector<std::string>* tables);
+
+        /**
+         * Builds the key for a query, its bound parameters and its result
+         * type.
+         */
+        template <typename... InputArgs>
+        static std::string makeKey(
+            const char* query,
+            const std::type_info& resultType,
+            const InputArgs&... args);
+
+    private:
+        struct Entry {
+            Entry(
+                const std::string& key,
+                std::shared_ptr<const void> results,
+                size_t bytes,
+                std::chrono::steady_clock::time_point expires,
+                std::vector<std::string> tables);
+
+            std::string key_;
+            std::shared_ptr<const void> results_;
+            size_t bytes_;
+            std::chrono::steady_clock::time_point expires_;
+            std::vector<std::string> tables_;
+        };
+        typedef std::list<Entry> EntryList;
+
+        static std::string makeKeyFromParameters(
+            const char* query,
+            const std::type_info& resultType,
+            const std::vector<MYSQL_BIND>& parameters);
+
+        std::shared_ptr<const void> find(const std::string& key);
+        void insert(
+            const std::string& key,
+            std::shared_ptr<const void> results,
+            size_t bytes,
+            const Snapshot& snapshot);
+        // These require that mutex_ is held
+        void erase(EntryList::iterator entry);
+        void evict();
+
+        const size_t maximumBytes_;
+        const std::chrono::steady_clock::duration timeToLive_;
+
+        mutable std::mutex mutex_;
+        // Most recently used entries are at the front
+        EntryList entries_;
+        std::unordered_map<std::string, EntryList::iterator> index_;
+        std::unordered_map<std::string, std::unordered_set<std::string>>
+            keysByTable_;
+        // How many times each table has been invalidated, and how many
+        // times the whole cache has been cleared
+        std::unordered_map<std::string, uint64_t> generations_;
+        uint64_t clearCount_;
+        size_t bytes_;
+};
+
+
+template <typename... InputArgs>
+std::string MySqlQueryCache::makeKey(
+    const char* const query,
+    const std::type_info& resultType,
+    const InputArgs&... args
+) {
+    // Reuse the input binder so that the key has exactly the bytes that
+    // would be sent to the server
+    std::vector<MYSQL_BIND> parameters(sizeof...(args));
+    bindInputs<InputArgs...>(&parameters, args...);
+    return makeKeyFromParameters(query, resultType, parameters);
+}
+
+
+template <typename... InputArgs, typename... OutputArgs>
+bool MySqlQueryCache::get(
+    std::shared_ptr<const std::vector<std::tuple<OutputArgs...>>>* const
+        results,
+    const char* const query,
+    const InputArgs&... args
+) {
+    typedef std::vector<std::tuple<OutputArgs...>> Results;
+    const std::shared_ptr<const void> found(
+        find(makeKey(query, typeid(Results), args...)));
+    if (nullptr == found) {
+        return false;
+    }
+    // The key includes the result type, so this cast is safe
+    *results = std::static_pointer_cast<const Results>(found);
+    return true;
+}
+
+
+template <typename... InputArgs, typename... OutputArgs>
+void MySqlQueryCache::put(
+    const std::shared_ptr<const std::vector<std::tuple<OutputArgs...>>>&
+        results,
+    const Snapshot& snapshot,
+    const char* const query,
+    const InputArgs&... args
+) {
+    typedef std::vector<std::tuple<OutputArgs...>> Results;
+    size_t bytes = sizeof(Results)
+        + results->capacity() * sizeof(std::tuple<OutputArgs...>);
+    for (const auto& row : *results) {
+        bytes += MySqlQueryCachePrivate::estimateTupleBytes(
+            row,
+            MySqlQueryCachePrivate::int_<sizeof...(OutputArgs) - 1>());
+    }
+    insert(
+        makeKey(query, typeid(Results), args...),
+        results,
+        bytes,
+        snapshot);
+}
+
+
+#endif  // MYSQL_QUERY_CACHE_HPP_
@@ -0,0 +1,143 @@
+#include "MySqlException.hpp"
+#include "MySqlReplicaRouter.hpp"
+
+#include <cassert>
+#include <mysql/mysql.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::lock_guard;
+using std::memory_order_relaxed;
+using std::move;
+using std::mutex;
+using std::unique_ptr;
+
+
+MySqlReplicaRouter::Connection::Connection(unique_ptr<MySql> connection)
+    : connection_(move(connection))
+    , mutex_()
+    , outstanding_(0)
+{
+}
+
+
+MySqlReplicaRouter::OutstandingRequest::OutstandingRequest(
+    Connection* const connection
+)
+    : connection_(connection)
+{
+    connection_->outstanding_.fetch_add(1, memory_order_relaxed);
+}
+
+
+MySqlReplicaRouter::OutstandingRequest::~OutstandingRequest() {
+    connection_->outstanding_.fetch_sub(1, memory_order_relaxed);
+}
+
+
+MySqlReplicaRouter::RecordedWrite::RecordedWrite(
+    MySqlReplicaRouter* const router
+)
+    : router_(router)
+{
+    router_->recordWrite();
+}
+
+
+MySqlReplicaRouter::RecordedWrite::~RecordedWrite() {
+    router_->recordWrite();
+}
+
+
+MySqlReplicaRouter::MySqlReplicaRouter(unique_ptr<MySql> primary)
+    : primary_()
+    , replicas_()
+    , readYourWritesWindow_(0)
+    // 0 means that there haven't been any writes
+    , lastWrite_(0)
+{
+    if (nullptr == primary) {
+        throw MySqlException("Primary connection is required");
+    }
+    primary_.reset(new Connection(move(primary)));
+}
+
+
+MySqlReplicaRouter::~MySqlReplicaRouter() {
+}
+
+
+void MySqlReplicaRouter::addReplica(unique_ptr<MySql> replica) {
+    if (nullptr == replica) {
+        throw MySqlException("Replica connection is required");
+    }
+    replicas_.emplace_back(new Connection(move(replica)));
+}
+
+
+size_t MySqlReplicaRouter::getReplicaCount() const {
+    return replicas_.size();
+}
+
+
+void MySqlReplicaRouter::setReadYourWritesWindow(const milliseconds window) {
+    readYourWritesWindow_.store(
+        steady_clock::duration(window).count(),
+        memory_order_relaxed);
+}
+
+
+my_ulonglong MySqlReplicaRouter::runCommand(const char* const command) {
+    OutstandingRequest request(primary_.get());
+    lock_guard<mutex> lock(primary_->mutex_);
+    RecordedWrite write(this);
+    return primary_->connection_->runCommand(command);
+}
+
+
+MySqlReplicaRouter::Connection* MySqlReplicaRouter::chooseReadConnection() {
+    if (replicas_.empty()) {
+        return primary_.get();
+    }
+
+    const steady_clock::rep lastWriteTicks = lastWrite_.load(
+        memory_order_relaxed);
+    const steady_clock::duration window(
+        readYourWritesWindow_.load(memory_order_relaxed));
+    if (0 != lastWriteTicks && window > steady_clock::duration::zero()) {
+        const steady_clock::time_point lastWrite(
+            (steady_clock::duration(lastWriteTicks)));
+        if (steady_clock::now() - lastWrite < window) {
+            return primary_.get();
+        }
+    }
+
+    // Least outstanding requests. Ties go to the first replica, which keeps
+    // its connection warm when the load is light.
+    Connection* best = replicas_.front().get();
+    unsigned int bestOutstanding = best->outstanding_.load(
+        memory_order_relaxed);
+    for (size_t i = 1; i < replicas_.size() && 0 != bestOutstanding; ++i) {
+        Connection* const replica = replicas_.at(i).get();
+        const unsigned int outstanding = replica->outstanding_.load(
+            memory_order_relaxed);
+        if (outstanding < bestOutstanding) {
+            best = replica;
+            bestOutstanding = outstanding;
+        }
+    }
+    return best;
+}
+
+
+void MySqlReplicaRouter::recordWrite() {
+    lastWrite_.store(
+        steady_clock::now().time_since_epoch().count(),
+        memory_order_relaxed);
+}
@@ -0,0 +1,166 @@
+#ifndef MYSQL_REPLICA_ROUTER_HPP_
+#define MYSQL_REPLICA_ROUTER_HPP_
+
+#include <mysql/mysql.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "MySql.hpp"
+
+/**
+ * Splits reads and writes across a primary and a set of replicas. Commands
+ * and transactional work always run on the primary. Queries run on the
+ * replica with the fewest outstanding requests, unless there was a write
+ * within the read-your-writes window, in which case they run on the primary
+ * so that the write is visible. Every connection is guarded by its own mutex,
+ * so a router can be shared between threads. Pinning applies to the whole
+ * router, so use one router per session if sessions need independent
+ * read-your-writes guarantees.
+ */
+class MySqlReplicaRouter {
+    public:
+        explicit MySqlReplicaRouter(std::unique_ptr<MySql> primary);
+        ~MySqlReplicaRouter();
+
+        MySqlReplicaRouter(const MySqlReplicaRouter& rhs) = delete;
+        MySqlReplicaRouter(MySqlReplicaRouter&& rhs) = delete;
+        MySqlReplicaRouter& operator=(const MySqlReplicaRouter& rhs) = delete;
+        MySqlReplicaRouter& operator=(MySqlReplicaRouter&& rhs) = delete;
+
+        /**
+         * Adds a replica. This isn't thread safe, so add all of the replicas
+         * before sharing the router.
+         */
+        void addReplica(std::unique_ptr<MySql> replica);
+
+        size_t getReplicaCount() const;
+
+        /**
+         * After a write finishes, send reads to the primary for this long.
+         * Defaults to 0, i.e. reads always go to the replicas. This can be
+         * changed while the router is shared.
+         */
+        void setReadYourWritesWindow(std::chrono::milliseconds window);
+
+        /**
+         * Runs a command on the primary. See MySql::runCommand.
+         */
+        /// @{
+        template <typename... Args>
+        my_ulonglong runCommand(const char* const command, const Args&... args);
+        my_ulonglong runCommand(const char* const command);
+        /// @}
+
+        /**
+         * Runs a query on the least loaded replica, or on the primary if
+         * there are no replicas or if reads are pinned after a recent write.
+         * See MySql::runQuery.
+         */
+        template <typename... InputArgs, typename... OutputArgs>
+        void runQuery(
+            std::vector<std::tuple<OutputArgs...>>* const results,
+            const char* const query,
+            const InputArgs&... args);
+
+        /**
+         * Calls function with the primary connection while holding its lock,
+         * e.g. to run a transaction. This counts as a write for
+         * read-your-writes pinning.
+         */
+        template <typename Function>
+        void runOnPrimary(Function function);
+
+    private:
+        struct Connection {
+            explicit Connection(std::unique_ptr<MySql> connection);
+
+            std::unique_ptr<MySql> connection_;
+            std::mutex mutex_;
+            std::atomic<unsigned int> outstanding_;
+        };
+
+        /**
+         * Keeps a connection's outstanding request count accurate even if
+         * the query throws.
+         */
+        class OutstandingRequest {
+            public:
+                explicit OutstandingRequest(Connection* connection);
+                ~OutstandingRequest();
+
+                OutstandingRequest(const OutstandingRequest&) = delete;
+                OutstandingRequest& operator=(
+                    const OutstandingRequest&) = delete;
+            private:
+                Connection* const connection_;
+        };
+
+        /**
+         * Records a write both when it starts and when it finishes, even if
+         * it throws, so that reads stay pinned for the whole window after a
+         * write that takes longer than the window.
+         */
+        class RecordedWrite {
+            public:
+                explicit RecordedWrite(MySqlReplicaRouter* router);
+                ~RecordedWrite();
+
+                RecordedWrite(const RecordedWrite&) = delete;
+                RecordedWrite& operator=(const RecordedWrite&) = delete;
+            private:
+                MySqlReplicaRouter* const router_;
+        };
+
+        Connection* chooseReadConnection();
+        void recordWrite();
+
+        std::unique_ptr<Connection> primary_;
+        std::vector<std::unique_ptr<Connection>> replicas_;
+        // Both are steady_clock ticks, so that they can be atomic
+        std::atomic<std::chrono::steady_clock::rep> readYourWritesWindow_;
+        std::atomic<std::chrono::steady_clock::rep> lastWrite_;
+};
+
+
+template <typename... Args>
+my_ulonglong MySqlReplicaRouter::runCommand(
+    const char* const command,
+    const Args&... args
+) {
+    OutstandingRequest request(primary_.get());
+    std::lock_guard<std::mutex> lock(primary_->mutex_);
+    // Record the write before running it so that a concurrent read can't
+    // slip through to a replica between the write and the recording
+    RecordedWrite write(this);
+    return primary_->connection_->runCommand(command, args...);
+}
+
+
+template <typename... InputArgs, typename... OutputArgs>
+void MySqlReplicaRouter::runQuery(
+    std::vector<std::tuple<OutputArgs...>>* const results,
+    const char* const query,
+    const InputArgs&... args
+) {
+    Connection* const connection = chooseReadConnection();
+    OutstandingRequest request(connection);
+    std::lock_guard<std::mutex> lock(connection->mutex_);
+    connection->connection_->runQuery(results, query, args...);
+}
+
+
+template <typename Function>
+void MySqlReplicaRouter::runOnPrimary(Function function) {
+    OutstandingRequest request(primary_.get());
+    std::lock_guard<std::mutex> lock(primary_->mutex_);
+    RecordedWrite write(this);
+    function(*primary_->connection_);
+}
+
+
+#endif  // MYSQL_REPLICA_ROUTER_HPP_
@@ -0,0 +1,136 @@
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+#include "MySqlRetryExecutor.hpp"
+#include "MySqlTransaction.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <mysql/mysqld_error.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+
+using std::function;
+using std::min;
+
+
+MySqlRetryExecutor::MySqlRetryExecutor(MySql* const connection)
+    : connection_(connection)
+    , maximumAttempts_(5)
+    , initialDelay_(10)
+    , maximumDelay_(1000)
+    , random_(std::random_device()())
+    , commitCount_(0)
+    , retryCount_(0)
+    , deadlockCount_(0)
+    , lockWaitTimeoutCount_(0)
+    , exhaustedCount_(0)
+{
+    assert(nullptr != connection_);
+}
+
+
+MySqlRetryExecutor& MySqlRetryExecutor::setMaximumAttempts(
+    const unsigned int attempts
+) {
+    if (0 == attempts) {
+        throw MySqlException("Retry attempts must be at least 1");
+    }
+    maximumAttempts_ = attempts;
+    return *this;
+}
+
+
+MySqlRetryExecutor& MySqlRetryExecutor::setBackoff(
+    const unsigned int initialMilliseconds,
+    const unsigned int maximumMilliseconds
+) {
+    if (initialMilliseconds > maximumMilliseconds) {
+        throw MySqlException(
+            "Initial retry delay can't be longer than the maximum delay");
+    }
+    initialDelay_ = initialMilliseconds;
+    maximumDelay_ = maximumMilliseconds;
+    return *this;
+}
+
+
+void MySqlRetryExecutor::run(const function<void()>& commands) {
+    unsigned int delay = initialDelay_;
+    for (unsigned int attempt = 1; ; ++attempt) {
+        try {
+            // Rolled back before the catch runs, so the locks are released
+            // before waiting
+            MySqlTransaction transaction(connection_);
+            commands();
+            transaction.commit();
+            commitCount_.fetch_add(1);
+            return;
+        } catch (const MySqlException& exception) {
+            if (!isRetryable(exception)) {
+                throw;
+            }
+            if (ER_LOCK_DEADLOCK == exception.getErrorNumber()) {
+                deadlockCount_.fetch_add(1);
+            } else {
+                lockWaitTimeoutCount_.fetch_add(1);
+            }
+            if (attempt >= maximumAttempts_) {
+                exhaustedCount_.fetch_add(1);
+                throw;
+            }
+        }
+
+        retryCount_.fetch_add(1);
+        waitBeforeRetry(delay);
+        delay = min(delay * 2, maximumDelay_);
+    }
+}
+
+
+bool MySqlRetryExecutor::isRetryable(const MySqlException& exception) {
+    switch (exception.getErrorNumber()) {
+        case ER_LOCK_DEADLOCK:
+        case ER_LOCK_WAIT_TIMEOUT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+uint64_t MySqlRetryExecutor::getCommitCount() const {
+    return commitCount_.load();
+}
+
+
+uint64_t MySqlRetryExecutor::getRetryCount() const {
+    return retryCount_.load();
+}
+
+
+uint64_t MySqlRetryExecutor::getDeadlockCount() const {
+    return deadlockCount_.load();
+}
+
+
+uint64_t MySqlRetryExecutor::getLockWaitTimeoutCount() const {
+    return lockWaitTimeoutCount_.load();
+}
+
+
+uint64_t MySqlRetryExecutor::getExhaustedCount() const {
+    return exhaustedCount_.load();
+}
+
+
+void MySqlRetryExecutor::waitBeforeRetry(const unsigned int maximumDelay) {
+    // Anywhere from no delay up to the maximum spreads out the retries better
+    // than a fixed delay with a little noise added
+    std::uniform_int_distribution<unsigned int> distribution(0, maximumDelay);
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(distribution(random_)));
+}
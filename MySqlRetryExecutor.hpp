@@ -0,0 +1,92 @@
+#ifndef MYSQL_RETRY_EXECUTOR_HPP_
+#define MYSQL_RETRY_EXECUTOR_HPP_
+
+#include <cstdint>
+
+#include <atomic>
+#include <functional>
+#include <random>
+
+class MySql;
+class MySqlException;
+
+/**
+ * Runs a function in a transaction, and if it fails because of a deadlock or
+ * a lock wait timeout, rolls the transaction back and runs the function again
+ * after a randomized delay. The delays double after every attempt, and are
+ * randomized so that the transactions that collided don't collide again.
+ *
+ *     MySqlRetryExecutor executor(&connection);
+ *     executor.run([&]() {
+ *         connection.runCommand("UPDATE account SET ... WHERE id = ?", from);
+ *         connection.runCommand("UPDATE account SET ... WHERE id = ?", to);
+ *     });
+ *
+ * The function may be run several times, so it shouldn't have side effects
+ * outside of the database, or should undo them at the start. The counts can
+ * be read from any thread.
+ */
+class MySqlRetryExecutor {
+    public:
+        explicit MySqlRetryExecutor(MySql* connection);
+
+        MySqlRetryExecutor(const MySqlRetryExecutor& rhs) = delete;
+        MySqlRetryExecutor(MySqlRetryExecutor&& rhs) = delete;
+        MySqlRetryExecutor& operator=(const MySqlRetryExecutor& rhs) = delete;
+        MySqlRetryExecutor& operator=(MySqlRetryExecutor&& rhs) = delete;
+
+        /**
+         * How many times the function is run before giving up, including the
+         * first. Defaults to 5.
+         */
+        MySqlRetryExecutor& setMaximumAttempts(unsigned int attempts);
+        /**
+         * The longest delay before the first retry and before any retry, in
+         * milliseconds. Defaults to 10 and 1000.
+         */
+        MySqlRetryExecutor& setBackoff(
+            unsigned int initialMilliseconds,
+            unsigned int maximumMilliseconds);
+
+        /**
+         * Starts a transaction, runs the function and commits. Must not be
+         * called inside another transaction.
+         * @throws MySqlException Errors that can't be retried are thrown
+         *     right away, and retryable ones once the attempts run out.
+         */
+        void run(const std::function<void()>& commands);
+
+        /**
+         * If the error is a deadlock or lock wait timeout.
+         */
+        static bool isRetryable(const MySqlException& exception);
+
+        /**
+         * Counts since the executor was created.
+         */
+        /// @{
+        uint64_t getCommitCount() const;
+        uint64_t getRetryCount() const;
+        uint64_t getDeadlockCount() const;
+        uint64_t getLockWaitTimeoutCount() const;
+        // Transactions that were given up on after running out of attempts
+        uint64_t getExhaustedCount() const;
+        /// @}
+
+    private:
+        void waitBeforeRetry(unsigned int maximumDelay);
+
+        MySql* const connection_;
+        unsigned int maximumAttempts_;
+        unsigned int initialDelay_;
+        unsigned int maximumDelay_;
+        std::mt19937 random_;
+
+        std::atomic<uint64_t> commitCount_;
+        std::atomic<uint64_t> retryCount_;
+        std::atomic<uint64_t> deadlockCount_;
+        std::atomic<uint64_t> lockWaitTimeoutCount_;
+        std::atomic<uint64_t> exhaustedCount_;
+};
+
+#endif  // MYSQL_RETRY_EXECUTOR_HPP_
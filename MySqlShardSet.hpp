@@ -0,0 +1,409 @@
+#ifndef MYSQL_SHARD_SET_HPP_
+#define MYSQL_SHARD_SET_HPP_
+
+#include <cassert>
+#include <mysql/mysql.h>
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+
+/**
+ * A set of connections to shards that hold disjoint parts of the same tables.
+ * Point operations go to the shard chosen by the shard function, and
+ * scatter-gather queries run on every shard in parallel. Every shard is
+ * guarded by its own mutex, so a shard set can be shared between threads.
+ *
+ *     MySqlShardSet<int64_t> shards;
+ *     shards.addShard(std::unique_ptr<MySql>(new MySql(...)));
+ *     shards.addShard(std::unique_ptr<MySql>(new MySql(...)));
+ *     shards.runCommand(
+ *         userId,
+ *         "INSERT INTO user (id, name) VALUES (?, ?)",
+ *         userId,
+ *         name);
+ *     shards.runQueryOnAll(&users, "SELECT id, name FROM user");
+ */
+template <typename Key>
+class MySqlShardSet {
+    public:
+        /**
+         * Maps a key to a shard index in [0, shardCount).
+         */
+        typedef std::function<size_t(const Key& key, size_t shardCount)>
+            ShardFunction;
+
+        /**
+         * Uses hashSharding.
+         */
+        MySqlShardSet();
+        explicit MySqlShardSet(ShardFunction shardFunction);
+
+        MySqlShardSet(const MySqlShardSet& rhs) = delete;
+        MySqlShardSet(MySqlShardSet&& rhs) = delete;
+        MySqlShardSet& operator=(const MySqlShardSet& rhs) = delete;
+        MySqlShardSet& operator=(MySqlShardSet&& rhs) = delete;
+
+        /**
+         * Shards std::hash<Key> modulo the number of shards.
+         */
+        static ShardFunction hashSharding();
+        /**
+         * Shard i holds the keys less than upperBounds[i] and at least
+         * upperBounds[i - 1]. Keys at least as big as the last bound go to an
+         * extra, final shard, so there should be upperBounds.size() + 1
+         * shards.
+         */
+        static ShardFunction rangeSharding(std::vector<Key> upperBounds);
+
+        /**
+         * Adds a shard. This isn't thread safe, so add all of the shards
+         * before sharing the shard set.
+         */
+        void addShard(std::unique_ptr<MySql> shard);
+
+        size_t getShardCount() const;
+        size_t getShardIndex(const Key& key) const;
+
+        /**
+         * Runs a command on the shard that holds key. See MySql::runCommand.
+         */
+        template <typename... Args>
+        my_ulonglong runCommand(
+            const Key& key,
+            const char* const command,
+            const Args&... args);
+
+        /**
+         * Runs a query on the shard that holds key. See MySql::runQuery.
+         */
+        template <typename... InputArgs, typename... OutputArgs>
+        void runQuery(
+            std::vector<std::tuple<OutputArgs...>>* const results,
+            const Key& key,
+            const char* const query,
+            const InputArgs&... args);
+
+        /**
+         * Runs a query on every shard in parallel and appends all of the
+         * results, in shard order. If any shard fails, the first exception is
+         * rethrown after all of the shards have finished.
+         */
+        template <typename... InputArgs, typename... OutputArgs>
+        void runQueryOnAll(
+            std::vector<std::tuple<OutputArgs...>>* const results,
+            const char* const query,
+            const InputArgs&... args);
+
+        /**
+         * Like runQueryOnAll, but merges the shards' results so that they're
+         * sorted by column SortColumn. The query needs to sort by that column
+         * in ascending order on every shard, and the column can't be a smart
+         * pointer type.
+         *
+         * Columns are compared with <, which compares strings byte by byte,
+         * but the server sorts strings by the column's collation, which is
+         * case insensitive by default. Either sort string columns with a
+         * binary collation, e.g. ORDER BY BINARY name, or pass a less
+         * function that matches the collation.
+         */
+        /// @{
+        template <size_t SortColumn, typename... InputArgs,
+            typename... OutputArgs>
+        void runSortedQueryOnAll(
+            std::vector<std::tuple<OutputArgs...>>* const results,
+            const char* const query,
+            const InputArgs&... args);
+        // The enable_if keeps a query with a const char* argument from
+        // matching this overload
+        template <size_t SortColumn, typename Less, typename... InputArgs,
+            typename... OutputArgs>
+        typename std::enable_if<!std::is_convertible<Less, const char*>::value>
+            ::type runSortedQueryOnAll(
+                std::vector<std::tuple<OutputArgs...>>* const results,
+                Less less,
+                const char* const query,
+                const InputArgs&... args);
+        /// @}
+
+    private:
+        struct Shard {
+            explicit Shard(std::unique_ptr<MySql> connection)
+                : connection_(std::move(connection))
+                , mutex_()
+            {
+            }
+
+            std::unique_ptr<MySql> connection_;
+            std::mutex mutex_;
+        };
+
+        template <typename... InputArgs, typename... OutputArgs>
+        void gather(
+            std::vector<std::vector<std::tuple<OutputArgs...>>>* const
+                shardResults,
+            const char* const query,
+            const InputArgs&... args);
+
+        Shard& getShard(const Key& key);
+
+        ShardFunction shardFunction_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+
+template <typename Key>
+MySqlShardSet<Key>::MySqlShardSet()
+    : shardFunction_(hashSharding())
+    , shards_()
+{
+}
+
+
+template <typename Key>
+MySqlShardSet<Key>::MySqlShardSet(ShardFunction shardFunction)
+    : shardFunction_(std::move(shardFunction))
+    , shards_()
+{
+}
+
+
+template <typename Key>
+typename MySqlShardSet<Key>::ShardFunction MySqlShardSet<Key>::hashSharding() {
+    return [](const Key& key, const size_t shardCount) -> size_t {
+        return std::hash<Key>()(key) % shardCount;
+    };
+}
+
+
+template <typename Key>
+typename MySqlShardSet<Key>::ShardFunction MySqlShardSet<Key>::rangeSharding(
+    std::vector<Key> upperBounds
+) {
+    if (!std::is_sorted(upperBounds.begin(), upperBounds.end())) {
+        throw MySqlException("Shard range bounds must be sorted");
+    }
+    return [upperBounds](const Key& key, const size_t) -> size_t {
+        return static_cast<size_t>(std::distance(
+            upperBounds.begin(),
+            std::upper_bound(upperBounds.begin(), upperBounds.end(), key)));
+    };
+}
+
+
+template <typename Key>
+void MySqlShardSet<Key>::addShard(std::unique_ptr<MySql> shard) {
+    if (nullptr == shard) {
+        throw MySqlException("Shard connection is required");
+    }
+    shards_.emplace_back(new Shard(std::move(shard)));
+}
+
+
+template <typename Key>
+size_t MySqlShardSet<Key>::getShardCount() const {
+    return shards_.size();
+}
+
+
+template <typename Key>
+size_t MySqlShardSet<Key>::getShardIndex(const Key& key) const {
+    if (shards_.empty()) {
+        throw MySqlException("No shards have been added");
+    }
+    const size_t index = shardFunction_(key, shards_.size());
+    if (index >= shards_.size()) {
+        throw MySqlException("Shard function returned an invalid shard");
+    }
+    return index;
+}
+
+
+template <typename Key>
+typename MySqlShardSet<Key>::Shard& MySqlShardSet<Key>::getShard(
+    const Key& key
+) {
+    return *shards_.at(getShardIndex(key));
+}
+
+
+template <typename Key>
+template <typename... Args>
+my_ulonglong MySqlShardSet<Key>::runCommand(
+    const Key& key,
+    const char* const command,
+    const Args&... args
+) {
+    Shard& shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    return shard.connection_->runCommand(command, args...);
+}
+
+
+template <typename Key>
+template <typename... InputArgs, typename... OutputArgs>
+void MySqlShardSet<Key>::runQuery(
+    std::vector<std::tuple<OutputArgs...>>* const results,
+    const Key& key,
+    const char* const query,
+    const InputArgs&... args
+) {
+    Shard& shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    shard.connection_->runQuery(results, query, args...);
+}
+
+
+template <typename Key>
+template <typename... InputArgs, typename... OutputArgs>
+void MySqlShardSet<Key>::gather(
+    std::vector<std::vector<std::tuple<OutputArgs...>>>* const shardResults,
+    const char* const query,
+    const InputArgs&... args
+) {
+    shardResults->resize(shards_.size());
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(shards_.size());
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        Shard* const shard = shards_.at(i).get();
+        std::vector<std::tuple<OutputArgs...>>* const shardResult =
+            &shardResults->at(i);
+        futures.push_back(std::async(
+            std::launch::async,
+            [shard, shardResult, query, &args...]() {
+                std::lock_guard<std::mutex> lock(shard->mutex_);
+                shard->connection_->runQuery(shardResult, query, args...);
+            }));
+    }
+
+    // Wait for every shard before throwing so that no thread outlives the
+    // arguments that it references
+    std::exception_ptr firstError;
+    for (auto& future : futures) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+
+template <typename Key>
+template <typename... InputArgs, typename... OutputArgs>
+void MySqlShardSet<Key>::runQueryOnAll(
+    std::vector<std::tuple<OutputArgs...>>* const results,
+    const char* const query,
+    const InputArgs&... args
+) {
+    assert(nullptr != results);
+    std::vector<std::vector<std::tuple<OutputArgs...>>> shardResults;
+    gather(&shardResults, query, args...);
+
+    size_t total = results->size();
+    for (const auto& shardResult : shardResults) {
+        total += shardResult.size();
+    }
+    results->reserve(total);
+    for (auto& shardResult : shardResults) {
+        std::move(
+            shardResult.begin(),
+            shardResult.end(),
+            std::back_inserter(*results));
+    }
+}
+
+
+template <typename Key>
+template <size_t SortColumn, typename... InputArgs, typename... OutputArgs>
+void MySqlShardSet<Key>::runSortedQueryOnAll(
+    std::vector<std::tuple<OutputArgs...>>* const results,
+    const char* const query,
+    const InputArgs&... args
+) {
+    static_assert(
+        SortColumn < sizeof...(OutputArgs),
+        "Sort column is out of range");
+    typedef typename std::tuple_element<
+        SortColumn,
+        std::tuple<OutputArgs...>>::type Column;
+    runSortedQueryOnAll<SortColumn>(
+        results,
+        std::less<Column>(),
+        query,
+        args...);
+}
+
+
+template <typename Key>
+template <size_t SortColumn, typename Less, typename... InputArgs,
+    typename... OutputArgs>
+typename std::enable_if<!std::is_convertible<Less, const char*>::value>::type
+MySqlShardSet<Key>::runSortedQueryOnAll(
+    std::vector<std::tuple<OutputArgs...>>* const results,
+    Less less,
+    const char* const query,
+    const InputArgs&... args
+) {
+    assert(nullptr != results);
+    static_assert(
+        SortColumn < sizeof...(OutputArgs),
+        "Sort column is out of range");
+    std::vector<std::vector<std::tuple<OutputArgs...>>> shardResults;
+    gather(&shardResults, query, args...);
+
+    size_t total = results->size();
+    for (const auto& shardResult : shardResults) {
+        total += shardResult.size();
+    }
+    results->reserve(total);
+
+    // K-way merge. Each entry is (shard, position in that shard's results),
+    // and the heap keeps the smallest unmerged row on top.
+    typedef std::pair<size_t, size_t> Cursor;
+    const auto greater = [&shardResults, &less](
+        const Cursor& a,
+        const Cursor& b
+    ) {
+        return less(
+            std::get<SortColumn>(shardResults[b.first][b.second]),
+            std::get<SortColumn>(shardResults[a.first][a.second]));
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heap(
+        greater);
+    for (size_t i = 0; i < shardResults.size(); ++i) {
+        if (!shardResults[i].empty()) {
+            heap.push(Cursor(i, 0));
+        }
+    }
+    while (!heap.empty()) {
+        const Cursor cursor = heap.top();
+        heap.pop();
+        auto& shardResult = shardResults[cursor.first];
+        results->push_back(std::move(shardResult[cursor.second]));
+        if (cursor.second + 1 < shardResult.size()) {
+            heap.push(Cursor(cursor.first, cursor.second + 1));
+        }
+    }
+}
+
+
+#endif  // MYSQL_SHARD_SET_HPP_
@@ -0,0 +1,273 @@
+#include "MySqlException.hpp"
+#include "MySqlSharedCache.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+using std::atomic;
+using std::chrono::milliseconds;
+using std::chrono::system_clock;
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
+using std::memory_order_release;
+using std::string;
+
+// The file layout. This has to stay the same for every process that shares a
+// file, so bump FILE_VERSION whenever it changes.
+static const uint64_t FILE_MAGIC = 0x6568636163707063ULL;  // "cppcache"
+static const uint32_t FILE_VERSION = 1;
+
+struct FileHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t slotCount;
+    uint64_t slotSize;
+};
+
+// Followed by the key and then the value
+struct MySqlSharedCache::SlotHeader {
+    // Odd while a writer is modifying the slot
+    atomic<uint64_t> sequence;
+    uint64_t keyHash;
+    // system_clock ticks
+    int64_t expires;
+    uint64_t keyLength;
+    uint64_t valueLength;
+};
+
+static_assert(
+    ATOMIC_LLONG_LOCK_FREE == 2,
+    "Sequence numbers need lock free 64-bit atomics to work across processes");
+
+// Readers give up after this many attempts, which only happens if writers
+// keep replacing the slot
+static const int MAXIMUM_READ_ATTEMPTS = 4;
+
+// Round up so that every slot's sequence number is aligned
+static size_t alignSize(const size_t size) {
+    return (size + 63) & ~static_cast<size_t>(63);
+}
+
+
+static uint64_t hashKey(const string& key) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+static string getSystemErrorMessage(const char* const prefix) {
+    string message(prefix);
+    message += ": ";
+    message += std::strerror(errno);
+    return message;
+}
+
+
+MySqlSharedCache::MySqlSharedCache(
+    const char* const path,
+    const size_t slotCount,
+    const size_t slotSize,
+    const milliseconds timeToLive
+)
+    : timeToLive_(timeToLive)
+    , slotCount_(slotCount)
+    , slotSize_(alignSize(slotSize))
+    , mappingSize_(alignSize(sizeof(FileHeader)) + slotCount_ * slotSize_)
+    , mapping_(nullptr)
+{
+    assert(nullptr != path);
+    if (0 == slotCount || slotSize <= sizeof(SlotHeader)) {
+        throw MySqlException("Shared cache slots are too small");
+    }
+
+    const int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (-1 == fd) {
+        throw MySqlException(getSystemErrorMessage(
+            "Unable to open shared cache file"));
+    }
+
+    // Only one process should initialize a new file
+    if (0 != flock(fd, LOCK_EX)) {
+        const string errorMessage(getSystemErrorMessage(
+            "Unable to lock shared cache file"));
+        close(fd);
+        throw MySqlException(errorMessage);
+    }
+
+    struct stat status;
+    if (0 != fstat(fd, &status)) {
+        const string errorMessage(getSystemErrorMessage(
+            "Unable to stat shared cache file"));
+        close(fd);
+        throw MySqlException(errorMessage);
+    }
+    const bool isNew = (0 == status.st_size);
+    if (isNew) {
+        if (0 != ftruncate(fd, static_cast<off_t>(mappingSize_))) {
+            const string errorMessage(getSystemErrorMessage(
+                "Unable to size shared cache file"));
+            close(fd);
+            throw MySqlException(errorMessage);
+        }
+    } else if (static_cast<size_t>(status.st_size) != mappingSize_) {
+        close(fd);
+        throw MySqlException(
+            "Shared cache file was created with a different size");
+    }
+
+    void* const mapping = mmap(
+        nullptr,
+        mappingSize_,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        fd,
+        0);
+    if (MAP_FAILED == mapping) {
+        const string errorMessage(getSystemErrorMessage(
+            "Unable to map shared cache file"));
+        close(fd);
+        throw MySqlException(errorMessage);
+    }
+    mapping_ = static_cast<char*>(mapping);
+
+    FileHeader* const header = reinterpret_cast<FileHeader*>(mapping_);
+    if (isNew) {
+        // ftruncate zero fills, so every slot starts empty with an even
+        // sequence number
+        header->magic = FILE_MAGIC;
+        header->version = FILE_VERSION;
+        header->headerSize = static_cast<uint32_t>(sizeof(FileHeader));
+        header->slotCount = slotCount_;
+        header->slotSize = slotSize_;
+    }
+    const bool isValid = (
+        FILE_MAGIC == header->magic
+        && FILE_VERSION == header->version
+        && sizeof(FileHeader) == header->headerSize
+        && slotCount_ == header->slotCount
+        && slotSize_ == header->slotSize);
+
+    // The mapping stays valid after the file is closed
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    if (!isValid) {
+        munmap(mapping_, mappingSize_);
+        mapping_ = nullptr;
+        throw MySqlException(
+            "Shared cache file has an incompatible format");
+    }
+}
+
+
+MySqlSharedCache::~MySqlSharedCache() {
+    if (nullptr != mapping_) {
+        munmap(mapping_, mappingSize_);
+    }
+}
+
+
+MySqlSharedCache::SlotHeader* MySqlSharedCache::getSlot(
+    const uint64_t hash
+) const {
+    const size_t index = static_cast<size_t>(hash % slotCount_);
+    return reinterpret_cast<SlotHeader*>(
+        mapping_ + alignSize(sizeof(FileHeader)) + index * slotSize_);
+}
+
+
+bool MySqlSharedCache::find(const string& key, string* const value) const {
+    const uint64_t hash = hashKey(key);
+    SlotHeader* const slot = getSlot(hash);
+    const char* const data = reinterpret_cast<const char*>(slot + 1);
+    const size_t capacity = slotSize_ - sizeof(SlotHeader);
+
+    for (int attempt = 0; attempt < MAXIMUM_READ_ATTEMPTS; ++attempt) {
+        const uint64_t before = slot->sequence.load(memory_order_acquire);
+        if (0 != (before & 1)) {
+            // A writer is active
+            continue;
+        }
+        // Copy everything out before checking anything, because the values
+        // are only meaningful if the sequence number didn't change
+        const uint64_t keyHash = slot->keyHash;
+        const int64_t expires = slot->expires;
+        const uint64_t keyLength = slot->keyLength;
+        const uint64_t valueLength = slot->valueLength;
+        bool matches = (
+            hash == keyHash
+            && keyLength == key.size()
+            && keyLength + valueLength <= capacity);
+        if (matches) {
+            matches = (0 == std::memcmp(data, key.data(), key.size()));
+        }
+        if (matches) {
+            value->assign(
+                data + keyLength,
+                static_cast<size_t>(valueLength));
+        }
+
+        std::atomic_thread_fence(memory_order_acquire);
+        const uint64_t after = slot->sequence.load(memory_order_relaxed);
+        if (before != after) {
+            continue;
+        }
+        if (!matches) {
+            return false;
+        }
+        return system_clock::now().time_since_epoch().count() < expires;
+    }
+    return false;
+}
+
+
+bool MySqlSharedCache::store(const string& key, const string& value) {
+    const size_t capacity = slotSize_ - sizeof(SlotHeader);
+    if (key.size() + value.size() > capacity) {
+        return false;
+    }
+
+    const uint64_t hash = hashKey(key);
+    SlotHeader* const slot = getSlot(hash);
+    uint64_t sequence = slot->sequence.load(memory_order_relaxed);
+    if (0 != (sequence & 1)
+        || !slot->sequence.compare_exchange_strong(
+            sequence,
+            sequence + 1,
+            memory_order_acquire)
+    ) {
+        // Somebody else is writing this slot, so just let them win
+        return false;
+    }
+    // Keep the writes below from being reordered before the sequence change
+    std::atomic_thread_fence(memory_order_release);
+
+    char* const data = reinterpret_cast<char*>(slot + 1);
+    slot->keyHash = hash;
+    slot->expires = (system_clock::now() + timeToLive_)
+        .time_since_epoch().count();
+    slot->keyLength = key.size();
+    slot->valueLength = value.size();
+    std::memcpy(data, key.data(), key.size());
+    std::memcpy(data + key.size(), value.data(), value.size());
+
+    slot->sequence.store(sequence + 2, memory_order_release);
+    return true;
+}
@@ -0,0 +1,355 @@
+#ifndef MYSQL_SHARED_CACHE_HPP_
+#define MYSQL_SHARED_CACHE_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <mysql/mysql.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+#include "MySqlQueryCache.hpp"
+
+namespace MySqlSharedCachePrivate {
+
+static const char TRUNCATED_ERROR_MESSAGE[] = \
+    "Shared cache entry is truncated";
+
+template<int I> struct int_ {};  // Compile-time counter
+
+/**
+ * Converts result values to and from bytes. Values are stored in native byte
+ * order because the cache is only shared between processes on one host.
+ */
+template <typename T>
+class SharedCacheSerializer {
+    public:
+        static void write(const T&, std::string* const) {
+            static_assert(
+                // C++ guarantees that the sizeof any type >= 0, so this will
+                // always give a compile time error
+                sizeof(T) < 0,
+                "All types need to have template specialized instances"
+                " defined for them, but one is missing for type T.");
+        }
+};
+
+#ifndef SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION
+#define SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(type) \
+template <> \
+class SharedCacheSerializer<type> { \
+    public: \
+        static void write(const type& value, std::string* const out) { \
+            out->append( \
+                reinterpret_cast<const char*>(&value), \
+                sizeof(value)); \
+        } \
+        static const char* read( \
+            type* const value, \
+            const char* const in, \
+            const char* const end \
+        ) { \
+            if (static_cast<size_t>(end - in) < sizeof(type)) { \
+                throw MySqlException(TRUNCATED_ERROR_MESSAGE); \
+            } \
+            std::memcpy(value, in, sizeof(type)); \
+            return in + sizeof(type); \
+        } \
+};
+#endif
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(int8_t)
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(uint8_t)
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(int16_t)
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(uint16_t)
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(int32_t)
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(uint32_t)
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(int64_t)
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(uint64_t)
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(float)
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(double)
+SHARED_CACHE_ARITHMETIC_SERIALIZER_SPECIALIZATION(char)
+
+template <>
+class SharedCacheSerializer<std::string> {
+    public:
+        static void write(const std::string& value, std::string* const out) {
+            const uint64_t length = value.length();
+            SharedCacheSerializer<uint64_t>::write(length, out);
+            out->append(value);
+        }
+        static const char* read(
+            std::string* const value,
+            const char* in,
+            const char* const end
+        ) {
+            uint64_t length;
+            in = SharedCacheSerializer<uint64_t>::read(&length, in, end);
+            if (static_cast<uint64_t>(end - in) < length) {
+                throw MySqlException(TRUNCATED_ERROR_MESSAGE);
+            }
+            value->assign(in, static_cast<size_t>(length));
+            return in + length;
+        }
+};
+
+// Smart pointers are a null flag followed by the value, if any
+template <typename T>
+class SharedCacheSerializer<std::shared_ptr<T>> {
+    public:
+        static void write(
+            const std::shared_ptr<T>& value,
+            std::string* const out
+        ) {
+            out->push_back(nullptr == value ? 0 : 1);
+            if (nullptr != value) {
+                SharedCacheSerializer<T>::write(*value, out);
+            }
+        }
+        static const char* read(
+            std::shared_ptr<T>* const value,
+            const char* in,
+            const char* const end
+        ) {
+            if (in == end) {
+                throw MySqlException(TRUNCATED_ERROR_MESSAGE);
+            }
+            if (0 == *in++) {
+                value->reset();
+                return in;
+            }
+            std::shared_ptr<T> newObject(new T);
+            in = SharedCacheSerializer<T>::read(newObject.get(), in, end);
+            *value = std::move(newObject);
+            return in;
+        }
+};
+template <typename T>
+class SharedCacheSerializer<std::unique_ptr<T>> {
+    public:
+        static void write(
+            const std::unique_ptr<T>& value,
+            std::string* const out
+        ) {
+            out->push_back(nullptr == value ? 0 : 1);
+            if (nullptr != value) {
+                SharedCacheSerializer<T>::write(*value, out);
+            }
+        }
+        static const char* read(
+            std::unique_ptr<T>* const value,
+            const char* in,
+            const char* const end
+        ) {
+            if (in == end) {
+                throw MySqlException(TRUNCATED_ERROR_MESSAGE);
+            }
+            if (0 == *in++) {
+                value->reset();
+                return in;
+            }
+            std::unique_ptr<T> newObject(new T);
+            in = SharedCacheSerializer<T>::read(newObject.get(), in, end);
+            *value = std::move(newObject);
+            return in;
+        }
+};
+
+// Tuples are written from the last element to the first, which is fine as
+// long as they're read in the same order
+template <typename Tuple>
+void writeTuple(const Tuple&, std::string* const, int_<-1>) {
+}
+template <typename Tuple, int I>
+void writeTuple(const Tuple& tuple, std::string* const out, int_<I>) {
+    SharedCacheSerializer<
+        typename std::tuple_element<I, Tuple>::type
+    >::write(std::get<I>(tuple), out);
+    writeTuple(tuple, out, int_<I - 1>());
+}
+template <typename Tuple>
+const char* readTuple(Tuple* const, const char* in, const char*, int_<-1>) {
+    return in;
+}
+template <typename Tuple, int I>
+const char* readTuple(
+    Tuple* const tuple,
+    const char* in,
+    const char* const end,
+    int_<I>
+) {
+    in = SharedCacheSerializer<
+        typename std::tuple_element<I, Tuple>::type
+    >::read(&std::get<I>(*tuple), in, end);
+    return readTuple(tuple, in, end, int_<I - 1>());
+}
+
+}  // namespace MySqlSharedCachePrivate
+
+
+/**
+ * Query result cache in a memory mapped file, so that one process's results
+ * can be reused by every process on the host that maps the same file.
+ *
+ * The file is a fixed number of fixed size slots. A key always maps to the
+ * same slot, and a new entry simply replaces whatever was in its slot, so
+ * results that don't fit in a slot aren't cached. Each slot is guarded by a
+ * sequence lock: readers never block and retry if a writer was active, and a
+ * writer that finds another writer in the slot just skips caching. Nothing
+ * is invalidated by writes; entries only expire.
+ *
+ * Every process needs to open the file with the same slot count and slot
+ * size. If a process dies in the middle of writing a slot, that slot stays
+ * unusable until the file is deleted.
+ */
+class MySqlSharedCache {
+    public:
+        MySqlSharedCache(
+            const char* path,
+            size_t slotCount,
+            size_t slotSize,
+            std::chrono::milliseconds timeToLive);
+        ~MySqlSharedCache();
+
+        MySqlSharedCache(const MySqlSharedCache& rhs) = delete;
+        MySqlSharedCache(MySqlSharedCache&& rhs) = delete;
+        MySqlSharedCache& operator=(const MySqlSharedCache& rhs) = delete;
+        MySqlSharedCache& operator=(MySqlSharedCache&& rhs) = delete;
+
+        /**
+         * Appends the cached results of the query, or runs the query on
+         * connection and caches the results if they aren't cached. See
+         * MySql::runQuery.
+         */
+        template <typename... InputArgs, typename... OutputArgs>
+        void runQuery(
+            const MySql& connection,
+            std::vector<std::tuple<OutputArgs...>>* const results,
+            const char* const query,
+            const InputArgs&... args);
+
+        /**
+         * Appends the cached results to results.
+         * @return True if the results were found.
+         */
+        template <typename... InputArgs, typename... OutputArgs>
+        bool get(
+            std::vector<std::tuple<OutputArgs...>>* const results,
+            const char* const query,
+            const InputArgs&... args) const;
+
+        /**
+         * Caches results, if they fit in a slot.
+         * @return True if the results were stored.
+         */
+        template <typename... InputArgs, typename... OutputArgs>
+        bool put(
+            const std::vector<std::tuple<OutputArgs...>>& results,
+            const char* const query,
+            const InputArgs&... args);
+
+    private:
+        struct SlotHeader;
+
+        bool find(const std::string& key, std::string* const value) const;
+        bool store(const std::string& key, const std::string& value);
+        SlotHeader* getSlot(uint64_t hash) const;
+
+        const std::chrono::system_clock::duration timeToLive_;
+        size_t slotCount_;
+        size_t slotSize_;
+        size_t mappingSize_;
+        char* mapping_;
+};
+
+
+template <typename... InputArgs, typename... OutputArgs>
+void MySqlSharedCache::runQuery(
+    const MySql& connection,
+    std::vector<std::tuple<OutputArgs...>>* const results,
+    const char* const query,
+    const InputArgs&... args
+) {
+    assert(nullptr != results);
+    if (get(results, query, args...)) {
+        return;
+    }
+    std::vector<std::tuple<OutputArgs...>> newResults;
+    connection.runQuery(&newResults, query, args...);
+    put(newResults, query, args...);
+    results->reserve(results->size() + newResults.size());
+    for (auto& row : newResults) {
+        results->push_back(std::move(row));
+    }
+}
+
+
+template <typename... InputArgs, typename... OutputArgs>
+bool MySqlSharedCache::get(
+    std::vector<std::tuple<OutputArgs...>>* const results,
+    const char* const query,
+    const InputArgs&... args
+) const {
+    assert(nullptr != results);
+    typedef std::vector<std::tuple<OutputArgs...>> Results;
+    std::string value;
+    if (!find(
+        MySqlQueryCache::makeKey(query, typeid(Results), args...),
+        &value)
+    ) {
+        return false;
+    }
+
+    const char* in = value.data();
+    const char* const end = in + value.size();
+    uint64_t rowCount;
+    in = MySqlSharedCachePrivate::SharedCacheSerializer<uint64_t>::read(
+        &rowCount,
+        in,
+        end);
+    results->reserve(results->size() + static_cast<size_t>(rowCount));
+    for (uint64_t i = 0; i < rowCount; ++i) {
+        std::tuple<OutputArgs...> row;
+        in = MySqlSharedCachePrivate::readTuple(
+            &row,
+            in,
+            end,
+            MySqlSharedCachePrivate::int_<sizeof...(OutputArgs) - 1>());
+        results->push_back(std::move(row));
+    }
+    return true;
+}
+
+
+template <typename... InputArgs, typename... OutputArgs>
+bool MySqlSharedCache::put(
+    const std::vector<std::tuple<OutputArgs...>>& results,
+    const char* const query,
+    const InputArgs&... args
+) {
+    typedef std::vector<std::tuple<OutputArgs...>> Results;
+    std::string value;
+    const uint64_t rowCount = results.size();
+    MySqlSharedCachePrivate::SharedCacheSerializer<uint64_t>::write(
+        rowCount,
+        &value);
+    for (const auto& row : results) {
+        MySqlSharedCachePrivate::writeTuple(
+            row,
+            &value,
+            MySqlSharedCachePrivate::int_<sizeof...(OutputArgs) - 1>());
+    }
+    return store(
+        MySqlQueryCache::makeKey(query, typeid(Results), args...),
+        value);
+}
+
+
+#endif  // MYSQL_SHARED_CACHE_HPP_
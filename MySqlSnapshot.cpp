@@ -0,0 +1,158 @@
+#include "MySqlException.hpp"
+#include "MySqlSnapshot.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+using MySqlSnapshotPrivate::MappedFile;
+using std::string;
+
+
+static string getSystemErrorMessage(
+    const char* const action,
+    const char* const path,
+    const int error
+) {
+    string message(action);
+    message += " ";
+    message += path;
+    message += ": ";
+    message += std::strerror(error);
+    return message;
+}
+
+
+void MySqlSnapshotPrivate::appendPadding(string* const file) {
+    assert(nullptr != file);
+    file->append((8 - file->size() % 8) % 8, '\0');
+}
+
+
+void MySqlSnapshotPrivate::writeFile(
+    const char* const path,
+    const string& contents
+) {
+    assert(nullptr != path);
+    const string temporaryPath(string(path) + ".tmp");
+    const int fileDescriptor = open(
+        temporaryPath.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+        0644);
+    if (-1 == fileDescriptor) {
+        throw MySqlException(getSystemErrorMessage(
+            "Unable to create",
+            temporaryPath.c_str(),
+            errno));
+    }
+
+    size_t written = 0;
+    while (written < contents.size()) {
+        const ssize_t status = write(
+            fileDescriptor,
+            contents.data() + written,
+            contents.size() - written);
+        if (-1 == status && EINTR == errno) {
+            continue;
+        }
+        if (-1 == status) {
+            const int error = errno;
+            close(fileDescriptor);
+            unlink(temporaryPath.c_str());
+            throw MySqlException(getSystemErrorMessage(
+                "Unable to write",
+                temporaryPath.c_str(),
+                error));
+        }
+        written += static_cast<size_t>(status);
+    }
+
+    // The data need to be on disk before the rename makes them visible
+    if (0 != fsync(fileDescriptor) || 0 != close(fileDescriptor)) {
+        const int error = errno;
+        unlink(temporaryPath.c_str());
+        throw MySqlException(getSystemErrorMessage(
+            "Unable to write",
+            temporaryPath.c_str(),
+            error));
+    }
+    if (0 != std::rename(temporaryPath.c_str(), path)) {
+        const int error = errno;
+        unlink(temporaryPath.c_str());
+        throw MySqlException(getSystemErrorMessage(
+            "Unable to rename snapshot to",
+            path,
+            error));
+    }
+}
+
+
+MappedFile::MappedFile(const char* const path)
+    : data_(nullptr)
+    , size_(0)
+{
+    assert(nullptr != path);
+    const int fileDescriptor = open(path, O_RDONLY | O_CLOEXEC);
+    if (-1 == fileDescriptor) {
+        throw MySqlException(getSystemErrorMessage(
+            "Unable to open",
+            path,
+            errno));
+    }
+
+    struct stat status;
+    if (0 != fstat(fileDescriptor, &status)) {
+        const int error = errno;
+        close(fileDescriptor);
+        throw MySqlException(getSystemErrorMessage(
+            "Unable to read the size of",
+            path,
+            error));
+    }
+    size_ = static_cast<size_t>(status.st_size);
+    if (0 == size_) {
+        close(fileDescriptor);
+        // Can't map an empty file, and it isn't a valid snapshot anyway
+        throw MySqlException(string("Empty snapshot file ") + path);
+    }
+
+    void* const data = mmap(
+        nullptr,
+        size_,
+        PROT_READ,
+        MAP_SHARED,
+        fileDescriptor,
+        0);
+    const int error = errno;
+    // The mapping keeps the file open
+    close(fileDescriptor);
+    if (MAP_FAILED == data) {
+        throw MySqlException(getSystemErrorMessage(
+            "Unable to map",
+            path,
+            error));
+    }
+    data_ = static_cast<const char*>(data);
+}
+
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+
+const char* MappedFile::getData() const {
+    return data_;
+}
+
+
+size_t MappedFile::getSize() const {
+    return size_;
+}
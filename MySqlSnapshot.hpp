@@ -0,0 +1,615 @@
+#ifndef MYSQL_SNAPSHOT_HPP_
+#define MYSQL_SNAPSHOT_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "MySqlException.hpp"
+#include "MySqlStringRef.hpp"
+
+namespace MySqlSnapshotPrivate {
+
+template<int I> struct int_ {};  // Compile-time counter
+
+static const char MAGIC[8] = {'M', 'Y', 'S', 'Q', 'L', 'S', 'N', 'P'};
+static const uint32_t VERSION = 1;
+// Set in the type code of columns that can be NULL
+static const uint32_t NULLABLE_FLAG = 0x100;
+static const uint32_t STRING_TYPE_CODE = 0x40;
+
+static const char NULL_VALUE_ERROR_MESSAGE[] =
+    "Null value encountered in snapshot column";
+
+/**
+ * The file starts with this, followed by a ColumnHeader for each column.
+ * Every offset is from the start of the file and is a multiple of 8.
+ */
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t columnCount;
+    uint64_t rowCount;
+};
+
+/**
+ * Each column has an optional null bitmap, with a set bit for each NULL,
+ * and a values array. Fixed width columns store one value per row. String
+ * columns store rowCount + 1 uint64 offsets into their data bytes.
+ */
+struct ColumnHeader {
+    uint32_t typeCode;
+    uint32_t padding;
+    uint64_t nullsOffset;
+    uint64_t valuesOffset;
+    uint64_t valuesLength;
+    uint64_t dataOffset;
+    uint64_t dataLength;
+};
+
+/**
+ * Pads the file to the next multiple of 8 bytes.
+ */
+void appendPadding(std::string* file);
+
+/**
+ * Writes the contents to a temporary file and renames it over path, so that
+ * readers never see a partial snapshot.
+ */
+void writeFile(const char* path, const std::string& contents);
+
+/**
+ * A read-only memory mapping of a whole file.
+ */
+class MappedFile {
+    public:
+        explicit MappedFile(const char* path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile& rhs) = delete;
+        MappedFile(MappedFile&& rhs) = delete;
+        MappedFile& operator=(const MappedFile& rhs) = delete;
+        MappedFile& operator=(MappedFile&& rhs) = delete;
+
+        const char* getData() const;
+        size_t getSize() const;
+
+    private:
+        const char* data_;
+        size_t size_;
+};
+
+
+/**
+ * How each type of column is stored.
+ */
+template <typename T, typename Enable = void>
+class ColumnTraits {
+    public:
+        static_assert(
+            // C++ guarantees that the sizeof any type >= 0, so this will
+            // always give a compile time error
+            sizeof(T) < 0,
+            "Unsupported snapshot column type");
+};
+
+template <typename T>
+class ColumnTraits<
+    T,
+    typename std::enable_if<std::is_arithmetic<T>::value>::type
+> {
+    public:
+        typedef T ValueType;
+        typedef T ViewType;
+        // Types with the same size and signedness are interchangeable, e.g.
+        // long and long long
+        static const uint32_t TYPE_CODE =
+            (std::is_floating_point<T>::value ? 0x20 : 0)
+            | (std::is_signed<T>::value ? 0x10 : 0)
+            | static_cast<uint32_t>(sizeof(T));
+
+        static bool isNull(const T&) {
+            return false;
+        }
+        static const T& getValue(const T& value) {
+            return value;
+        }
+        static void startColumn(std::string* const) {
+        }
+        static void append(
+            const T& value,
+            std::string* const values,
+            std::string* const
+        ) {
+            values->append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+        static uint64_t getValuesLength(const uint64_t rowCount) {
+            return rowCount * sizeof(T);
+        }
+        static T read(
+            const char* const values,
+            const char* const,
+            const uint64_t,
+            const uint64_t row
+        ) {
+            T value;
+            std::memcpy(&value, values + row * sizeof(T), sizeof(T));
+            return value;
+        }
+        static T toValue(const T value) {
+            return value;
+        }
+};
+
+template <>
+class ColumnTraits<std::string> {
+    public:
+        typedef std::string ValueType;
+        typedef MySqlStringRef ViewType;
+        static const uint32_t TYPE_CODE = STRING_TYPE_CODE;
+
+        static bool isNull(const std::string&) {
+            return false;
+        }
+        static const std::string& getValue(const std::string& value) {
+            return value;
+        }
+        static void startColumn(std::string* const values) {
+            const uint64_t offset = 0;
+            values->append(
+                reinterpret_cast<const char*>(&offset),
+                sizeof(offset));
+        }
+        static void append(
+            const std::string& value,
+            std::string* const values,
+            std::string* const data
+        ) {
+            data->append(value);
+            const uint64_t offset = data->size();
+            values->append(
+                reinterpret_cast<const char*>(&offset),
+                sizeof(offset));
+        }
+        static uint64_t getValuesLength(const uint64_t rowCount) {
+            return (rowCount + 1) * sizeof(uint64_t);
+        }
+        static MySqlStringRef read(
+            const char* const values,
+            const char* const data,
+            const uint64_t dataLength,
+            const uint64_t row
+        ) {
+            uint64_t offsets[2];
+            std::memcpy(
+                offsets,
+                values + row * sizeof(uint64_t),
+                sizeof(offsets));
+            if (offsets[0] > offsets[1] || offsets[1] > dataLength) {
+                throw MySqlException("Corrupt string offsets in snapshot");
+            }
+            return MySqlStringRef(
+                data + offsets[0],
+                static_cast<size_t>(offsets[1] - offsets[0]));
+        }
+        static std::string toValue(const MySqlStringRef& value) {
+            return value.str();
+        }
+};
+
+/**
+ * Smart pointers are stored as their pointee with a null bitmap.
+ */
+/// @{
+template <typename Pointer, typename T>
+class NullableColumnTraits {
+    public:
+        typedef T ValueType;
+        typedef typename ColumnTraits<T>::ViewType ViewType;
+        static const uint32_t TYPE_CODE =
+            ColumnTraits<T>::TYPE_CODE | NULLABLE_FLAG;
+
+        static bool isNull(const Pointer& value) {
+            return nullptr == value;
+        }
+        static const T& getValue(const Pointer& value) {
+            return *value;
+        }
+        static Pointer toValue(const ViewType& value) {
+            return Pointer(new T(ColumnTraits<T>::toValue(value)));
+        }
+};
+
+template <typename T>
+class ColumnTraits<std::shared_ptr<T>>
+    : public NullableColumnTraits<std::shared_ptr<T>, T> {
+};
+
+template <typename T>
+class ColumnTraits<std::unique_ptr<T>>
+    : public NullableColumnTraits<std::unique_ptr<T>, T> {
+};
+/// @}
+
+/**
+ * Whether a column has a null bitmap.
+ */
+template <typename T>
+struct IsNullable {
+    static const bool value =
+        0 != (ColumnTraits<T>::TYPE_CODE & NULLABLE_FLAG);
+};
+
+
+template <typename Tuple>
+void appendColumns(
+    const std::vector<Tuple>&,
+    std::vector<ColumnHeader>* const,
+    std::string* const,
+    int_<-1>
+) {
+}
+
+
+template <typename Tuple, int I>
+void appendColumns(
+    const std::vector<Tuple>& rows,
+    std::vector<ColumnHeader>* const headers,
+    std::string* const file,
+    int_<I>
+) {
+    // Columns are written in order, so do the earlier ones first
+    appendColumns(rows, headers, file, int_<I - 1>());
+
+    typedef typename std::tuple_element<I, Tuple>::type T;
+    typedef ColumnTraits<T> Traits;
+    typedef ColumnTraits<typename Traits::ValueType> ValueTraits;
+    ColumnHeader& header = headers->at(I);
+    header.typeCode = Traits::TYPE_CODE;
+
+    if (IsNullable<T>::value) {
+        header.nullsOffset = file->size();
+        std::string nulls((rows.size() + 7) / 8, '\0');
+        for (size_t row = 0; row < rows.size(); ++row) {
+            if (Traits::isNull(std::get<I>(rows.at(row)))) {
+                nulls.at(row / 8) = static_cast<char>(
+                    nulls.at(row / 8) | (1 << (row % 8)));
+            }
+        }
+        file->append(nulls);
+        appendPadding(file);
+    }
+
+    std::string values;
+    std::string data;
+    ValueTraits::startColumn(&values);
+    const typename Traits::ValueType empty = typename Traits::ValueType();
+    for (const auto& row : rows) {
+        const T& value = std::get<I>(row);
+        ValueTraits::append(
+            Traits::isNull(value) ? empty : Traits::getValue(value),
+            &values,
+            &data);
+    }
+    header.valuesOffset = file->size();
+    header.valuesLength = values.size();
+    file->append(values);
+    appendPadding(file);
+    header.dataOffset = file->size();
+    header.dataLength = data.size();
+    file->append(data);
+    appendPadding(file);
+}
+
+}  // namespace MySqlSnapshotPrivate
+
+
+/**
+ * A result set saved to a columnar file and mapped back in read-only, so
+ * that services can reload expensive query results on restart from the page
+ * cache instead of rerunning the queries.
+ *
+ *     vector<tuple<int64_t, string>> users;
+ *     connection.runQuery(&users, "SELECT id, name FROM user");
+ *     MySqlSnapshot<int64_t, string>::write("users.snapshot", users);
+ *
+ *     // After a restart
+ *     MySqlSnapshot<int64_t, string> snapshot("users.snapshot");
+ *     for (size_t i = 0; i < snapshot.size(); ++i) {
+ *         MySqlStringRef name = snapshot.get<1>(i);
+ *         ...
+ *     }
+ *
+ * Supported column types are arithmetic types, std::string, and
+ * std::shared_ptr or std::unique_ptr to those for columns that can be NULL.
+ * Values are stored in native byte order, so snapshots aren't portable
+ * between architectures.
+ */
+template <typename... Args>
+class MySqlSnapshot {
+    public:
+        typedef std::tuple<Args...> Row;
+
+        /**
+         * Opens a snapshot. Throws if the file isn't a snapshot of these
+         * column types.
+         */
+        explicit MySqlSnapshot(const char* path);
+
+        MySqlSnapshot(const MySqlSnapshot& rhs) = delete;
+        MySqlSnapshot(MySqlSnapshot&& rhs) = delete;
+        MySqlSnapshot& operator=(const MySqlSnapshot& rhs) = delete;
+        MySqlSnapshot& operator=(MySqlSnapshot&& rhs) = delete;
+
+        /**
+         * Saves rows as a snapshot, replacing any existing file.
+         */
+        static void write(const char* path, const std::vector<Row>& rows);
+
+        /**
+         * The number of rows.
+         */
+        size_t size() const;
+
+        template <size_t I>
+        bool isNull(size_t row) const;
+
+        /**
+         * Reads a value in place. Strings are returned as a MySqlStringRef
+         * into the file, and values of nullable columns as their pointee.
+         * Throws if the value is NULL.
+         */
+        template <size_t I>
+        typename MySqlSnapshotPrivate::ColumnTraits<
+            typename std::tuple_element<I, Row>::type
+        >::ViewType get(size_t row) const;
+
+        /**
+         * Copies a row into the tuple type that it was saved from.
+         */
+        Row getRow(size_t row) const;
+
+        /**
+         * Appends copies of every row.
+         */
+        void getRows(std::vector<Row>* rows) const;
+
+    private:
+        template <int I>
+        void setRowValues(
+            Row* values,
+            size_t row,
+            MySqlSnapshotPrivate::int_<I>) const;
+        void setRowValues(
+            Row* values,
+            size_t row,
+            MySqlSnapshotPrivate::int_<-1>) const;
+
+        template <int I>
+        void readColumnHeaders(MySqlSnapshotPrivate::int_<I>);
+        void readColumnHeaders(MySqlSnapshotPrivate::int_<-1>);
+
+        void checkRegion(uint64_t offset, uint64_t length) const;
+
+        const MySqlSnapshotPrivate::MappedFile file_;
+        uint64_t rowCount_;
+        std::vector<MySqlSnapshotPrivate::ColumnHeader> columns_;
+};
+
+
+template <typename... Args>
+MySqlSnapshot<Args...>::MySqlSnapshot(const char* const path)
+    : file_(path)
+    , rowCount_(0)
+    , columns_(sizeof...(Args))
+{
+    MySqlSnapshotPrivate::FileHeader header;
+    const size_t headersSize =
+        sizeof(header)
+        + sizeof(MySqlSnapshotPrivate::ColumnHeader) * sizeof...(Args);
+    if (file_.getSize() < headersSize) {
+        throw MySqlException("Snapshot file is too short");
+    }
+    std::memcpy(&header, file_.getData(), sizeof(header));
+    if (0 != std::memcmp(
+            header.magic,
+            MySqlSnapshotPrivate::MAGIC,
+            sizeof(header.magic))
+        || MySqlSnapshotPrivate::VERSION != header.version)
+    {
+        throw MySqlException("File isn't a snapshot of a supported version");
+    }
+    if (sizeof...(Args) != header.columnCount) {
+        throw MySqlException("Snapshot has a different number of columns");
+    }
+    // Every row takes at least a byte, which also keeps the sizes below from
+    // overflowing
+    if (header.rowCount > file_.getSize()) {
+        throw MySqlException("Snapshot has more rows than fit in the file");
+    }
+    rowCount_ = header.rowCount;
+    std::memcpy(
+        columns_.data(),
+        file_.getData() + sizeof(header),
+        sizeof(MySqlSnapshotPrivate::ColumnHeader) * sizeof...(Args));
+    readColumnHeaders(MySqlSnapshotPrivate::int_<sizeof...(Args) - 1>());
+}
+
+
+template <typename... Args>
+void MySqlSnapshot<Args...>::write(
+    const char* const path,
+    const std::vector<Row>& rows
+) {
+    MySqlSnapshotPrivate::FileHeader header;
+    std::memcpy(
+        header.magic,
+        MySqlSnapshotPrivate::MAGIC,
+        sizeof(header.magic));
+    header.version = MySqlSnapshotPrivate::VERSION;
+    header.columnCount = static_cast<uint32_t>(sizeof...(Args));
+    header.rowCount = rows.size();
+
+    // The column headers are filled in once the columns have been laid out
+    std::vector<MySqlSnapshotPrivate::ColumnHeader> columns(sizeof...(Args));
+    std::memset(
+        columns.data(),
+        0,
+        sizeof(MySqlSnapshotPrivate::ColumnHeader) * columns.size());
+    std::string file(
+        sizeof(header)
+            + sizeof(MySqlSnapshotPrivate::ColumnHeader) * columns.size(),
+        '\0');
+    MySqlSnapshotPrivate::appendColumns(
+        rows,
+        &columns,
+        &file,
+        MySqlSnapshotPrivate::int_<sizeof...(Args) - 1>());
+    std::memcpy(&file.at(0), &header, sizeof(header));
+    std::memcpy(
+        &file.at(sizeof(header)),
+        columns.data(),
+        sizeof(MySqlSnapshotPrivate::ColumnHeader) * columns.size());
+
+    MySqlSnapshotPrivate::writeFile(path, file);
+}
+
+
+template <typename... Args>
+size_t MySqlSnapshot<Args...>::size() const {
+    return static_cast<size_t>(rowCount_);
+}
+
+
+template <typename... Args>
+template <size_t I>
+bool MySqlSnapshot<Args...>::isNull(const size_t row) const {
+    typedef typename std::tuple_element<I, Row>::type T;
+    assert(row < rowCount_);
+    if (!MySqlSnapshotPrivate::IsNullable<T>::value) {
+        return false;
+    }
+    const unsigned char bits = static_cast<unsigned char>(
+        file_.getData()[columns_.at(I).nullsOffset + row / 8]);
+    return 0 != (bits & (1 << (row % 8)));
+}
+
+
+template <typename... Args>
+template <size_t I>
+typename MySqlSnapshotPrivate::ColumnTraits<
+    typename std::tuple_element<I, std::tuple<Args...>>::type
+>::ViewType MySqlSnapshot<Args...>::get(const size_t row) const {
+    typedef typename std::tuple_element<I, Row>::type T;
+    typedef typename MySqlSnapshotPrivate::ColumnTraits<T>::ValueType
+        ValueType;
+    if (row >= rowCount_) {
+        throw MySqlException("Snapshot row is out of range");
+    }
+    if (isNull<I>(row)) {
+        throw MySqlException(MySqlSnapshotPrivate::NULL_VALUE_ERROR_MESSAGE);
+    }
+    const MySqlSnapshotPrivate::ColumnHeader& column = columns_.at(I);
+    return MySqlSnapshotPrivate::ColumnTraits<ValueType>::read(
+        file_.getData() + column.valuesOffset,
+        file_.getData() + column.dataOffset,
+        column.dataLength,
+        row);
+}
+
+
+template <typename... Args>
+typename MySqlSnapshot<Args...>::Row MySqlSnapshot<Args...>::getRow(
+    const size_t row
+) const {
+    Row values;
+    setRowValues(
+        &values,
+        row,
+        MySqlSnapshotPrivate::int_<sizeof...(Args) - 1>());
+    return values;
+}
+
+
+template <typename... Args>
+void MySqlSnapshot<Args...>::getRows(std::vector<Row>* const rows) const {
+    assert(nullptr != rows);
+    rows->reserve(rows->size() + size());
+    for (size_t row = 0; row < size(); ++row) {
+        rows->push_back(getRow(row));
+    }
+}
+
+
+template <typename... Args>
+template <int I>
+void MySqlSnapshot<Args...>::setRowValues(
+    Row* const values,
+    const size_t row,
+    MySqlSnapshotPrivate::int_<I>
+) const {
+    typedef typename std::tuple_element<I, Row>::type T;
+    // Null smart pointers are already default constructed
+    if (!isNull<I>(row)) {
+        std::get<I>(*values) = MySqlSnapshotPrivate::ColumnTraits<T>::toValue(
+            get<I>(row));
+    }
+    setRowValues(values, row, MySqlSnapshotPrivate::int_<I - 1>());
+}
+
+
+template <typename... Args>
+void MySqlSnapshot<Args...>::setRowValues(
+    Row* const,
+    const size_t,
+    MySqlSnapshotPrivate::int_<-1>
+) const {
+}
+
+
+template <typename... Args>
+template <int I>
+void MySqlSnapshot<Args...>::readColumnHeaders(MySqlSnapshotPrivate::int_<I>) {
+    typedef typename std::tuple_element<I, Row>::type T;
+    typedef MySqlSnapshotPrivate::ColumnTraits<T> Traits;
+    typedef MySqlSnapshotPrivate::ColumnTraits<typename Traits::ValueType>
+        ValueTraits;
+    const MySqlSnapshotPrivate::ColumnHeader& column = columns_.at(I);
+    if (Traits::TYPE_CODE != column.typeCode) {
+        throw MySqlException("Snapshot column has a different type");
+    }
+    if (MySqlSnapshotPrivate::IsNullable<T>::value) {
+        checkRegion(column.nullsOffset, (rowCount_ + 7) / 8);
+    }
+    if (ValueTraits::getValuesLength(rowCount_) != column.valuesLength) {
+        throw MySqlException("Snapshot column has the wrong number of rows");
+    }
+    checkRegion(column.valuesOffset, column.valuesLength);
+    checkRegion(column.dataOffset, column.dataLength);
+    readColumnHeaders(MySqlSnapshotPrivate::int_<I - 1>());
+}
+
+
+template <typename... Args>
+void MySqlSnapshot<Args...>::readColumnHeaders(MySqlSnapshotPrivate::int_<-1>) {
+}
+
+
+template <typename... Args>
+void MySqlSnapshot<Args...>::checkRegion(
+    const uint64_t offset,
+    const uint64_t length
+) const {
+    if (offset > file_.getSize() || length > file_.getSize() - offset) {
+        throw MySqlException("Snapshot column runs past the end of the file");
+    }
+}
+
+
+#endif  // MYSQL_SNAPSHOT_HPP_
@@ -0,0 +1,29 @@
+#ifndef MYSQL_STRING_REF_HPP_
+#define MYSQL_STRING_REF_HPP_
+
+#include <cstddef>
+
+#include <string>
+
+/**
+ * A string that points into memory owned by something else, like a mapped
+ * snapshot file or a column buffer, so it's only valid while that is.
+ */
+class MySqlStringRef {
+    public:
+        MySqlStringRef(const char* const data, const size_t size)
+            : data_(data)
+            , size_(size)
+        {
+        }
+
+        const char* data() const { return data_; }
+        size_t size() const { return size_; }
+        std::string str() const { return std::string(data_, size_); }
+
+    private:
+        const char* data_;
+        size_t size_;
+};
+
+#endif  // MYSQL_STRING_REF_HPP_
@@ -0,0 +1,225 @@
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+#include "MySqlThreadConnectionManager.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <boost/lexical_cast.hpp>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+using boost::lexical_cast;
+using std::atomic;
+using std::move;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+
+
+namespace MySqlThreadConnectionManagerPrivate {
+
+class Shared {
+    public:
+        explicit Shared(const size_t maximumConnections)
+            : maximumConnections_(maximumConnections)
+            , connectionCount_(0)
+            , closed_(false)
+        {
+        }
+
+        Shared(const Shared& rhs) = delete;
+        Shared(Shared&& rhs) = delete;
+        Shared& operator=(const Shared& rhs) = delete;
+        Shared& operator=(Shared&& rhs) = delete;
+
+        const size_t maximumConnections_;
+        atomic<size_t> connectionCount_;
+        // Set when the manager is destroyed
+        atomic<bool> closed_;
+};
+
+
+/**
+ * Holds one of the manager's connection slots until destroyed.
+ */
+class Slot {
+    public:
+        explicit Slot(shared_ptr<Shared> shared)
+            : shared_(move(shared))
+        {
+            const size_t maximum = shared_->maximumConnections_;
+            if (shared_->connectionCount_.fetch_add(1) >= maximum) {
+                shared_->connectionCount_.fetch_sub(1);
+                string errorMessage("Too many thread connections; at most ");
+                errorMessage += lexical_cast<string>(maximum);
+                errorMessage += " can be open";
+                throw MySqlException(errorMessage);
+            }
+        }
+
+        ~Slot() {
+            shared_->connectionCount_.fetch_sub(1);
+        }
+
+        Slot(const Slot& rhs) = delete;
+        Slot(Slot&& rhs) = delete;
+        Slot& operator=(const Slot& rhs) = delete;
+        Slot& operator=(Slot&& rhs) = delete;
+
+        bool isClosed() const {
+            return shared_->closed_.load();
+        }
+
+    private:
+        const shared_ptr<Shared> shared_;
+};
+
+
+/**
+ * A thread's connection from one manager. The slot is declared first so that
+ * it's only given back after the connection has been closed.
+ */
+class ThreadConnection {
+    public:
+        ThreadConnection(
+            shared_ptr<Shared> shared,
+            const MySqlThreadConnectionManager::Factory& factory
+        )
+            : slot_(move(shared))
+            , connection_(factory())
+        {
+        }
+
+        ThreadConnection(const ThreadConnection& rhs) = delete;
+        ThreadConnection(ThreadConnection&& rhs) = delete;
+        ThreadConnection& operator=(const ThreadConnection& rhs) = delete;
+        ThreadConnection& operator=(ThreadConnection&& rhs) = delete;
+
+        const Slot slot_;
+        MySql connection_;
+};
+
+
+/**
+ * Every connection that a thread has opened, keyed by manager ID, and the
+ * most recently used one so that repeated lookups skip the hash.
+ */
+class ThreadConnections {
+    public:
+        ThreadConnections()
+            : connections_()
+            , lastId_(0)
+            , lastConnection_(nullptr)
+        {
+        }
+
+        ThreadConnections(const ThreadConnections& rhs) = delete;
+        ThreadConnections(ThreadConnections&& rhs) = delete;
+        ThreadConnections& operator=(const ThreadConnections& rhs) = delete;
+        ThreadConnections& operator=(ThreadConnections&& rhs) = delete;
+
+        unordered_map<uint64_t, unique_ptr<ThreadConnection>> connections_;
+        uint64_t lastId_;
+        MySql* lastConnection_;
+};
+
+}  // namespace MySqlThreadConnectionManagerPrivate
+
+using MySqlThreadConnectionManagerPrivate::Shared;
+using MySqlThreadConnectionManagerPrivate::ThreadConnection;
+using MySqlThreadConnectionManagerPrivate::ThreadConnections;
+
+
+static ThreadConnections& getThreadConnections() {
+    static thread_local ThreadConnections threadConnections;
+    return threadConnections;
+}
+
+
+/**
+ * Closes the calling thread's connections from managers that have been
+ * destroyed.
+ */
+static void removeClosedConnections(ThreadConnections* const thread) {
+    auto iter = thread->connections_.begin();
+    while (thread->connections_.end() != iter) {
+        if (iter->second->slot_.isClosed()) {
+            if (iter->first == thread->lastId_) {
+                thread->lastId_ = 0;
+                thread->lastConnection_ = nullptr;
+            }
+            iter = thread->connections_.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+
+// IDs start at 1 so that 0 can mean no connection
+static atomic<uint64_t> nextManagerId(1);
+
+
+MySqlThreadConnectionManager::MySqlThreadConnectionManager(
+    Factory factory,
+    const size_t maximumConnections
+)
+    : id_(nextManagerId.fetch_add(1))
+    , factory_(move(factory))
+    , maximumConnections_(maximumConnections)
+    , shared_(std::make_shared<Shared>(maximumConnections))
+{
+    if (!factory_) {
+        throw MySqlException("Thread connection factory is required");
+    }
+}
+
+
+MySqlThreadConnectionManager::~MySqlThreadConnectionManager() {
+    shared_->closed_.store(true);
+    releaseConnection();
+}
+
+
+MySql& MySqlThreadConnectionManager::getConnection() {
+    ThreadConnections& thread = getThreadConnections();
+    if (id_ == thread.lastId_) {
+        return *thread.lastConnection_;
+    }
+
+    auto found = thread.connections_.find(id_);
+    if (thread.connections_.end() == found) {
+        removeClosedConnections(&thread);
+        unique_ptr<ThreadConnection> connection(
+            new ThreadConnection(shared_, factory_));
+        found = thread.connections_.emplace(id_, move(connection)).first;
+    }
+    thread.lastId_ = id_;
+    thread.lastConnection_ = &found->second->connection_;
+    return *thread.lastConnection_;
+}
+
+
+void MySqlThreadConnectionManager::releaseConnection() {
+    ThreadConnections& thread = getThreadConnections();
+    if (id_ == thread.lastId_) {
+        thread.lastId_ = 0;
+        thread.lastConnection_ = nullptr;
+    }
+    thread.connections_.erase(id_);
+}
+
+
+size_t MySqlThreadConnectionManager::getConnectionCount() const {
+    return shared_->connectionCount_.load();
+}
+
+
+size_t MySqlThreadConnectionManager::getMaximumConnections() const {
+    return maximumConnections_;
+}
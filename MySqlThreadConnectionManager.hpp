@@ -0,0 +1,91 @@
+#ifndef MYSQL_THREAD_CONNECTION_MANAGER_HPP_
+#define MYSQL_THREAD_CONNECTION_MANAGER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <functional>
+#include <memory>
+
+#include "MySql.hpp"
+
+namespace MySqlThreadConnectionManagerPrivate {
+    // State shared with the threads' connections, which can outlive the
+    // manager
+    class Shared;
+}
+
+/**
+ * Gives each thread its own connection, because a MySql can't be used by
+ * several threads at once. A thread's connection is opened with the factory
+ * the first time the thread asks for it, kept in thread_local storage, and
+ * closed when the thread exits. Looking up a thread's connection doesn't
+ * lock. Statements that the factory caches on the connection are prepared
+ * once per thread.
+ *
+ *     MySqlThreadConnectionManager manager(
+ *         []() {
+ *             MySql connection("localhost", "user", "password", "db");
+ *             connection.cacheStatement("SELECT name FROM user WHERE id = ?");
+ *             return connection;
+ *         },
+ *         64);
+ *     // On any thread
+ *     manager.getConnection().runQuery(&names, "...", id);
+ *
+ * Connections that other threads opened are closed when those threads exit
+ * or next use any manager, even if the manager was destroyed first.
+ */
+class MySqlThreadConnectionManager {
+    public:
+        typedef std::function<MySql()> Factory;
+
+        /**
+         * @param factory Opens a connection. Called on the thread that will
+         *     use the connection.
+         * @param maximumConnections How many threads can have a connection
+         *     open at once.
+         */
+        MySqlThreadConnectionManager(
+            Factory factory,
+            size_t maximumConnections);
+        ~MySqlThreadConnectionManager();
+
+        MySqlThreadConnectionManager(
+            const MySqlThreadConnectionManager& rhs) = delete;
+        MySqlThreadConnectionManager(
+            MySqlThreadConnectionManager&& rhs) = delete;
+        MySqlThreadConnectionManager& operator=(
+            const MySqlThreadConnectionManager& rhs) = delete;
+        MySqlThreadConnectionManager& operator=(
+            MySqlThreadConnectionManager&& rhs) = delete;
+
+        /**
+         * Returns the calling thread's connection, opening it if needed. The
+         * connection must only be used on the calling thread.
+         * @throws MySqlException If maximumConnections threads already have
+         *     a connection open.
+         */
+        MySql& getConnection();
+
+        /**
+         * Closes the calling thread's connection, if it has one, so that
+         * another thread can open one.
+         */
+        void releaseConnection();
+
+        size_t getConnectionCount() const;
+        size_t getMaximumConnections() const;
+
+    private:
+        // Thread local storage is keyed by this instead of by address, so
+        // that a new manager at the same address doesn't find the old one's
+        // connections
+        const uint64_t id_;
+        const Factory factory_;
+        const size_t maximumConnections_;
+        const std::shared_ptr<MySqlThreadConnectionManagerPrivate::Shared>
+            shared_;
+};
+
+#endif  // MYSQL_THREAD_CONNECTION_MANAGER_HPP_
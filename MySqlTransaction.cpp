@@ -0,0 +1,98 @@
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+#include "MySqlTransaction.hpp"
+
+#include <cassert>
+#include <cctype>
+
+#include <string>
+
+using std::string;
+
+
+MySqlTransaction::MySqlTransaction(MySql* const connection)
+    : connection_(connection)
+    , active_(false)
+{
+    assert(nullptr != connection_);
+    connection_->runCommand("START TRANSACTION");
+    active_ = true;
+}
+
+
+MySqlTransaction::~MySqlTransaction() {
+    if (active_) {
+        try {
+            connection_->runCommand("ROLLBACK");
+        } catch (const MySqlException&) {
+            // TODO Log an error. If the connection is broken, the server
+            // rolls back the transaction anyway.
+        }
+    }
+}
+
+
+void MySqlTransaction::commit() {
+    throwIfInactive();
+    // Whether or not this succeeds, the transaction is over
+    active_ = false;
+    connection_->runCommand("COMMIT");
+}
+
+
+void MySqlTransaction::rollback() {
+    throwIfInactive();
+    active_ = false;
+    connection_->runCommand("ROLLBACK");
+}
+
+
+static string makeSavepointCommand(const char* const prefix, const char* name) {
+    assert(nullptr != name);
+    if ('\0' == *name) {
+        throw MySqlException("Savepoint name is empty");
+    }
+    string command(prefix);
+    for (; '\0' != *name; ++name) {
+        const unsigned char c = static_cast<unsigned char>(*name);
+        if (!std::isalnum(c) && '_' != c) {
+            throw MySqlException(
+                "Savepoint names may only contain letters, digits and"
+                " underscores");
+        }
+        command.push_back(*name);
+    }
+    return command;
+}
+
+
+void MySqlTransaction::setSavepoint(const char* const name) {
+    throwIfInactive();
+    connection_->runCommand(makeSavepointCommand("SAVEPOINT ", name).c_str());
+}
+
+
+void MySqlTransaction::rollbackToSavepoint(const char* const name) {
+    throwIfInactive();
+    connection_->runCommand(
+        makeSavepointCommand("ROLLBACK TO SAVEPOINT ", name).c_str());
+}
+
+
+void MySqlTransaction::releaseSavepoint(const char* const name) {
+    throwIfInactive();
+    connection_->runCommand(
+        makeSavepointCommand("RELEASE SAVEPOINT ", name).c_str());
+}
+
+
+bool MySqlTransaction::isActive() const {
+    return active_;
+}
+
+
+void MySqlTransaction::throwIfInactive() const {
+    if (!active_) {
+        throw MySqlException("Transaction has already ended");
+    }
+}
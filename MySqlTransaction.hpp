@@ -0,0 +1,52 @@
+#ifndef MYSQL_TRANSACTION_HPP_
+#define MYSQL_TRANSACTION_HPP_
+
+class MySql;
+
+/**
+ * Starts a transaction when constructed and rolls it back when destroyed
+ * unless it was committed, so an exception can't leave a transaction open.
+ *
+ *     {
+ *         MySqlTransaction transaction(&connection);
+ *         connection.runCommand("UPDATE account SET ...", ...);
+ *         connection.runCommand("UPDATE account SET ...", ...);
+ *         transaction.commit();
+ *     }
+ */
+class MySqlTransaction {
+    public:
+        explicit MySqlTransaction(MySql* connection);
+        ~MySqlTransaction();
+
+        MySqlTransaction(const MySqlTransaction& rhs) = delete;
+        MySqlTransaction(MySqlTransaction&& rhs) = delete;
+        MySqlTransaction& operator=(const MySqlTransaction& rhs) = delete;
+        MySqlTransaction& operator=(MySqlTransaction&& rhs) = delete;
+
+        void commit();
+        void rollback();
+
+        /**
+         * Savepoints. Names must be plain identifiers (letters, digits and
+         * underscores) because they can't be bound as parameters.
+         */
+        /// @{
+        void setSavepoint(const char* name);
+        void rollbackToSavepoint(const char* name);
+        void releaseSavepoint(const char* name);
+        /// @}
+
+        /**
+         * Returns true until the transaction is committed or rolled back.
+         */
+        bool isActive() const;
+
+    private:
+        void throwIfInactive() const;
+
+        MySql* const connection_;
+        bool active_;
+};
+
+#endif  // MYSQL_TRANSACTION_HPP_
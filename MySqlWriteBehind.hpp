@@ -0,0 +1,387 @@
+#ifndef MYSQL_WRITE_BEHIND_HPP_
+#define MYSQL_WRITE_BEHIND_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <mysql/mysql.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+#include "MySqlPreparedStatement.hpp"
+
+/**
+ * Fire-and-forget inserts. Rows are pushed onto a lock-free queue and a
+ * background thread with a dedicated connection writes whatever has
+ * accumulated as one multi-row INSERT, so callers never wait for the server.
+ *
+ * The queue holds at most capacity rows. tryPush refuses rows when it's
+ * full, and push waits for the writer to catch up, so a slow server slows
+ * producers down instead of using unbounded memory. Failed inserts are kept
+ * and rethrown by the next flush; the rows in a failed INSERT are lost.
+ *
+ *     MySqlWriteBehind<std::string, int32_t> log(
+ *         std::move(connection),
+ *         "INSERT INTO log (message, level) VALUES",
+ *         10000,  // Capacity
+ *         500);  // Rows per INSERT
+ *     log.push(message, level);
+ */
+template <typename... Args>
+class MySqlWriteBehind {
+    public:
+        /**
+         * @param insertPrefix The statement up to and including VALUES. A
+         *     group of parameters is appended for each row.
+         */
+        MySqlWriteBehind(
+            std::unique_ptr<MySql> connection,
+            const char* insertPrefix,
+            size_t capacity,
+            size_t maximumRowsPerInsert);
+        /**
+         * Writes everything that was pushed, then stops. Errors are lost, so
+         * call flush first if they matter.
+         */
+        ~MySqlWriteBehind();
+
+        MySqlWriteBehind(const MySqlWriteBehind& rhs) = delete;
+        MySqlWriteBehind(MySqlWriteBehind&& rhs) = delete;
+        MySqlWriteBehind& operator=(const MySqlWriteBehind& rhs) = delete;
+        MySqlWriteBehind& operator=(MySqlWriteBehind&& rhs) = delete;
+
+        /**
+         * Queues a row. Safe to call from any number of threads.
+         * @return False if the queue is full.
+         */
+        bool tryPush(Args... values);
+        /**
+         * Queues a row, waiting for room if the queue is full.
+         */
+        void push(Args... values);
+
+        /**
+         * Waits until every row pushed so far has been written, then throws
+         * the first error since the last flush, if any.
+         */
+        void flush();
+
+        /**
+         * The number of rows that are queued or being written.
+         */
+        size_t getPendingCount() const;
+
+    private:
+        struct Node {
+            Node();
+            explicit Node(std::tuple<Args...>&& row);
+
+            std::atomic<Node*> next_;
+            std::tuple<Args...> row_;
+        };
+
+        bool reserve();
+        void enqueue(std::tuple<Args...>&& row);
+        bool dequeue(std::tuple<Args...>* row);
+        void run();
+        void write(const std::vector<std::tuple<Args...>>& rows);
+        std::string makeInsert(size_t rowCount) const;
+
+        const std::unique_ptr<MySql> connection_;
+        const std::string insertPrefix_;
+        const size_t capacity_;
+        const size_t maximumRowsPerInsert_;
+        // The INSERT for a full batch, which is the common case under load.
+        // Prepared by the writer the first time that it's needed.
+        std::unique_ptr<const MySqlPreparedStatement> fullInsert_;
+
+        // Multiple producer, single consumer queue. Producers swap themselves
+        // in as the head and then link the previous head to themselves; the
+        // consumer follows the links from the tail, which is always a dummy
+        // node. A producer that has swapped but not yet linked briefly hides
+        // the rows after it, which just delays them until the next pass.
+        std::atomic<Node*> head_;
+        Node* tail_;
+        std::atomic<size_t> size_;
+        std::atomic<uint64_t> pushed_;
+
+        std::mutex mutex_;
+        std::condition_variable rowsAvailable_;
+        std::condition_variable rowsWritten_;
+        uint64_t written_;
+        std::exception_ptr error_;
+        std::atomic<bool> writerWaiting_;
+        bool stopping_;
+        std::thread writer_;
+};
+
+
+template <typename... Args>
+MySqlWriteBehind<Args...>::Node::Node()
+    : next_(nullptr)
+    , row_()
+{
+}
+
+
+template <typename... Args>
+MySqlWriteBehind<Args...>::Node::Node(std::tuple<Args...>&& row)
+    : next_(nullptr)
+    , row_(std::move(row))
+{
+}
+
+
+template <typename... Args>
+MySqlWriteBehind<Args...>::MySqlWriteBehind(
+    std::unique_ptr<MySql> connection,
+    const char* const insertPrefix,
+    const size_t capacity,
+    const size_t maximumRowsPerInsert
+)
+    : connection_(std::move(connection))
+    , insertPrefix_(insertPrefix)
+    , capacity_(capacity)
+    , maximumRowsPerInsert_(maximumRowsPerInsert)
+    , fullInsert_()
+    , head_(nullptr)
+    , tail_(nullptr)
+    , size_(0)
+    , pushed_(0)
+    , mutex_()
+    , rowsAvailable_()
+    , rowsWritten_()
+    , written_(0)
+    , error_()
+    , writerWaiting_(false)
+    , stopping_(false)
+    , writer_()
+{
+    static_assert(0 < sizeof...(Args), "Rows need at least one column");
+    if (nullptr == connection_) {
+        throw MySqlException("Write-behind connection is required");
+    }
+    if (0 == capacity_ || 0 == maximumRowsPerInsert_) {
+        throw MySqlException(
+            "Write-behind capacity and rows per insert must be positive");
+    }
+    // Prepared statements are limited to 65535 parameters
+    if (maximumRowsPerInsert_ > 65535 / sizeof...(Args)) {
+        throw MySqlException("Too many rows per insert");
+    }
+    Node* const dummy = new Node;
+    head_.store(dummy);
+    tail_ = dummy;
+    writer_ = std::thread(&MySqlWriteBehind::run, this);
+}
+
+
+template <typename... Args>
+MySqlWriteBehind<Args...>::~MySqlWriteBehind() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    rowsAvailable_.notify_one();
+    writer_.join();
+    // The writer has emptied the queue, so only the dummy is left
+    delete tail_;
+}
+
+
+template <typename... Args>
+bool MySqlWriteBehind<Args...>::tryPush(Args... values) {
+    if (!reserve()) {
+        return false;
+    }
+    enqueue(std::tuple<Args...>(std::move(values)...));
+    return true;
+}
+
+
+template <typename... Args>
+void MySqlWriteBehind<Args...>::push(Args... values) {
+    // Back off gradually; the writer frees up a whole INSERT's worth of room
+    // at a time, so there's no point in spinning hard
+    std::chrono::microseconds backoff(1);
+    const std::chrono::microseconds maximumBackoff(1000);
+    while (!reserve()) {
+        std::this_thread::sleep_for(backoff);
+        if (backoff < maximumBackoff) {
+            backoff *= 2;
+        }
+    }
+    enqueue(std::tuple<Args...>(std::move(values)...));
+}
+
+
+template <typename... Args>
+bool MySqlWriteBehind<Args...>::reserve() {
+    size_t size = size_.load(std::memory_order_relaxed);
+    do {
+        if (size >= capacity_) {
+            return false;
+        }
+    } while (!size_.compare_exchange_weak(
+        size,
+        size + 1,
+        std::memory_order_relaxed));
+    return true;
+}
+
+
+template <typename... Args>
+void MySqlWriteBehind<Args...>::enqueue(std::tuple<Args...>&& row) {
+    Node* const node = new Node(std::move(row));
+    Node* const previous = head_.exchange(node, std::memory_order_acq_rel);
+    // Linking the node and then checking the flag pairs with the writer
+    // setting the flag and then checking for a node, so at least one of
+    // them sees the other. Both sides need seq_cst for that.
+    previous->next_.store(node, std::memory_order_seq_cst);
+    pushed_.fetch_add(1, std::memory_order_release);
+
+    // Only take the lock if the writer is asleep
+    if (writerWaiting_.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rowsAvailable_.notify_one();
+    }
+}
+
+
+template <typename... Args>
+bool MySqlWriteBehind<Args...>::dequeue(std::tuple<Args...>* const row) {
+    Node* const next = tail_->next_.load(std::memory_order_acquire);
+    if (nullptr == next) {
+        return false;
+    }
+    // The next node becomes the new dummy
+    *row = std::move(next->row_);
+    delete tail_;
+    tail_ = next;
+    return true;
+}
+
+
+template <typename... Args>
+void MySqlWriteBehind<Args...>::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const uint64_t target = pushed_.load(std::memory_order_acquire);
+    rowsAvailable_.notify_one();
+    rowsWritten_.wait(lock, [this, target]() {
+        return written_ >= target;
+    });
+    if (error_) {
+        std::exception_ptr error;
+        std::swap(error, error_);
+        std::rethrow_exception(error);
+    }
+}
+
+
+template <typename... Args>
+size_t MySqlWriteBehind<Args...>::getPendingCount() const {
+    return size_.load(std::memory_order_relaxed);
+}
+
+
+template <typename... Args>
+void MySqlWriteBehind<Args...>::run() {
+    std::vector<std::tuple<Args...>> rows;
+    rows.reserve(maximumRowsPerInsert_);
+    while (true) {
+        rows.clear();
+        std::tuple<Args...> row;
+        while (rows.size() < maximumRowsPerInsert_ && dequeue(&row)) {
+            rows.push_back(std::move(row));
+        }
+
+        if (rows.empty()) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stopping_) {
+                // Producers are done by the time the destructor runs, so one
+                // last look is enough
+                if (nullptr == tail_->next_.load(std::memory_order_acquire)) {
+                    return;
+                }
+                continue;
+            }
+            // A producer might have linked a row after the dequeue without
+            // seeing the flag, so look again once it's set. A producer that
+            // links a row after this sees the flag and takes the lock to
+            // notify, which can't happen until wait releases it.
+            writerWaiting_.store(true, std::memory_order_seq_cst);
+            if (nullptr == tail_->next_.load(std::memory_order_seq_cst)) {
+                rowsAvailable_.wait(lock);
+            }
+            writerWaiting_.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::exception_ptr error;
+        try {
+            write(rows);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        size_.fetch_sub(rows.size(), std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        written_ += rows.size();
+        if (error && !error_) {
+            error_ = error;
+        }
+        rowsWritten_.notify_all();
+    }
+}
+
+
+template <typename... Args>
+void MySqlWriteBehind<Args...>::write(
+    const std::vector<std::tuple<Args...>>& rows
+) {
+    if (maximumRowsPerInsert_ != rows.size()) {
+        connection_->runMultiRowCommand(makeInsert(rows.size()).c_str(), rows);
+        return;
+    }
+    if (nullptr == fullInsert_) {
+        fullInsert_.reset(new MySqlPreparedStatement(
+            connection_->prepareStatement(makeInsert(rows.size()).c_str())));
+    }
+    connection_->runMultiRowCommand(*fullInsert_, rows);
+}
+
+
+template <typename... Args>
+std::string MySqlWriteBehind<Args...>::makeInsert(
+    const size_t rowCount
+) const {
+    assert(0 < rowCount);
+    std::string group(" (?");
+    for (size_t i = 1; i < sizeof...(Args); ++i) {
+        group += ", ?";
+    }
+    group += ')';
+
+    std::string insert(insertPrefix_);
+    insert.reserve(insert.size() + rowCount * (group.size() + 1));
+    insert += group;
+    for (size_t i = 1; i < rowCount; ++i) {
+        insert += ',';
+        insert += group;
+    }
+    return insert;
+}
+
+
+#endif  // MYSQL_WRITE_BEHIND_HPP_
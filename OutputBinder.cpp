@@ -39,17 +39,23 @@ int Friend::bindAndExecuteStatement(
     vector<MYSQL_BIND>* const parameters,
     const MySqlPreparedStatement& statement
 ) {
-    if (0 != mysql_stmt_bind_result(
-        statement.statementHandle_,
-        parameters->data()))
-    {
-        throw MySqlException(mysql_stmt_error(statement.statementHandle_));
+    return bindAndExecuteStatement(parameters->data(), statement);
+}
+
+
+int Friend::bindAndExecuteStatement(
+    MYSQL_BIND* const parameters,
+    const MySqlPreparedStatement& statement
+) {
+    // The error is left on the statement for the caller
+    if (0 != mysql_stmt_bind_result(statement.statementHandle_, parameters)) {
+        return 1;
     }
 
     if (0 != mysql_stmt_execute(statement.statementHandle_)) {
-        throw MySqlException(mysql_stmt_error(statement.statementHandle_));
+        return 1;
     }
-    
+
     return mysql_stmt_fetch(statement.statementHandle_);
 }
 
@@ -62,26 +68,30 @@ void Friend::throwIfFetchError(
             // No problem! All rows fetched.
             break;
         case 1: {  // Error occurred {
-            throw MySqlException(mysql_stmt_error(statement.statementHandle_));
+            throw MySqlException(statement);
         }
         default: {
             assert(false && "Unknown error code from mysql_stmt_fetch");
-            throw MySqlException(mysql_stmt_error(statement.statementHandle_));
+            throw MySqlException(statement);
         }
     }
 }
 
-void Friend::refetchTruncatedColumns(
+bool Friend::refetchTruncatedColumns(
     const MySqlPreparedStatement& statement,
     vector<MYSQL_BIND>* const parameters,
     vector<vector<char>>* const buffers,
-    vector<mysql_bind_length_t>* const lengths
+    vector<mysql_bind_length_t>* const lengths,
+    const vector<bool>* const fixedCapacity
 ) {
     // Find which buffers were too small, expand them and refetch
     typedef unsigned int mysql_column_t;
     typedef unsigned long mysql_offset_t;
     vector<tuple<mysql_column_t, mysql_offset_t>> truncatedColumns;
     for (size_t i = 0; i < lengths->size(); ++i) {
+        if (nullptr != fixedCapacity && fixedCapacity->at(i)) {
+            continue;
+        }
         vector<char>& buffer = buffers->at(i);
         const size_t untruncatedLength = lengths->at(i);
         if (untruncatedLength > buffer.size()) {
@@ -100,7 +110,7 @@ void Friend::refetchTruncatedColumns(
     // code when nothing was truncated... so just break out?
     if (truncatedColumns.empty()) {
         // No truncations!
-        return;
+        return true;
     }
 
     // Refetch only the data that were truncated
@@ -114,7 +124,7 @@ void Friend::refetchTruncatedColumns(
             column,
             offset);
         if (0 != status) {
-            throw MySqlException(mysql_stmt_error(statement.statementHandle_));
+            return false;
         }
 
         // Now, for subsequent fetches, we need to reset the buffers
@@ -124,12 +134,34 @@ void Friend::refetchTruncatedColumns(
     }
 
     // If we've changed the buffers, we need to rebind
-    if (0 != mysql_stmt_bind_result(
+    return 0 == mysql_stmt_bind_result(
         statement.statementHandle_,
-        parameters->data()))
-    {
-        throw MySqlException(mysql_stmt_error(statement.statementHandle_));
+        parameters->data());
+}
+
+
+bool Friend::refetchTruncatedColumn(
+    const MySqlPreparedStatement& statement,
+    MYSQL_BIND* const parameter,
+    vector<char>* const buffer
+) {
+    const size_t untruncatedLength = *parameter->length;
+    if (untruncatedLength <= buffer->size()) {
+        return true;
     }
+    // Only refetch the part that we didn't get the first time
+    const size_t alreadyRetrieved = buffer->size();
+    buffer->resize(untruncatedLength + 1);
+    parameter->buffer = &buffer->at(alreadyRetrieved);
+    parameter->buffer_length = buffer->size() - alreadyRetrieved - 1;
+    const int status = mysql_stmt_fetch_column(
+        statement.statementHandle_,
+        parameter,
+        0,
+        alreadyRetrieved);
+    parameter->buffer = buffer->data();
+    parameter->buffer_length = buffer->size();
+    return 0 == status;
 }
 
 
@@ -137,4 +169,41 @@ int Friend::fetch(const MySqlPreparedStatement& statement) {
     return mysql_stmt_fetch(statement.statementHandle_);
 }
 
+
+bool Friend::discardRows(const MySqlPreparedStatement& statement) {
+    return 0 == mysql_stmt_free_result(statement.statementHandle_);
+}
+
+
+MYSQL_RES* Friend::getResultMetadata(const MySqlPreparedStatement& statement) {
+    MYSQL_RES* const metadata = mysql_stmt_result_metadata(
+        statement.statementHandle_);
+    if (nullptr == metadata) {
+        throw MySqlException(statement);
+    }
+    return metadata;
+}
+
 }  // namespace OutputBinderPrivate
+
+using OutputBinderPrivate::Friend;
+
+
+bool hasResults(const MySqlPreparedStatement& statement) {
+    // Every column is bound to nothing, so no data is copied
+    vector<MYSQL_BIND> parameters(statement.getFieldCount());
+    for (auto& parameter : parameters) {
+        parameter.buffer_type = MYSQL_TYPE_NULL;
+    }
+    const int fetchStatus = Friend::bindAndExecuteStatement(
+        &parameters,
+        statement);
+    if (0 == fetchStatus || MYSQL_DATA_TRUNCATED == fetchStatus) {
+        if (!Friend::discardRows(statement)) {
+            throw MySqlException(statement);
+        }
+        return true;
+    }
+    Friend::throwIfFetchError(fetchStatus, statement);
+    return false;
+}
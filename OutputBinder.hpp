@@ -5,6 +5,7 @@
 #include <mysql/mysql.h>
 
 #include <boost/lexical_cast.hpp>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -14,6 +15,7 @@
 
 #include "MySqlException.hpp"
 #include "MySqlPreparedStatement.hpp"
+#include "MySqlStringRef.hpp"
 
 /**
  * Saves the results from the SQL query into the vector of tuples.
@@ -23,6 +25,105 @@ void setResults(
     const MySqlPreparedStatement& statement,
     std::vector<std::tuple<Args...>>* const results);
 
+/**
+ * Like setResults, but errors from the server are left on the statement
+ * instead of thrown.
+ * @return If every row was fetched.
+ */
+template <typename... Args>
+bool trySetResults(
+    const MySqlPreparedStatement& statement,
+    std::vector<std::tuple<Args...>>* const results);
+
+/**
+ * Like setResults, but writes each row to an output iterator, e.g. a
+ * std::back_inserter for a std::deque or a pointer into an array, instead of
+ * appending it to a vector.
+ * @return The iterator past the last row.
+ */
+template <typename... Args, typename OutputIterator>
+OutputIterator copyResults(
+    const MySqlPreparedStatement& statement,
+    OutputIterator output);
+
+/**
+ * Calls function with the columns of every row, converted to the types of
+ * its parameters, without building a tuple per row. Numbers are passed by
+ * reference straight from the output buffers, and MySqlStringRef parameters
+ * point into them, so those are only valid during the call.
+ * Other types, e.g. std::string or std::shared_ptr, are converted as they
+ * are in setResults.
+ * @return The number of rows.
+ */
+template <typename Function>
+my_ulonglong visitResults(
+    const MySqlPreparedStatement& statement,
+    Function* const function);
+
+/**
+ * An output iterator that moves each row into a function, e.g. to load an
+ * unordered_map keyed by the first column. Use makeMySqlRowSink to create
+ * one.
+ */
+template <typename Function>
+class MySqlRowSink {
+    public:
+        typedef std::output_iterator_tag iterator_category;
+        typedef void value_type;
+        typedef void difference_type;
+        typedef void pointer;
+        typedef void reference;
+
+        explicit MySqlRowSink(Function function)
+            : function_(std::move(function))
+        {
+        }
+
+        template <
+            typename Row,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<Row>::type,
+                MySqlRowSink
+            >::value>::type>
+        MySqlRowSink& operator=(Row&& row) {
+            function_(std::forward<Row>(row));
+            return *this;
+        }
+
+        MySqlRowSink& operator*() {
+            return *this;
+        }
+        MySqlRowSink& operator++() {
+            return *this;
+        }
+        MySqlRowSink operator++(int) {
+            return *this;
+        }
+
+    private:
+        Function function_;
+};
+
+template <typename Function>
+MySqlRowSink<Function> makeMySqlRowSink(Function function) {
+    return MySqlRowSink<Function>(std::move(function));
+}
+
+/**
+ * Saves the only column of the first row into value, without building a
+ * tuple or a vector, and discards any other rows.
+ * @return If there was a row. If not, value isn't changed.
+ */
+template <typename T>
+bool setScalarResult(
+    const MySqlPreparedStatement& statement,
+    T* const value);
+
+/**
+ * Returns if the executed statement has any rows, and discards them.
+ */
+bool hasResults(const MySqlPreparedStatement& statement);
+
 // The base type of the pointer MYSQL_BIND.length
 typedef typename std::remove_reference<decltype(*std::declval<
     // This expression should yield a pointer to unsigned integral type
@@ -45,18 +146,51 @@ class Friend {
         static void throwIfParameterCountWrong(
             size_t expectedSize,
             const MySqlPreparedStatement& statement);
+        /**
+         * Returns the status of the first fetch, which is 1 if binding or
+         * executing failed, like mysql_stmt_fetch does on errors.
+         */
+        /// @{
         static int bindAndExecuteStatement(
             std::vector<MYSQL_BIND>* parameters,
             const MySqlPreparedStatement& statement);
+        static int bindAndExecuteStatement(
+            MYSQL_BIND* parameters,
+            const MySqlPreparedStatement& statement);
+        /// @}
         static void throwIfFetchError(
             int fetchStatus,
             const MySqlPreparedStatement& statement);
-        static void refetchTruncatedColumns(
+        /**
+         * Returns false if refetching failed. Columns that are set in
+         * fixedCapacity, which can be null, are left truncated.
+         */
+        static bool refetchTruncatedColumns(
             const MySqlPreparedStatement& statement,
             std::vector<MYSQL_BIND>* const parameters,
             std::vector<std::vector<char>>* const buffers,
-            std::vector<mysql_bind_length_t>* const lengths);
+            std::vector<mysql_bind_length_t>* const lengths,
+            const std::vector<bool>* const fixedCapacity);
+        /**
+         * Like refetchTruncatedColumns, for the only column of a row that
+         * won't be fetched past. The parameter isn't bound again.
+         */
+        static bool refetchTruncatedColumn(
+            const MySqlPreparedStatement& statement,
+            MYSQL_BIND* const parameter,
+            std::vector<char>* const buffer);
         static int fetch(const MySqlPreparedStatement& statement);
+        /**
+         * Discards the rest of the rows without fetching them one at a
+         * time. Returns false on errors.
+         */
+        static bool discardRows(const MySqlPreparedStatement& statement);
+        /**
+         * Returns the result set metadata, which the caller needs to free
+         * with mysql_free_result.
+         */
+        static MYSQL_RES* getResultMetadata(
+            const MySqlPreparedStatement& statement);
 
     private:
         Friend() = delete;
@@ -118,7 +252,7 @@ class OutputBinderResultSetter<T*> {
 
 template<typename Tuple, int I>
 void bindParameters(
-    const Tuple& tuple,  // We only need this so we can access the element types
+    const Tuple* tuple,  // We only need this so we can access the element types
     std::vector<MYSQL_BIND>* const mysqlBindParameters,
     std::vector<std::vector<char>>* const buffers,
     std::vector<my_bool> const nullFlags,
@@ -126,7 +260,7 @@ void bindParameters(
 );
 template<typename Tuple>
 void bindParameters(
-    const Tuple& tuple,  // We only need this so we can access the element types
+    const Tuple* tuple,  // We only need this so we can access the element types
     std::vector<MYSQL_BIND>* const,
     std::vector<std::vector<char>>* const,
     std::vector<my_bool> const,
@@ -170,6 +304,19 @@ class OutputBinderParameterSetter<T*> {
             std::vector<char>* const,
             my_bool* const);
 };
+/**
+ * Whether T's output parameter has a buffer that's never grown, so that
+ * truncated values aren't refetched and the result setter sees their full
+ * length instead.
+ */
+template <typename T>
+struct OutputBinderFixedCapacity : std::false_type {};
+template <typename T>
+struct OutputBinderFixedCapacity<std::shared_ptr<T>>
+    : OutputBinderFixedCapacity<T> {};
+template <typename T>
+struct OutputBinderFixedCapacity<std::unique_ptr<T>>
+    : OutputBinderFixedCapacity<T> {};
 
 
 template<typename Tuple, int I>
@@ -199,7 +346,7 @@ void setResultTuple(
 
 template<typename Tuple>
 void bindParameters(
-    const Tuple&,  // We only need this so we can access the element types
+    const Tuple*,  // We only need this so we can access the element types
     std::vector<MYSQL_BIND>* const,
     std::vector<std::vector<char>>* const,
     std::vector<my_bool>* const,
@@ -210,7 +357,7 @@ void bindParameters(
 
 template<typename Tuple, int I>
 void bindParameters(
-    const Tuple& tuple,  // We only need this so we can access the element types
+    const Tuple* tuple,  // We only need this so we can access the element types
     std::vector<MYSQL_BIND>* const mysqlBindParameters,
     std::vector<std::vector<char>>* const buffers,
     std::vector<my_bool>* const nullFlags,
@@ -260,9 +407,10 @@ void OutputBinderResultSetter<std::shared_ptr<T>>::setResult(
         // TODO(bskari|2013-06-08) It would be cool if we could call a
         // constructor direcly instead of allocating the object and then using
         // the assignment operator
-        T* newObject = new T;
-        OutputBinderResultSetter<T>::setResult(newObject, bind);
-        *value = std::shared_ptr<T>(newObject);
+        // Owned before setting it, which throws if the value doesn't fit
+        std::unique_ptr<T> newObject(new T);
+        OutputBinderResultSetter<T>::setResult(newObject.get(), bind);
+        *value = std::move(newObject);
     }
 }
 template <typename T>
@@ -278,9 +426,10 @@ void OutputBinderResultSetter<std::unique_ptr<T>>::setResult(
         // TODO(bskari|2013-06-08) It would be cool if we could call a
         // constructor direcly instead of allocating the object and then using
         // the assignment operator
-        T* newObject = new T;
-        OutputBinderResultSetter<T>::setResult(newObject, bind);
-        *value = std::unique_ptr<T>(newObject);
+        // Owned before setting it, which throws if the value doesn't fit
+        std::unique_ptr<T> newObject(new T);
+        OutputBinderResultSetter<T>::setResult(newObject.get(), bind);
+        *value = std::move(newObject);
     }
 }
 // *******************************************************
@@ -427,65 +576,393 @@ OUTPUT_BINDER_PARAMETER_SETTER_SPECIALIZATION(uint64_t, MYSQL_TYPE_LONGLONG, 1)
 OUTPUT_BINDER_PARAMETER_SETTER_SPECIALIZATION(float,    MYSQL_TYPE_FLOAT,    0)
 OUTPUT_BINDER_PARAMETER_SETTER_SPECIALIZATION(double,   MYSQL_TYPE_DOUBLE,   0)
 
-}  // End anonymous namespace
 
+/**
+ * Reads a column for visitResults. By default, the column is converted into
+ * a new value like setResult does.
+ */
+template <typename T>
+class OutputBinderColumnReader {
+    public:
+        static T read(const MYSQL_BIND& bind) {
+            T value;
+            OutputBinderResultSetter<T>::setResult(&value, bind);
+            return value;
+        }
+};
+// *****************************************************************
+// Full specializations for types that can be read without a copy
+// *****************************************************************
+#ifndef OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION
+#define OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(type) \
+template <> \
+class OutputBinderColumnReader<type> { \
+    public: \
+        static const type& read(const MYSQL_BIND& bind) { \
+            if (*bind.is_null) { \
+                throw MySqlException(NULL_VALUE_ERROR_MESSAGE); \
+            } \
+            return *static_cast<const type*>(bind.buffer); \
+        } \
+};
+#endif
+OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(int8_t)
+OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(uint8_t)
+OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(int16_t)
+OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(uint16_t)
+OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(int32_t)
+OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(uint32_t)
+OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(int64_t)
+OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(uint64_t)
+OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(float)
+OUTPUT_BINDER_COLUMN_READER_SPECIALIZATION(double)
+template <>
+class OutputBinderColumnReader<MySqlStringRef> {
+    public:
+        static MySqlStringRef read(const MYSQL_BIND& bind) {
+            if (*bind.is_null) {
+                throw MySqlException(NULL_VALUE_ERROR_MESSAGE);
+            }
+            return MySqlStringRef(
+                static_cast<const char*>(bind.buffer),
+                *bind.length);
+        }
+};
 
-template <typename... Args>
-void setResults(
+
+/**
+ * The parameter types of a function, lambda or other function object, with
+ * references and const removed, as a tuple.
+ */
+/// @{
+template <typename Function>
+struct ParameterTypes
+    : ParameterTypes<decltype(&Function::operator())> {};
+template <typename Result, typename... Parameters>
+struct ParameterTypes<Result (*)(Parameters...)> {
+    typedef std::tuple<typename std::decay<Parameters>::type...> type;
+};
+template <typename Class, typename Result, typename... Parameters>
+struct ParameterTypes<Result (Class::*)(Parameters...)>
+    : ParameterTypes<Result (*)(Parameters...)> {};
+template <typename Class, typename Result, typename... Parameters>
+struct ParameterTypes<Result (Class::*)(Parameters...) const>
+    : ParameterTypes<Result (*)(Parameters...)> {};
+/// @}
+
+// Compile-time list of column indexes
+template <size_t... I> struct Indexes {};
+template <size_t N, size_t... I>
+struct MakeIndexes : MakeIndexes<N - 1, N - 1, I...> {};
+template <size_t... I>
+struct MakeIndexes<0, I...> {
+    typedef Indexes<I...> type;
+};
+
+
+/**
+ * Executes the statement and calls handleRow with the output parameters for
+ * every row. The output parameters need to have been set up already, except
+ * for their lengths, which point into lengths. Truncated columns are
+ * refetched into bigger buffers before handleRow sees them, unless they're set
+ * in fixedCapacity, which can be null.
+ * @return The last fetch status, which is MYSQL_NO_DATA once every row has
+ *     been fetched, or 1 if there was an error.
+ */
+template <typename RowHandler>
+int tryFetchRows(
     const MySqlPreparedStatement& statement,
-    std::vector<std::tuple<Args...>>* const results
+    std::vector<MYSQL_BIND>* const parameters,
+    std::vector<std::vector<char>>* const buffers,
+    std::vector<mysql_bind_length_t>* const lengths,
+    const std::vector<bool>* const fixedCapacity,
+    RowHandler handleRow
 ) {
-    OutputBinderPrivate::Friend::throwIfParameterCountWrong(
-        sizeof...(Args),
-        statement
-    );
+    for (size_t i = 0; i < parameters->size(); ++i) {
+        // This doesn't need to be set on every type, but it won't hurt
+        // anything, and it will make the OutputBinderParameterSetter
+        // specializations simpler
+        parameters->at(i).length = &lengths->at(i);
+    }
+
+    int fetchStatus = Friend::bindAndExecuteStatement(parameters, statement);
+
+    while (0 == fetchStatus || MYSQL_DATA_TRUNCATED == fetchStatus) {
+        if (MYSQL_DATA_TRUNCATED == fetchStatus
+            && !Friend::refetchTruncatedColumns(
+                statement,
+                parameters,
+                buffers,
+                lengths,
+                fixedCapacity)
+        ) {
+            return 1;
+        }
+
+        handleRow(*static_cast<const std::vector<MYSQL_BIND>*>(parameters));
+        fetchStatus = Friend::fetch(statement);
+    }
+    return fetchStatus;
+}
+
+
+/**
+ * Like tryFetchRows, but throws if there was an error.
+ */
+template <typename RowHandler>
+void fetchRows(
+    const MySqlPreparedStatement& statement,
+    std::vector<MYSQL_BIND>* const parameters,
+    std::vector<std::vector<char>>* const buffers,
+    std::vector<mysql_bind_length_t>* const lengths,
+    RowHandler handleRow
+) {
+    Friend::throwIfFetchError(
+        tryFetchRows(
+            statement,
+            parameters,
+            buffers,
+            lengths,
+            nullptr,
+            handleRow),
+        statement);
+}
+
+
+/**
+ * Binds output parameters for the types in Args and calls handleRow with
+ * them for every row.
+ * @return The last fetch status. See tryFetchRows.
+ */
+template <typename... Args, typename RowHandler>
+int tryFetchTypedRows(
+    const MySqlPreparedStatement& statement,
+    RowHandler handleRow
+) {
+    Friend::throwIfParameterCountWrong(sizeof...(Args), statement);
     std::vector<MYSQL_BIND> parameters(statement.getFieldCount());
     std::vector<std::vector<char>> buffers(statement.getFieldCount());
     std::vector<mysql_bind_length_t> lengths(statement.getFieldCount());
     std::vector<my_bool> nullFlags(statement.getFieldCount());
 
     // bindParameters needs to know the type of the tuples, and it does this by
-    // taking an example tuple, so just create a dummy
-    // TODO(bskari|2013-03-17) There has to be a better way than this
-    std::tuple<Args...> unused;
+    // taking a pointer to one that's never dereferenced, so that types
+    // without default constructors, like MySqlStringRef, can be bound
+    const std::tuple<Args...>* const unused = nullptr;
     bindParameters(
         unused,
         &parameters,
         &buffers,
         &nullFlags,
-        OutputBinderPrivate::int_<sizeof...(Args) - 1>{});
+        int_<sizeof...(Args) - 1>{});
+    const std::vector<bool> fixedCapacity{
+        OutputBinderFixedCapacity<Args>::value...};
 
-    for (size_t i = 0; i < statement.getFieldCount(); ++i) {
-        // This doesn't need to be set on every type, but it won't hurt
-        // anything, and it will make the OutputBinderParameterSetter
-        // specializations simpler
-        parameters.at(i).length = &lengths.at(i);
-    }
-
-    int fetchStatus = OutputBinderPrivate::Friend::bindAndExecuteStatement(
+    return tryFetchRows(
+        statement,
         &parameters,
+        &buffers,
+        &lengths,
+        &fixedCapacity,
+        handleRow);
+}
+
+
+/**
+ * Like tryFetchTypedRows, but throws if there was an error.
+ */
+template <typename... Args, typename RowHandler>
+void fetchTypedRows(
+    const MySqlPreparedStatement& statement,
+    RowHandler handleRow
+) {
+    Friend::throwIfFetchError(
+        tryFetchTypedRows<Args...>(statement, handleRow),
         statement);
+}
 
-    while (0 == fetchStatus || MYSQL_DATA_TRUNCATED == fetchStatus) {
-        if (MYSQL_DATA_TRUNCATED == fetchStatus) {
-            OutputBinderPrivate::Friend::refetchTruncatedColumns(
+
+/**
+ * Converts every row into a tuple and writes it to output, which is left
+ * past the last row.
+ * @return The last fetch status. See tryFetchRows.
+ */
+template <typename... Args, typename OutputIterator>
+int tryCopyResults(
+    const MySqlPreparedStatement& statement,
+    OutputIterator* const output
+) {
+    return tryFetchTypedRows<Args...>(
+        statement,
+        [output](const std::vector<MYSQL_BIND>& row) {
+            std::tuple<Args...> rowTuple;
+            setResultTuple(
+                &rowTuple,
+                row,
+                int_<sizeof...(Args) - 1>{});
+            **output = std::move(rowTuple);
+            ++*output;
+        });
+}
+
+
+template <typename... Columns, typename Function, size_t... I>
+void callWithRow(
+    Function* const function,
+    const std::vector<MYSQL_BIND>& row,
+    Indexes<I...>
+) {
+    (*function)(OutputBinderColumnReader<Columns>::read(row[I])...);
+}
+
+
+template <typename Columns>
+class RowVisitor;
+
+template <typename... Columns>
+class RowVisitor<std::tuple<Columns...>> {
+    public:
+        /**
+         * Calls function with every row.
+         * @return The last fetch status. See tryFetchRows.
+         */
+        template <typename Function>
+        static int tryVisit(
+            const MySqlPreparedStatement& statement,
+            Function* const function,
+            my_ulonglong* const rowCount
+        ) {
+            static_assert(
+                sizeof...(Columns) > 0,
+                "The function needs a parameter for every column");
+            return tryFetchTypedRows<Columns...>(
                 statement,
-                &parameters,
-                &buffers,
-                &lengths);
+                [function, rowCount](const std::vector<MYSQL_BIND>& row) {
+                    callWithRow<Columns...>(
+                        function,
+                        row,
+                        typename MakeIndexes<sizeof...(Columns)>::type());
+                    ++*rowCount;
+                });
         }
+};
+
+
+/**
+ * Executes the statement and saves the only column of the first row into
+ * value. The output parameter is kept on the stack, and the rest of the rows
+ * are discarded.
+ * @return 0 if a row was saved, MYSQL_NO_DATA if there were no rows, or 1 if
+ *     there was an error.
+ */
+template <typename T>
+int tryFetchScalar(
+    const MySqlPreparedStatement& statement,
+    T* const value
+) {
+    Friend::throwIfParameterCountWrong(1, statement);
+    MYSQL_BIND parameter = MYSQL_BIND();
+    std::vector<char> buffer;
+    my_bool isNull = 0;
+    mysql_bind_length_t length = 0;
+    OutputBinderParameterSetter<T>::setParameter(&parameter, &buffer, &isNull);
+    parameter.length = &length;
+
+    int fetchStatus = Friend::bindAndExecuteStatement(&parameter, statement);
+    if (MYSQL_DATA_TRUNCATED == fetchStatus) {
+        // Fixed capacity values keep their full length so that setResult
+        // throws
+        fetchStatus = OutputBinderFixedCapacity<T>::value
+            || Friend::refetchTruncatedColumn(statement, &parameter, &buffer)
+            ? 0 : 1;
+    }
+    if (0 != fetchStatus) {
+        return fetchStatus;
+    }
+
+    // Discard before setting the value, which can throw on NULLs, so that the
+    // connection isn't left in the middle of a result set
+    if (!Friend::discardRows(statement)) {
+        return 1;
+    }
+    OutputBinderResultSetter<T>::setResult(value, parameter);
+    return 0;
+}
+
+}  // End anonymous namespace
+
+
+template <typename... Args>
+void setResults(
+    const MySqlPreparedStatement& statement,
+    std::vector<std::tuple<Args...>>* const results
+) {
+    if (!trySetResults(statement, results)) {
+        throw MySqlException(statement);
+    }
+}
 
-        std::tuple<Args...> rowTuple;
-        setResultTuple(
-            &rowTuple,
-            parameters,
-            OutputBinderPrivate::int_<sizeof...(Args) - 1>{});
 
-        results->push_back(std::move(rowTuple));
-        fetchStatus = OutputBinderPrivate::Friend::fetch(statement);
+template <typename... Args>
+bool trySetResults(
+    const MySqlPreparedStatement& statement,
+    std::vector<std::tuple<Args...>>* const results
+) {
+    auto output = std::back_inserter(*results);
+    const int fetchStatus = OutputBinderPrivate::tryCopyResults<Args...>(
+        statement,
+        &output);
+    return MYSQL_NO_DATA == fetchStatus;
+}
+
+
+template <typename Function>
+my_ulonglong visitResults(
+    const MySqlPreparedStatement& statement,
+    Function* const function
+) {
+    typedef typename OutputBinderPrivate::ParameterTypes<Function>::type
+        Columns;
+    my_ulonglong rowCount = 0;
+    const int fetchStatus = OutputBinderPrivate::RowVisitor<Columns>::tryVisit(
+        statement,
+        function,
+        &rowCount);
+    if (MYSQL_NO_DATA != fetchStatus) {
+        throw MySqlException(statement);
     }
+    return rowCount;
+}
+
+
+template <typename... Args, typename OutputIterator>
+OutputIterator copyResults(
+    const MySqlPreparedStatement& statement,
+    OutputIterator output
+) {
+    const int fetchStatus = OutputBinderPrivate::tryCopyResults<Args...>(
+        statement,
+        &output);
+    if (MYSQL_NO_DATA != fetchStatus) {
+        throw MySqlException(statement);
+    }
+    return output;
+}
+
 
+template <typename T>
+bool setScalarResult(
+    const MySqlPreparedStatement& statement,
+    T* const value
+) {
+    const int fetchStatus = OutputBinderPrivate::tryFetchScalar(
+        statement,
+        value);
+    if (0 == fetchStatus) {
+        return true;
+    }
     OutputBinderPrivate::Friend::throwIfFetchError(fetchStatus, statement);
+    return false;
 }
 
 
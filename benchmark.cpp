@@ -0,0 +1,122 @@
+/**
+ * Benchmarks for things that need a running server. Uses the same
+ * 'test_mysql_cpp' user and database as the tests.
+ */
+#include "MySql.hpp"
+#include "MySqlException.hpp"
+#include "MySqlOptions.hpp"
+
+#include <cstdint>
+
+#include <boost/lexical_cast.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using boost::lexical_cast;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+using std::cout;
+using std::endl;
+using std::get;
+using std::string;
+using std::tuple;
+using std::vector;
+
+const char* const host = "127.0.0.1";
+const char* const username = "test_mysql_cpp";
+const char* const password = nullptr;
+const char* const database = "test_mysql_cpp";
+
+static uint64_t getBytesSent(const MySql& connection);
+static void benchmarkCompression();
+
+
+int main() {
+    try {
+        benchmarkCompression();
+    } catch (const MySqlException& e) {
+        cout << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+/**
+ * Compares how many bytes the server sends for the same wide result set with
+ * and without protocol compression.
+ */
+void benchmarkCompression() {
+    {
+        MySql connection(host, username, password, database);
+        connection.runCommand("DROP TABLE IF EXISTS benchmark_compression");
+        connection.runCommand(
+            "CREATE TABLE benchmark_compression ("
+                "id INT NOT NULL AUTO_INCREMENT PRIMARY KEY,"
+                "name VARCHAR(64) NOT NULL,"
+                "description TEXT NOT NULL"
+            ")");
+        const string description(
+            "Mostly repetitive text, like a lot of real world data. ");
+        for (int i = 0; i < 2000; ++i) {
+            const string name("name " + lexical_cast<string>(i));
+            const string longDescription(description + description + name);
+            connection.runCommand(
+                "INSERT INTO benchmark_compression (name, description)"
+                    " VALUES (?, ?)",
+                name,
+                longDescription);
+        }
+    }
+
+    // A zstd level of 0 means the library default
+    const struct {
+        const char* name;
+        MySqlOptions::Compression compression;
+        unsigned int zstdLevel;
+    } configurations[] = {
+        {"none", MySqlOptions::Compression::NONE, 0},
+        {"zlib", MySqlOptions::Compression::ZLIB, 0},
+#ifdef MYSQL_OPTIONS_HAVE_COMPRESSION_ALGORITHMS
+        {"zstd level 3", MySqlOptions::Compression::ZSTD, 3},
+#endif
+    };
+
+    for (const auto& configuration : configurations) {
+        MySqlOptions options;
+        options.setCompression(configuration.compression)
+            .setZstdCompressionLevel(configuration.zstdLevel);
+        MySql connection(host, username, password, database, options);
+
+        vector<tuple<int, string, string>> rows;
+        const uint64_t before = getBytesSent(connection);
+        const auto start = steady_clock::now();
+        connection.runQuery(
+            &rows,
+            "SELECT id, name, description FROM benchmark_compression");
+        const auto elapsed = steady_clock::now() - start;
+        const uint64_t after = getBytesSent(connection);
+
+        cout << configuration.name << ": " << rows.size() << " rows, "
+            << (after - before) << " bytes on the wire, "
+            << duration_cast<microseconds>(elapsed).count() << " us"
+            << endl;
+    }
+
+    MySql connection(host, username, password, database);
+    connection.runCommand("DROP TABLE benchmark_compression");
+}
+
+
+uint64_t getBytesSent(const MySql& connection) {
+    vector<tuple<string, uint64_t>> status;
+    connection.runQuery(&status, "SHOW SESSION STATUS LIKE 'Bytes_sent'");
+    if (1 != status.size()) {
+        throw MySqlException("Unable to read Bytes_sent");
+    }
+    return get<1>(status.at(0));
+}
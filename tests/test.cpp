@@ -3,6 +3,7 @@
 
 #include "testInputBinder.hpp"
 #include "testMySql.hpp"
+#include "testMySqlSharedCache.hpp"
 #include "testOutputBinder.hpp"
 
 // Boost lets you name your tests, but I just want my tests to have the same
@@ -35,10 +36,37 @@ test::test_suite* init_unit_test_suite(int, char*[]) {
         FD(testSetParameter),
         // Tests from testMySql.hpp
         FD(testConnection),
+        FD(testConnectionOptions),
         FD(testRunCommand),
         FD(testRunQuery),
         FD(testInvalidCommands),
-        FD(testPreparedStatement)
+        FD(testPreparedStatement),
+        FD(testReplicaRouter),
+        FD(testShardSet),
+        FD(testQueryCache),
+        FD(testTransaction),
+        FD(testGroupCommit),
+        FD(testWriteBehind),
+        FD(testBulkLoader),
+        FD(testParallelBulkLoader),
+        FD(testParallelScanner),
+        FD(testKeysetPager),
+        FD(testExport),
+        FD(testSnapshot),
+        FD(testArrowBatch),
+        FD(testReconnect),
+        FD(testConnectionWarmer),
+        FD(testMove),
+        FD(testThreadConnectionManager),
+        FD(testTryRun),
+        FD(testRetryExecutor),
+        FD(testScalar),
+        FD(testQueryInto),
+        FD(testForEachRow),
+        FD(testLazyRow),
+        FD(testFixedString),
+        // Tests from testMySqlSharedCache.hpp
+        FD(testSharedCache)
     };
 
     for (const auto& functionDescription : functions) {
@@ -1,25 +1,62 @@
 #include <cassert>
+#include <cctype>
+#include <cstdio>
 #include <mysql/mysql.h>
 
 #include <boost/lexical_cast.hpp>
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <deque>
 #include <exception>
+#include <fstream>
+#include <future>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <thread>
 #include <tuple>  // NOLINT[build/include_order]
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include "testMySql.hpp"
 #include "../MySql.hpp"
+#include "../MySqlArrow.hpp"
+#include "../MySqlBulkLoader.hpp"
+#include "../MySqlConnectionWarmer.hpp"
+#include "../MySqlError.hpp"
+#include "../MySqlException.hpp"
+#include "../MySqlExportSink.hpp"
+#include "../MySqlFixedString.hpp"
+#include "../MySqlGroupCommitter.hpp"
+#include "../MySqlKeysetPager.hpp"
+#include "../MySqlLazyRow.hpp"
+#include "../MySqlOptions.hpp"
+#include "../MySqlParallelBulkLoader.hpp"
+#include "../MySqlParallelScanner.hpp"
 #include "../MySqlPreparedStatement.hpp"
+#include "../MySqlQueryCache.hpp"
+#include "../MySqlReplicaRouter.hpp"
+#include "../MySqlRetryExecutor.hpp"
+#include "../MySqlShardSet.hpp"
+#include "../MySqlSnapshot.hpp"
+#include "../MySqlStringRef.hpp"
+#include "../MySqlThreadConnectionManager.hpp"
+#include "../MySqlTransaction.hpp"
+#include "../MySqlWriteBehind.hpp"
 
 using boost::bad_lexical_cast;
 using std::exception;
 using std::get;
+using std::chrono::milliseconds;
+using std::make_shared;
 using std::shared_ptr;
 using std::string;
 using std::vector;
 using std::tuple;
+using std::is_sorted;
+using std::unique_ptr;
 
 
 // Default user is a user named "test_mysql_cpp" with full privileges a
@@ -29,6 +66,7 @@ const char* const password = nullptr;
 const char* const database = "test_mysql_cpp";
 
 static void createUserTable(MySql* connection);
+static uint64_t getConnectionId(const MySql& connection);
 static void testSimpleSelects(
     const MySql& connection,
     const char* const host);
@@ -59,6 +97,39 @@ void testConnection() {
 }
 
 
+void testConnectionOptions() {
+    try {
+        MySqlOptions options;
+        options.setCompression(MySqlOptions::Compression::ZLIB)
+            .setConnectTimeout(5)
+            .setReadTimeout(30)
+            .setWriteTimeout(30)
+            .setProtocol(MYSQL_PROTOCOL_TCP)
+            .setMaxAllowedPacket(16 * 1024 * 1024);
+        const char* const host = "127.0.0.1";
+        MySql connection(host, username, password, database, options);
+        testSimpleSelects(connection, "localhost");
+
+        vector<tuple<string, string>> status;
+        connection.runQuery(
+            &status,
+            "SHOW SESSION STATUS LIKE 'Compression'");
+        BOOST_CHECK(
+            1 == status.size()
+            && "ON" == get<1>(status.at(0)));
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+
+    // Connecting through a nonexistent socket should fail
+    MySqlOptions options;
+    options.setUnixSocket("/nonexistent/mysql.sock");
+    BOOST_CHECK_THROW(
+        MySql("localhost", username, password, database, options),
+        MySqlException);
+}
+
+
 void testRunCommand() {
     try {
         const char* const host = "localhost";
@@ -361,6 +432,1444 @@ void testPreparedStatement() {
 }
 
 
+void testReplicaRouter() {
+    try {
+        const char* const host = "localhost";
+        unique_ptr<MySql> primary(
+            new MySql(host, username, password, database));
+        unique_ptr<MySql> replica(
+            new MySql(host, username, password, database));
+        createUserTable(primary.get());
+        const uint64_t primaryId = getConnectionId(*primary);
+        const uint64_t replicaId = getConnectionId(*replica);
+
+        MySqlReplicaRouter router(std::move(primary));
+        // With no replicas, everything goes to the primary
+        vector<tuple<uint64_t>> ids;
+        router.runQuery(&ids, "SELECT CONNECTION_ID()");
+        BOOST_CHECK(1 == ids.size() && primaryId == get<0>(ids.at(0)));
+        ids.clear();
+
+        router.addReplica(std::move(replica));
+        BOOST_CHECK(1 == router.getReplicaCount());
+        router.runQuery(&ids, "SELECT CONNECTION_ID()");
+        BOOST_CHECK(1 == ids.size() && replicaId == get<0>(ids.at(0)));
+        ids.clear();
+
+        // Reads are pinned to the primary right after a write
+        router.setReadYourWritesWindow(milliseconds(60 * 1000));
+        const string name("brandon");
+        BOOST_CHECK(1 == router.runCommand(
+            "INSERT INTO user (name) VALUES (?)",
+            name));
+        router.runQuery(&ids, "SELECT CONNECTION_ID()");
+        BOOST_CHECK(1 == ids.size() && primaryId == get<0>(ids.at(0)));
+        ids.clear();
+
+        // The window starts when the write finishes, even if the write
+        // takes longer than the window or fails
+        router.setReadYourWritesWindow(milliseconds(500));
+        router.runCommand("DO SLEEP(1)");
+        router.runQuery(&ids, "SELECT CONNECTION_ID()");
+        BOOST_CHECK(1 == ids.size() && primaryId == get<0>(ids.at(0)));
+        ids.clear();
+        BOOST_CHECK_THROW(
+            router.runOnPrimary([](MySql& connection) {
+                connection.runCommand("DO SLEEP(1)");
+                throw MySqlException("Failed write");
+            }),
+            MySqlException);
+        router.runQuery(&ids, "SELECT CONNECTION_ID()");
+        BOOST_CHECK(1 == ids.size() && primaryId == get<0>(ids.at(0)));
+        ids.clear();
+
+        // But go back to the replica once the window has passed
+        router.setReadYourWritesWindow(milliseconds(0));
+        router.runQuery(&ids, "SELECT CONNECTION_ID()");
+        BOOST_CHECK(1 == ids.size() && replicaId == get<0>(ids.at(0)));
+        ids.clear();
+
+        uint64_t transactionId = 0;
+        router.runOnPrimary([&transactionId](MySql& connection) {
+            transactionId = getConnectionId(connection);
+        });
+        BOOST_CHECK(primaryId == transactionId);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testShardSet() {
+    try {
+        const char* const host = "localhost";
+        unique_ptr<MySql> shard0(
+            new MySql(host, username, password, database));
+        unique_ptr<MySql> shard1(
+            new MySql(host, username, password, database));
+        createUserTable(shard0.get());
+        const uint64_t shard0Id = getConnectionId(*shard0);
+        const uint64_t shard1Id = getConnectionId(*shard1);
+
+        // Keys less than 100 go to shard 0, the rest to shard 1
+        MySqlShardSet<int> shards(
+            MySqlShardSet<int>::rangeSharding(vector<int>{100}));
+        shards.addShard(std::move(shard0));
+        shards.addShard(std::move(shard1));
+        BOOST_CHECK(2 == shards.getShardCount());
+        BOOST_CHECK(0 == shards.getShardIndex(5));
+        BOOST_CHECK(1 == shards.getShardIndex(100));
+
+        vector<tuple<uint64_t>> ids;
+        shards.runQuery(&ids, 5, "SELECT CONNECTION_ID()");
+        shards.runQuery(&ids, 500, "SELECT CONNECTION_ID()");
+        BOOST_CHECK(
+            2 == ids.size()
+            && shard0Id == get<0>(ids.at(0))
+            && shard1Id == get<0>(ids.at(1)));
+        ids.clear();
+
+        shards.runQueryOnAll(&ids, "SELECT CONNECTION_ID()");
+        BOOST_CHECK(
+            2 == ids.size()
+            && shard0Id == get<0>(ids.at(0))
+            && shard1Id == get<0>(ids.at(1)));
+        ids.clear();
+
+        const string names[] = {"brandon", "gary", "tessa"};
+        for (const auto& name : names) {
+            shards.runCommand(
+                5,
+                "INSERT INTO user (name) VALUES (?)",
+                name);
+        }
+        // Both shards are the same table, so each row comes back twice
+        vector<tuple<string, int>> users;
+        const int minimumId = 0;
+        shards.runSortedQueryOnAll<0>(
+            &users,
+            "SELECT name, id FROM user WHERE id > ? ORDER BY name",
+            minimumId);
+        BOOST_CHECK(6 == users.size());
+        BOOST_CHECK(is_sorted(users.begin(), users.end()));
+
+        // The default collation is case insensitive, so merging mixed case
+        // strings needs a matching comparison
+        const string mixedCaseNames[] = {"Alice", "Hank"};
+        for (const auto& name : mixedCaseNames) {
+            shards.runCommand(
+                5,
+                "INSERT INTO user (name) VALUES (?)",
+                name);
+        }
+        const auto caseInsensitiveLess = [](const string& a, const string& b) {
+            return std::lexicographical_compare(
+                a.begin(),
+                a.end(),
+                b.begin(),
+                b.end(),
+                [](const unsigned char x, const unsigned char y) {
+                    return std::tolower(x) < std::tolower(y);
+                });
+        };
+        users.clear();
+        shards.runSortedQueryOnAll<0>(
+            &users,
+            caseInsensitiveLess,
+            "SELECT name, id FROM user WHERE id > ? ORDER BY name",
+            minimumId);
+        BOOST_CHECK(10 == users.size());
+        BOOST_CHECK(is_sorted(
+            users.begin(),
+            users.end(),
+            [&caseInsensitiveLess](
+                const tuple<string, int>& a,
+                const tuple<string, int>& b
+            ) {
+                return caseInsensitiveLess(get<0>(a), get<0>(b));
+            }));
+        // Or the query can sort by a binary collation
+        users.clear();
+        shards.runSortedQueryOnAll<0>(
+            &users,
+            "SELECT name, id FROM user WHERE id > ? ORDER BY BINARY name",
+            minimumId);
+        BOOST_CHECK(10 == users.size());
+        BOOST_CHECK(is_sorted(users.begin(), users.end()));
+
+        MySqlShardSet<int> hashed;
+        BOOST_CHECK_THROW(hashed.getShardIndex(1), MySqlException);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testQueryCache() {
+    // Table names are found without a server
+    const auto tablesIn = [](const char* const statement) -> vector<string> {
+        vector<string> tables;
+        BOOST_CHECK(MySqlQueryCache::getTables(statement, &tables));
+        return tables;
+    };
+    const vector<string> tables(tablesIn(
+        "SELECT u.name FROM `db`.`User` AS u JOIN session s ON u.id = s.id"
+        " WHERE u.name = 'FROM fake'"));
+    BOOST_CHECK(
+        2 == tables.size()
+        && "user" == tables.at(0)
+        && "session" == tables.at(1));
+    BOOST_CHECK(
+        vector<string>{"user"} == tablesIn("DROP TABLE IF EXISTS user"));
+
+    // Comma separated table lists
+    const vector<string> ab{"a", "b"};
+    BOOST_CHECK(ab == tablesIn("SELECT a.x FROM a, b"));
+    BOOST_CHECK(
+        ab == tablesIn(
+            "SELECT x.id FROM a x, `db`.b AS y WHERE x.id IN (1, 2)"
+            " ORDER BY x.id, y.id"));
+    BOOST_CHECK(ab == tablesIn("UPDATE a, b SET a.x = 1, b.y = 2"));
+    BOOST_CHECK(ab == tablesIn("DELETE FROM a USING a JOIN b ON a.x = b.x"));
+    BOOST_CHECK(
+        (vector<string>{"a", "b", "c"})
+        == tablesIn("SELECT x FROM a WHERE id IN (SELECT id FROM b, c)"));
+    BOOST_CHECK(
+        vector<string>{"a"} == tablesIn("SELECT x FROM a FOR UPDATE"));
+
+    // INSERT and REPLACE without INTO, and TRUNCATE without TABLE
+    const vector<string> t{"t"};
+    BOOST_CHECK(t == tablesIn("INSERT t (x) VALUES (1), (2)"));
+    BOOST_CHECK(
+        t == tablesIn(
+            "INSERT INTO t (x, y) VALUES (1, 2)"
+            " ON DUPLICATE KEY UPDATE x = 1, y = 2"));
+    BOOST_CHECK(t == tablesIn("REPLACE t VALUES (1)"));
+    BOOST_CHECK(t == tablesIn("REPLACE LOW_PRIORITY INTO t VALUES (1)"));
+    BOOST_CHECK(t == tablesIn("TRUNCATE t"));
+    BOOST_CHECK(t == tablesIn("TRUNCATE TABLE t"));
+
+    // Statements that don't touch any tables
+    BOOST_CHECK(tablesIn("SELECT 1").empty());
+    BOOST_CHECK(tablesIn("START TRANSACTION").empty());
+
+    // Statements whose tables can't be found
+    for (const char* const statement : {
+        "CALL refresh()",
+        "DO RELEASE_LOCK('a')",
+        "CREATE INDEX i ON t (x)"
+    }) {
+        vector<string> unknown;
+        BOOST_CHECK(!MySqlQueryCache::getTables(statement, &unknown));
+    }
+
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        connection.runCommand("INSERT INTO user (name) VALUES ('brandon')");
+
+        const shared_ptr<MySqlQueryCache> cache(
+            make_shared<MySqlQueryCache>(1024 * 1024, milliseconds(60 * 1000)));
+        connection.setQueryCache(cache);
+
+        const char* const query = "SELECT name FROM user WHERE id > ?";
+        const int minimumId = 0;
+        shared_ptr<const vector<tuple<string>>> first;
+        shared_ptr<const vector<tuple<string>>> second;
+        connection.runCachedQuery(&first, query, minimumId);
+        connection.runCachedQuery(&second, query, minimumId);
+        BOOST_CHECK(1 == first->size());
+        // The second query should be a cache hit
+        BOOST_CHECK(first == second);
+        BOOST_CHECK(1 == cache->getEntryCount());
+
+        // Different parameters are a different entry
+        const int otherMinimumId = 100;
+        connection.runCachedQuery(&second, query, otherMinimumId);
+        BOOST_CHECK(0 == second->size());
+        BOOST_CHECK(2 == cache->getEntryCount());
+
+        // Writing to the table invalidates the entries
+        const string name("gary");
+        connection.runCommand("INSERT INTO user (name) VALUES (?)", name);
+        BOOST_CHECK(0 == cache->getEntryCount());
+        connection.runCachedQuery(&second, query, minimumId);
+        BOOST_CHECK(first != second);
+        BOOST_CHECK(2 == second->size());
+
+        // A command whose tables can't be found clears everything
+        BOOST_CHECK(1 == cache->getEntryCount());
+        cache->invalidateTablesIn("CALL refresh()");
+        BOOST_CHECK(0 == cache->getEntryCount());
+
+        // Results aren't cached if a table was invalidated while the query
+        // ran, e.g. by another connection
+        const MySqlQueryCache::Snapshot snapshot(cache->getSnapshot(query));
+        cache->invalidateTable("User");
+        cache->put(first, snapshot, query, minimumId);
+        BOOST_CHECK(0 == cache->getEntryCount());
+        cache->put(first, cache->getSnapshot(query), query, minimumId);
+        BOOST_CHECK(1 == cache->getEntryCount());
+
+        // Uncommitted rows aren't cached, so they're gone after a rollback
+        {
+            MySqlTransaction transaction(&connection);
+            connection.runCommand(
+                "INSERT INTO user (name) VALUES ('rolled back')");
+            connection.runCachedQuery(&second, query, minimumId);
+            BOOST_CHECK(3 == second->size());
+            BOOST_CHECK(0 == cache->getEntryCount());
+        }
+        connection.runCachedQuery(&second, query, minimumId);
+        BOOST_CHECK(2 == second->size());
+        BOOST_CHECK(1 == cache->getEntryCount());
+
+        // Another connection can cache the old rows until the commit, so
+        // the commit invalidates them again
+        MySql other(host, username, password, database);
+        other.setQueryCache(cache);
+        {
+            MySqlTransaction transaction(&connection);
+            connection.runCommand(
+                "INSERT INTO user (name) VALUES ('committed')");
+            BOOST_CHECK(0 == cache->getEntryCount());
+            other.runCachedQuery(&second, query, minimumId);
+            BOOST_CHECK(2 == second->size());
+            BOOST_CHECK(1 == cache->getEntryCount());
+            transaction.commit();
+        }
+        BOOST_CHECK(0 == cache->getEntryCount());
+        other.runCachedQuery(&second, query, minimumId);
+        BOOST_CHECK(3 == second->size());
+
+        // Results that don't fit aren't cached
+        const shared_ptr<MySqlQueryCache> tinyCache(
+            make_shared<MySqlQueryCache>(1, milliseconds(60 * 1000)));
+        connection.setQueryCache(tinyCache);
+        connection.runCachedQuery(&first, query, minimumId);
+        BOOST_CHECK(0 == tinyCache->getEntryCount());
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testTransaction() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        vector<tuple<string>> names;
+
+        // Rolled back when it goes out of scope
+        {
+            MySqlTransaction transaction(&connection);
+            connection.runCommand("INSERT INTO user (name) VALUES ('brandon')");
+            BOOST_CHECK(transaction.isActive());
+        }
+        connection.runQuery(&names, "SELECT name FROM user");
+        BOOST_CHECK(0 == names.size());
+
+        {
+            MySqlTransaction transaction(&connection);
+            connection.runCommand("INSERT INTO user (name) VALUES ('brandon')");
+            transaction.setSavepoint("before_gary");
+            connection.runCommand("INSERT INTO user (name) VALUES ('gary')");
+            transaction.rollbackToSavepoint("before_gary");
+            transaction.commit();
+            BOOST_CHECK(!transaction.isActive());
+            BOOST_CHECK_THROW(transaction.commit(), MySqlException);
+            BOOST_CHECK_THROW(
+                transaction.setSavepoint("bad name; DROP TABLE user"),
+                MySqlException);
+        }
+        connection.runQuery(&names, "SELECT name FROM user");
+        BOOST_CHECK(
+            1 == names.size()
+            && "brandon" == get<0>(names.at(0)));
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testGroupCommit() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+
+        vector<std::future<my_ulonglong>> inserted;
+        {
+            MySqlGroupCommitter committer(
+                unique_ptr<MySql>(
+                    new MySql(host, username, password, database)),
+                4,
+                std::chrono::microseconds(10 * 1000));
+            const vector<string> names{"a", "b", "c", "d", "e"};
+            for (const auto& name : names) {
+                inserted.push_back(committer.submit(
+                    "INSERT INTO user (name) VALUES (?)",
+                    name));
+            }
+            // The duplicate fails on its own without taking the rest of its
+            // batch down with it
+            const string duplicate("a");
+            inserted.push_back(committer.submit(
+                "INSERT INTO user (name) VALUES (?)",
+                duplicate));
+            committer.flush();
+            const string last("f");
+            // The destructor commits this one
+            inserted.push_back(committer.submit(
+                "INSERT INTO user (name) VALUES (?)",
+                last));
+        }
+
+        for (size_t i = 0; i < inserted.size(); ++i) {
+            if (5 == i) {
+                BOOST_CHECK_THROW(inserted.at(i).get(), MySqlException);
+            } else {
+                BOOST_CHECK(1 == inserted.at(i).get());
+            }
+        }
+        vector<tuple<string>> names;
+        connection.runQuery(&names, "SELECT name FROM user");
+        BOOST_CHECK(6 == names.size());
+
+        // Requests that are left over after a full batch keep their own
+        // deadline, instead of waiting another maximumDelay after the batch
+        // is taken
+        const milliseconds maximumDelay(500);
+        MySqlGroupCommitter committer(
+            unique_ptr<MySql>(new MySql(host, username, password, database)),
+            2,
+            maximumDelay);
+        std::future<my_ulonglong> slow(committer.submit("DO SLEEP(1)"));
+        std::future<my_ulonglong> full(committer.submit("DO 1"));
+        // These are queued while the slow batch commits, so their deadline
+        // has passed by the time it's done
+        vector<std::future<my_ulonglong>> queued;
+        for (const auto& name : {"g", "h", "i"}) {
+            queued.push_back(committer.submit(
+                "INSERT INTO user (name) VALUES (?)",
+                string(name)));
+        }
+        slow.get();
+        full.get();
+        queued.at(1).get();
+        BOOST_CHECK(
+            std::future_status::ready
+            == queued.at(2).wait_for(maximumDelay / 2));
+        BOOST_CHECK(1 == queued.at(2).get());
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testWriteBehind() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+
+        // Multi-row commands bind every row's values in order
+        const vector<tuple<string, string>> users{
+            tuple<string, string>("brandon", "pass1"),
+            tuple<string, string>("gary", "pass2")};
+        BOOST_CHECK(2 == connection.runMultiRowCommand(
+            "INSERT INTO user (name, password) VALUES (?, ?), (?, ?)",
+            users));
+
+        MySqlWriteBehind<string> writeBehind(
+            unique_ptr<MySql>(new MySql(host, username, password, database)),
+            "INSERT INTO user (name) VALUES",
+            10,
+            3);
+        for (int i = 0; i < 25; ++i) {
+            writeBehind.push(boost::lexical_cast<string>(i));
+        }
+        writeBehind.flush();
+        BOOST_CHECK(0 == writeBehind.getPendingCount());
+        vector<tuple<string>> names;
+        connection.runQuery(&names, "SELECT name FROM user");
+        BOOST_CHECK(27 == names.size());
+
+        // Errors come back from flush
+        writeBehind.push(string("brandon"));
+        BOOST_CHECK_THROW(writeBehind.flush(), MySqlException);
+        // And only once
+        writeBehind.flush();
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testBulkLoader() {
+    try {
+        const char* const host = "localhost";
+        MySqlOptions options;
+        options.setLocalInfile(true);
+        MySql connection(host, username, password, database, options);
+        createUserTable(&connection);
+
+        typedef tuple<string, shared_ptr<string>> User;
+        vector<User> users;
+        // Characters that need escaping
+        users.push_back(User("tab\tnew\nline", make_shared<string>("\\N")));
+        users.push_back(User("null", shared_ptr<string>()));
+        for (int i = 0; i < 1000; ++i) {
+            users.push_back(User(
+                boost::lexical_cast<string>(i),
+                make_shared<string>("password")));
+        }
+
+        MySqlBulkLoader loader(&connection);
+        const MySqlBulkLoader::Result result = loader.load(
+            "user",
+            "name, password",
+            users.begin(),
+            users.end());
+        BOOST_CHECK(users.size() == result.rowCount);
+        BOOST_CHECK(0 == result.warningCount);
+
+        vector<tuple<string, shared_ptr<string>>> loaded;
+        connection.runQuery(
+            &loaded,
+            "SELECT name, password FROM user ORDER BY id LIMIT 2");
+        BOOST_CHECK(
+            2 == loaded.size()
+            && get<0>(users.at(0)) == get<0>(loaded.at(0))
+            && nullptr != get<1>(loaded.at(0))
+            && "\\N" == *get<1>(loaded.at(0))
+            && nullptr == get<1>(loaded.at(1)));
+
+        // Duplicate keys are skipped with a warning
+        vector<tuple<string>> duplicates{tuple<string>("null")};
+        const MySqlBulkLoader::Result duplicateResult = loader.load(
+            "user",
+            "name",
+            duplicates.begin(),
+            duplicates.end());
+        BOOST_CHECK(0 == duplicateResult.rowCount);
+        BOOST_CHECK(1 == duplicateResult.warningCount);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testParallelBulkLoader() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+
+        MySqlOptions options;
+        options.setLocalInfile(true);
+        MySqlParallelBulkLoader loader;
+        for (int i = 0; i < 3; ++i) {
+            loader.addConnection(unique_ptr<MySql>(
+                new MySql(host, username, password, database, options)));
+        }
+        // Small chunks that don't divide the rows evenly
+        loader.setChunkSize(7);
+
+        vector<tuple<string>> users;
+        for (int i = 0; i < 100; ++i) {
+            users.push_back(tuple<string>(boost::lexical_cast<string>(i)));
+        }
+        const MySqlParallelBulkLoader::Result result = loader.load(
+            "user",
+            "name",
+            users.begin(),
+            users.end());
+        BOOST_CHECK(100 == result.rowCount);
+        BOOST_CHECK(15 == result.chunkCount);
+        BOOST_CHECK(0 == result.retryCount);
+
+        vector<tuple<string>> names;
+        connection.runQuery(&names, "SELECT name FROM user");
+        BOOST_CHECK(100 == names.size());
+
+        // Errors come back after every connection has stopped
+        BOOST_CHECK_THROW(
+            loader.load(
+                "no_such_table",
+                "name",
+                users.begin(),
+                users.end()),
+            MySqlException);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testParallelScanner() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+
+        MySqlParallelScanner scanner;
+        for (int i = 0; i < 3; ++i) {
+            scanner.addConnection(unique_ptr<MySql>(
+                new MySql(host, username, password, database)));
+        }
+
+        // Empty tables have no ranges
+        vector<tuple<int64_t, string>> users;
+        scanner.scan(&users, "user", "id", "id, name");
+        BOOST_CHECK(users.empty());
+
+        for (int i = 0; i < 100; ++i) {
+            const string name(boost::lexical_cast<string>(i));
+            connection.runCommand("INSERT INTO user (name) VALUES (?)", name);
+        }
+
+        const vector<MySqlParallelScanner::KeyRange> ranges(
+            MySqlParallelScanner::getKeyRanges(connection, "user", "id", 8));
+        BOOST_CHECK(!ranges.empty() && ranges.size() <= 8);
+        for (size_t i = 1; i < ranges.size(); ++i) {
+            BOOST_CHECK(ranges.at(i - 1).second + 1 == ranges.at(i).first);
+        }
+
+        // The merged scan is in key order
+        scanner.scan(&users, "user", "id", "id, name");
+        BOOST_CHECK(100 == users.size());
+        BOOST_CHECK(is_sorted(users.begin(), users.end()));
+
+        // Each connection gets its own consumer calls
+        vector<size_t> rowCounts(scanner.getConnectionCount(), 0);
+        scanner.scanEach<int64_t>(
+            "user",
+            "id",
+            "id",
+            [&rowCounts](
+                const size_t connectionIndex,
+                vector<tuple<int64_t>>& rows
+            ) {
+                rowCounts.at(connectionIndex) += rows.size();
+            });
+        size_t total = 0;
+        for (const size_t rowCount : rowCounts) {
+            total += rowCount;
+        }
+        BOOST_CHECK(100 == total);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testKeysetPager() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        for (int i = 0; i < 250; ++i) {
+            const string name(boost::lexical_cast<string>(i));
+            connection.runCommand("INSERT INTO user (name) VALUES (?)", name);
+        }
+
+        MySqlKeysetPager<0, int64_t, string> pager(
+            &connection,
+            "SELECT id, name FROM user WHERE id > ? ORDER BY id LIMIT ?",
+            0);
+        // The minimum and maximum are the same, so the page size can't adapt
+        // and the page count is predictable
+        pager.setPageSizeLimits(10, 10);
+
+        vector<tuple<int64_t, string>> page;
+        vector<int64_t> ids;
+        size_t pageCount = 0;
+        while (pager.nextPage(&page)) {
+            BOOST_CHECK(page.size() <= 10);
+            ++pageCount;
+            for (const auto& row : page) {
+                ids.push_back(get<0>(row));
+            }
+        }
+        BOOST_CHECK(page.empty());
+        BOOST_CHECK(25 == pageCount);
+        BOOST_CHECK(250 == ids.size());
+        BOOST_CHECK(is_sorted(ids.begin(), ids.end()));
+        BOOST_CHECK(
+            std::adjacent_find(ids.begin(), ids.end()) == ids.end());
+
+        // Fast pages grow up to the maximum
+        MySqlKeysetPager<0, int64_t, string> growingPager(
+            &connection,
+            "SELECT id, name FROM user WHERE id > ? ORDER BY id LIMIT ?",
+            0);
+        growingPager.setPageSizeLimits(10, 40);
+        growingPager.setTargetLatency(milliseconds(60 * 1000));
+        growingPager.nextPage(&page);
+        growingPager.nextPage(&page);
+        growingPager.nextPage(&page);
+        BOOST_CHECK(40 == growingPager.getPageSize());
+
+        // And slow pages shrink. No page can take less than 0 milliseconds.
+        growingPager.setTargetLatency(milliseconds(0));
+        growingPager.nextPage(&page);
+        BOOST_CHECK(20 == growingPager.getPageSize());
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testExport() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        connection.runCommand(
+            "INSERT INTO user (name, password) VALUES ('alice', NULL)");
+        connection.runCommand(
+            "INSERT INTO user (name, password) VALUES ('b,\"ob\"', '')");
+        const char* const query =
+            "SELECT id, name, password FROM user WHERE id > ? ORDER BY id";
+        const int after = 0;
+
+        MySqlCsvSink csv;
+        BOOST_CHECK(2 == connection.runExport(&csv, query, after));
+        BOOST_CHECK(
+            "id,name,password\r\n"
+            "1,alice,\r\n"
+            "2,\"b,\"\"ob\"\"\",\"\"\r\n" == csv.getOutput());
+
+        MySqlJsonLinesSink json;
+        BOOST_CHECK(2 == connection.runExport(&json, query, after));
+        BOOST_CHECK(
+            "{\"id\":1,\"name\":\"alice\",\"password\":null}\n"
+            "{\"id\":2,\"name\":\"b,\\\"ob\\\"\",\"password\":\"\"}\n"
+            == json.getOutput());
+
+        MySqlBinarySink binary;
+        BOOST_CHECK(2 == connection.runExport(&binary, query, after));
+        BOOST_CHECK(0 == binary.getOutput().compare(0, 9, "MYSQLCPP1"));
+
+        // Numbers and values longer than the initial buffers
+        MySqlCsvSink wide;
+        connection.runExport(
+            &wide,
+            "SELECT -9223372036854775808, 18446744073709551615, 0.5e0,"
+                " 1.25, REPEAT('x', 1000)");
+        BOOST_CHECK(
+            "-9223372036854775808,18446744073709551615,0.5,1.25,"
+            + string(1000, 'x') + "\r\n"
+            == wide.getOutput().substr(wide.getOutput().find('\n') + 1));
+
+        // Exporting to a file gives the same output
+        const char* const path = "/tmp/mysql-cpp-test-export.csv";
+        MySqlCsvSink file(path);
+        connection.runExport(&file, query, after);
+        file.close();
+        std::ifstream input(path, std::ios::binary);
+        const string contents(
+            (std::istreambuf_iterator<char>(input)),
+            std::istreambuf_iterator<char>());
+        BOOST_CHECK(csv.getOutput() == contents);
+        std::remove(path);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testSnapshot() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        connection.runCommand(
+            "INSERT INTO user (name, password) VALUES ('alice', NULL)");
+        connection.runCommand(
+            "INSERT INTO user (name, password) VALUES ('bob', 'hunter2')");
+
+        typedef MySqlSnapshot<int64_t, string, shared_ptr<string>> Snapshot;
+        vector<Snapshot::Row> users;
+        connection.runQuery(
+            &users,
+            "SELECT id, name, password FROM user ORDER BY id");
+        const char* const path = "/tmp/mysql-cpp-test.snapshot";
+        Snapshot::write(path, users);
+
+        const Snapshot snapshot(path);
+        BOOST_REQUIRE(2 == snapshot.size());
+        BOOST_CHECK(1 == snapshot.get<0>(0));
+        BOOST_CHECK("bob" == snapshot.get<1>(1).str());
+        BOOST_CHECK(snapshot.isNull<2>(0));
+        BOOST_CHECK(!snapshot.isNull<2>(1));
+        BOOST_CHECK("hunter2" == snapshot.get<2>(1).str());
+        BOOST_CHECK_THROW(snapshot.get<2>(0), MySqlException);
+
+        vector<Snapshot::Row> reloaded;
+        snapshot.getRows(&reloaded);
+        BOOST_REQUIRE(2 == reloaded.size());
+        BOOST_CHECK("alice" == get<1>(reloaded.at(0)));
+        BOOST_CHECK(nullptr == get<2>(reloaded.at(0)));
+        BOOST_CHECK(
+            nullptr != get<2>(reloaded.at(1))
+            && "hunter2" == *get<2>(reloaded.at(1)));
+
+        // Opening with different column types fails
+        BOOST_CHECK_THROW(
+            (MySqlSnapshot<int32_t, string, shared_ptr<string>>(path)),
+            MySqlException);
+        BOOST_CHECK_THROW(
+            (MySqlSnapshot<int64_t, string>(path)),
+            MySqlException);
+        std::remove(path);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testArrowBatch() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        connection.runCommand(
+            "INSERT INTO user (name, password) VALUES ('alice', NULL)");
+        connection.runCommand(
+            "INSERT INTO user (name, password) VALUES ('bob', 'hunter2')");
+
+        MySqlArrowBatch<int32_t, string, shared_ptr<string>> batch;
+        connection.runQuery(
+            &batch,
+            "SELECT id, name, password FROM user WHERE id > ? ORDER BY id",
+            0);
+        BOOST_REQUIRE(2 == batch.getRowCount());
+        BOOST_CHECK(1 == batch.getValue<0>(0));
+        BOOST_CHECK("bob" == batch.getValue<1>(1).str());
+        BOOST_CHECK(batch.isNull<2>(0));
+        BOOST_CHECK("hunter2" == batch.getValue<2>(1).str());
+        BOOST_CHECK(1 == batch.getNullCount(2));
+
+        ArrowArray array;
+        ArrowSchema schema;
+        batch.exportTo(&array, &schema);
+        BOOST_CHECK(0 == batch.getRowCount());
+        BOOST_CHECK(2 == array.length);
+        BOOST_REQUIRE(3 == array.n_children);
+        BOOST_CHECK(string("+s") == schema.format);
+        BOOST_CHECK(string("name") == schema.children[1]->name);
+        BOOST_CHECK(string("u") == schema.children[1]->format);
+        BOOST_CHECK(ARROW_FLAG_NULLABLE == schema.children[2]->flags);
+        const int32_t* const ids =
+            static_cast<const int32_t*>(array.children[0]->buffers[1]);
+        BOOST_CHECK(1 == ids[0] && 2 == ids[1]);
+        BOOST_CHECK(1 == array.children[2]->null_count);
+        array.release(&array);
+        schema.release(&schema);
+        BOOST_CHECK(nullptr == array.release);
+
+        // Non-nullable columns reject NULLs
+        MySqlArrowBatch<string> strict;
+        BOOST_CHECK_THROW(
+            connection.runQuery(&strict, "SELECT password FROM user"),
+            MySqlException);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testReconnect() {
+    try {
+        const char* const host = "localhost";
+        MySqlOptions options;
+        options.setReconnectAttempts(3).setReconnectBackoff(10, 100);
+        MySql connection(host, username, password, database, options);
+        MySql killer(host, username, password, database);
+
+        const MySqlPreparedStatement statement(
+            connection.prepareStatement("SELECT CONNECTION_ID()"));
+        vector<tuple<uint64_t>> ids;
+        connection.runQuery(&ids, statement);
+        BOOST_REQUIRE(1 == ids.size());
+        const uint64_t firstId = get<0>(ids[0]);
+
+        // The query is run again on a new connection, and the statement is
+        // prepared again behind the scenes
+        string kill("KILL " + boost::lexical_cast<string>(firstId));
+        killer.runCommand(kill.c_str());
+        ids.clear();
+        connection.runQuery(&ids, statement);
+        BOOST_REQUIRE(1 == ids.size());
+        const uint64_t secondId = get<0>(ids[0]);
+        BOOST_CHECK(firstId != secondId);
+
+        // Commands aren't run again, but the connection works afterward
+        kill = "KILL " + boost::lexical_cast<string>(secondId);
+        killer.runCommand(kill.c_str());
+        BOOST_CHECK_THROW(connection.runCommand("DO 1"), MySqlException);
+        connection.runCommand("DO 1");
+        ids.clear();
+        connection.runQuery(&ids, statement);
+        BOOST_CHECK(1 == ids.size());
+
+        // Without reconnecting, the connection stays lost
+        MySql plain(host, username, password, database);
+        kill = "KILL " + boost::lexical_cast<string>(getConnectionId(plain));
+        killer.runCommand(kill.c_str());
+        BOOST_CHECK_THROW(getConnectionId(plain), MySqlException);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testConnectionWarmer() {
+    try {
+        const char* const path = "/tmp/mysql-cpp-test-manifest.sql";
+        {
+            std::ofstream manifest(path);
+            manifest << "# Statements for the user table\n"
+                << "\n"
+                << "  SELECT id, name FROM user WHERE id = ?  \n"
+                << "-- Duplicates are only prepared once\n"
+                << "SELECT id, name FROM user WHERE id = ?\n";
+        }
+        const char* const host = "localhost";
+        MySql setup(host, username, password, database);
+        createUserTable(&setup);
+
+        MySqlConnectionWarmer warmer(host, username, password, database);
+        warmer.loadManifest(path);
+        std::remove(path);
+        warmer.addStatement("INSERT INTO user (name) VALUES (?)");
+        BOOST_REQUIRE(2 == warmer.getStatements().size());
+        BOOST_CHECK("SELECT id, name FROM user WHERE id = ?"
+            == warmer.getStatements().at(0));
+
+        warmer.setMaximumThreads(2);
+        vector<MySql> connections(warmer.open(5));
+        BOOST_REQUIRE(5 == connections.size());
+        for (const auto& connection : connections) {
+            BOOST_CHECK(2 == connection.getCachedStatementCount());
+        }
+
+        // The cached statements are used by query text
+        const string name("alice");
+        BOOST_CHECK(1 == connections.at(0).runCommand(
+            "INSERT INTO user (name) VALUES (?)",
+            name));
+        vector<tuple<int, string>> users;
+        connections.at(4).runQuery(
+            &users,
+            "SELECT id, name FROM user WHERE id = ?",
+            1);
+        BOOST_REQUIRE(1 == users.size());
+        BOOST_CHECK(name == get<1>(users.at(0)));
+
+        BOOST_CHECK_THROW(warmer.loadManifest(path), MySqlException);
+        warmer.addStatement("SELECT * FROM no_such_table");
+        BOOST_CHECK_THROW(warmer.open(3), MySqlException);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testMove() {
+    static_assert(
+        std::is_nothrow_move_constructible<MySql>::value
+            && std::is_nothrow_move_assignable<MySql>::value,
+        "MySql moves should be noexcept");
+    static_assert(
+        std::is_nothrow_move_constructible<MySqlPreparedStatement>::value
+            && std::is_nothrow_move_assignable<MySqlPreparedStatement>::value,
+        "MySqlPreparedStatement moves should be noexcept");
+    try {
+        const char* const host = "localhost";
+        vector<MySql> connections;
+        for (int i = 0; i < 3; ++i) {
+            connections.push_back(MySql(host, username, password, database));
+        }
+        createUserTable(&connections.at(0));
+        const uint64_t id = getConnectionId(connections.at(1));
+
+        std::unordered_map<string, MySqlPreparedStatement> statements;
+        statements.emplace(
+            "insert",
+            connections.at(1).prepareStatement(
+                "INSERT INTO user (name) VALUES (?)"));
+        statements.emplace(
+            "select",
+            connections.at(1).prepareStatement("SELECT CONNECTION_ID()"));
+
+        // Moving the connection keeps the same session, and its statements
+        // keep working
+        MySql moved(std::move(connections.at(1)));
+        connections.erase(connections.begin() + 1);
+        BOOST_CHECK(id == getConnectionId(moved));
+        const string name("alice");
+        BOOST_CHECK(1 == moved.runCommand(statements.at("insert"), name));
+        vector<tuple<uint64_t>> ids;
+        moved.runQuery(&ids, statements.at("select"));
+        BOOST_REQUIRE(1 == ids.size());
+        BOOST_CHECK(id == get<0>(ids.at(0)));
+
+        // Assigning over a connection closes it
+        connections.at(0) = std::move(moved);
+        BOOST_CHECK(id == getConnectionId(connections.at(0)));
+        MySqlPreparedStatement statement(std::move(statements.at("select")));
+        statements.at("select") = std::move(statement);
+        ids.clear();
+        connections.at(0).runQuery(&ids, statements.at("select"));
+        BOOST_CHECK(1 == ids.size());
+
+        // Statements that outlive their connection throw
+        connections.clear();
+        BOOST_CHECK_THROW(
+            MySql(host, username, password, database).runQuery(
+                &ids,
+                statements.at("select")),
+            MySqlException);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testThreadConnectionManager() {
+    try {
+        MySqlThreadConnectionManager manager(
+            []() {
+                MySql connection("localhost", username, password, database);
+                connection.cacheStatement("SELECT CONNECTION_ID()");
+                return connection;
+            },
+            2);
+
+        MySql& connection = manager.getConnection();
+        BOOST_CHECK(&connection == &manager.getConnection());
+        BOOST_CHECK(1 == connection.getCachedStatementCount());
+        BOOST_CHECK(1 == manager.getConnectionCount());
+        const uint64_t id = getConnectionId(connection);
+
+        // Other threads get their own connections, up to the cap
+        uint64_t otherId = 0;
+        bool threw = false;
+        std::thread other([&]() {
+            otherId = getConnectionId(manager.getConnection());
+            std::thread third([&]() {
+                try {
+                    manager.getConnection();
+                } catch (const MySqlException&) {
+                    threw = true;
+                }
+            });
+            third.join();
+        });
+        other.join();
+        BOOST_CHECK(0 != otherId && id != otherId);
+        BOOST_CHECK(threw);
+        // The other thread's connection was closed when it exited
+        BOOST_CHECK(1 == manager.getConnectionCount());
+
+        manager.releaseConnection();
+        BOOST_CHECK(0 == manager.getConnectionCount());
+        BOOST_CHECK(id != getConnectionId(manager.getConnection()));
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testTryRun() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        const MySqlPreparedStatement insert(connection.prepareStatement(
+            "INSERT INTO user (name) VALUES (?)"));
+
+        const string name("alice");
+        MySqlExpected<my_ulonglong> inserted(
+            connection.tryRunCommand(insert, name));
+        BOOST_REQUIRE(inserted);
+        BOOST_CHECK(1 == inserted.getValue());
+
+        // Duplicate keys are returned
+        inserted = connection.tryRunCommand(insert, name);
+        BOOST_REQUIRE(!inserted);
+        const MySqlError& error = inserted.getError();
+        BOOST_CHECK(1062 == error.getErrorNumber());  // ER_DUP_ENTRY
+        BOOST_CHECK(string("23000") == error.getSqlState());
+        BOOST_CHECK(string(error.getMessage()).find(name) != string::npos);
+        BOOST_CHECK_THROW(inserted.getValue(), MySqlException);
+
+        // Usage errors still throw
+        BOOST_CHECK_THROW(
+            connection.tryRunCommand(insert, name, name),
+            MySqlException);
+
+        // Uncached query text is prepared and closed inside the call, so the
+        // message has to outlive the statement
+        const MySqlExpected<my_ulonglong> uncached(connection.tryRunCommand(
+            "INSERT INTO user (name) VALUES (?)",
+            name));
+        BOOST_REQUIRE(!uncached);
+        BOOST_CHECK(1062 == uncached.getError().getErrorNumber());
+        BOOST_CHECK(
+            string(uncached.getError().getMessage()).find(name)
+            != string::npos);
+        try {
+            uncached.getValue();
+            BOOST_ERROR("Expected an exception");
+        } catch (const MySqlException& e) {
+            BOOST_CHECK(string(e.what()).find(name) != string::npos);
+            BOOST_CHECK(1062 == e.getErrorNumber());
+        }
+
+        connection.runCommand("INSERT INTO user (name) VALUES ('bob')");
+        vector<tuple<int>> ids;
+        MySqlExpected<size_t> fetched(connection.tryRunQuery(
+            &ids,
+            "SELECT id FROM user WHERE id > ?",
+            0));
+        BOOST_REQUIRE(fetched);
+        BOOST_CHECK(2 == fetched.getValue());
+        BOOST_CHECK(2 == ids.size());
+
+        // Errors while executing are returned and the rows are dropped
+        fetched = connection.tryRunQuery(
+            &ids,
+            "SELECT (SELECT id FROM user) FROM user WHERE id > ?",
+            0);
+        BOOST_REQUIRE(!fetched);
+        BOOST_CHECK(1242 == fetched.getError().getErrorNumber());
+        BOOST_CHECK(!string(fetched.getError().getMessage()).empty());
+        BOOST_CHECK(2 == ids.size());
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testRetryExecutor() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        connection.runCommand("INSERT INTO user (name) VALUES ('brandon')");
+        connection.runCommand("SET SESSION innodb_lock_wait_timeout = 1");
+
+        MySql lockHolder(host, username, password, database);
+        unique_ptr<MySqlTransaction> lock(new MySqlTransaction(&lockHolder));
+        lockHolder.runCommand(
+            "UPDATE user SET password = 'a' WHERE name = 'brandon'");
+
+        MySqlRetryExecutor executor(&connection);
+        executor.setMaximumAttempts(3).setBackoff(1, 10);
+        int attempts = 0;
+        // The first attempt times out, then the lock is released
+        executor.run([&]() {
+            ++attempts;
+            if (2 == attempts) {
+                lock->commit();
+            }
+            connection.runCommand(
+                "UPDATE user SET password = ? WHERE name = 'brandon'",
+                string("b"));
+        });
+        BOOST_CHECK(2 == attempts);
+        BOOST_CHECK(1 == executor.getCommitCount());
+        BOOST_CHECK(1 == executor.getRetryCount());
+        BOOST_CHECK(1 == executor.getLockWaitTimeoutCount());
+        BOOST_CHECK(0 == executor.getExhaustedCount());
+
+        // Gives up once out of attempts, and the error number survives
+        lock.reset(new MySqlTransaction(&lockHolder));
+        lockHolder.runCommand(
+            "UPDATE user SET password = 'a' WHERE name = 'brandon'");
+        executor.setMaximumAttempts(1);
+        try {
+            executor.run([&]() {
+                connection.runCommand(
+                    "UPDATE user SET password = 'c' WHERE name = 'brandon'");
+            });
+            BOOST_ERROR("Lock wait timeout wasn't thrown");
+        } catch (const MySqlException& e) {
+            BOOST_CHECK(1205 == e.getErrorNumber());  // ER_LOCK_WAIT_TIMEOUT
+            BOOST_CHECK(MySqlRetryExecutor::isRetryable(e));
+        }
+        BOOST_CHECK(1 == executor.getExhaustedCount());
+        lock.reset();
+
+        // Other errors aren't retried
+        attempts = 0;
+        executor.setMaximumAttempts(3);
+        try {
+            executor.run([&]() {
+                ++attempts;
+                connection.runCommand(
+                    "INSERT INTO user (name) VALUES (?)",
+                    string("brandon"));
+            });
+            BOOST_ERROR("Duplicate key wasn't thrown");
+        } catch (const MySqlException& e) {
+            BOOST_CHECK(1062 == e.getErrorNumber());  // ER_DUP_ENTRY
+            BOOST_CHECK(string("23000") == e.getSqlState());
+        }
+        BOOST_CHECK(1 == attempts);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testScalar() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        connection.runCommand(
+            "INSERT INTO user (name, password) VALUES ('brandon', 'a')");
+        connection.runCommand("INSERT INTO user (name) VALUES ('gary')");
+
+        int64_t count = 0;
+        BOOST_CHECK(connection.runScalar(&count, "SELECT COUNT(*) FROM user"));
+        BOOST_CHECK(2 == count);
+
+        // Missing rows leave the value alone
+        string name("unchanged");
+        const int missingId = 100;
+        BOOST_CHECK(!connection.runScalar(
+            &name,
+            "SELECT name FROM user WHERE id = ?",
+            missingId));
+        BOOST_CHECK("unchanged" == name);
+
+        // Only the first row is read, and the connection can still be used
+        BOOST_CHECK(connection.runScalar(
+            &name,
+            "SELECT name FROM user ORDER BY name"));
+        BOOST_CHECK("brandon" == name);
+
+        // Longer than the default buffer
+        BOOST_CHECK(connection.runScalar(&name, "SELECT REPEAT('a', 100)"));
+        BOOST_CHECK(string(100, 'a') == name);
+
+        unique_ptr<string> userPassword;
+        BOOST_CHECK(connection.runScalar(
+            &userPassword,
+            "SELECT password FROM user WHERE name = 'gary'"));
+        BOOST_CHECK(nullptr == userPassword);
+        BOOST_CHECK_THROW(
+            connection.runScalar(
+                &name,
+                "SELECT password FROM user WHERE name = 'gary'"),
+            MySqlException);
+        BOOST_CHECK_THROW(
+            connection.runScalar(&name, "SELECT id, name FROM user"),
+            MySqlException);
+
+        const int id = 1;
+        BOOST_CHECK(connection.runExists(
+            "SELECT 1 FROM user WHERE id = ?",
+            id));
+        BOOST_CHECK(!connection.runExists(
+            "SELECT 1 FROM user WHERE id = ?",
+            missingId));
+        BOOST_CHECK(connection.runExists("SELECT * FROM user"));
+        BOOST_CHECK(connection.runScalar(&count, "SELECT COUNT(*) FROM user"));
+        BOOST_CHECK(2 == count);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testQueryInto() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        connection.runCommand(
+            "INSERT INTO user (name) VALUES ('brandon'), ('gary'), ('jeff')");
+        const char* const query = "SELECT id, name FROM user ORDER BY id";
+
+        std::deque<tuple<int, string>> deque;
+        connection.runQueryInto<int, string>(
+            std::back_inserter(deque),
+            query);
+        BOOST_CHECK(3 == deque.size());
+        BOOST_CHECK("jeff" == get<1>(deque.at(2)));
+
+        // Preallocated storage
+        tuple<int, string> users[3];
+        const tuple<int, string>* const end =
+            connection.runQueryInto<int, string>(users, query);
+        BOOST_CHECK(users + 3 == end);
+        BOOST_CHECK("gary" == get<1>(users[1]));
+
+        // Keyed by the first column
+        std::unordered_map<int, string> names;
+        connection.runQueryInto<int, string>(
+            makeMySqlRowSink([&names](tuple<int, string>&& user) {
+                names.emplace(get<0>(user), std::move(get<1>(user)));
+            }),
+            "SELECT id, name FROM user WHERE id > ?",
+            1);
+        BOOST_CHECK(2 == names.size());
+        BOOST_CHECK("gary" == names.at(2));
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testForEachRow() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        connection.runCommand(
+            "INSERT INTO user (name, password) VALUES"
+            " ('brandon', 'a'), ('gary', NULL)");
+
+        int64_t idTotal = 0;
+        size_t nameLength = 0;
+        my_ulonglong rows = connection.forEachRow(
+            "SELECT id, name FROM user WHERE id > ?",
+            [&](const int32_t& id, MySqlStringRef name) {
+                idTotal += id;
+                nameLength += name.size();
+            },
+            0);
+        BOOST_CHECK(2 == rows);
+        BOOST_CHECK(3 == idTotal);
+        BOOST_CHECK(11 == nameLength);
+
+        // Longer than the default buffer
+        rows = connection.forEachRow(
+            "SELECT REPEAT('a', 100)",
+            [](MySqlStringRef text) {
+                BOOST_CHECK(string(100, 'a') == text.str());
+            });
+        BOOST_CHECK(1 == rows);
+
+        // Other types are converted
+        vector<string> names;
+        connection.forEachRow(
+            "SELECT name, password FROM user ORDER BY id",
+            [&names](string name, const unique_ptr<string>& userPassword) {
+                if (nullptr == userPassword) {
+                    names.push_back(std::move(name));
+                }
+            });
+        BOOST_CHECK(1 == names.size() && "gary" == names.at(0));
+
+        BOOST_CHECK_THROW(
+            connection.forEachRow(
+                "SELECT password FROM user",
+                [](MySqlStringRef) {}),
+            MySqlException);
+        BOOST_CHECK_THROW(
+            connection.forEachRow("SELECT id, name FROM user", [](int) {}),
+            MySqlException);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testLazyRow() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        connection.runCommand(
+            "INSERT INTO user (name, password) VALUES"
+            " ('brandon', 'a'), ('gary', NULL), ('jeff', 'b')");
+
+        // The password is only read for the rows that pass the filter
+        vector<string> passwords;
+        const my_ulonglong rows = connection.forEachRow(
+            "SELECT id, name, password FROM user WHERE id > ?",
+            [&passwords](
+                const MySqlLazyRow<int32_t, MySqlStringRef, string>& user
+            ) {
+                if (!user.isNull<2>() && 'j' == *user.get<1>().data()) {
+                    passwords.push_back(user.get<2>());
+                }
+            },
+            0);
+        BOOST_CHECK(3 == rows);
+        BOOST_CHECK(1 == passwords.size() && "b" == passwords.at(0));
+
+        vector<tuple<int32_t, string, shared_ptr<string>>> users;
+        connection.forEachRow(
+            "SELECT id, name, password FROM user ORDER BY id",
+            [&users](
+                const MySqlLazyRow<int32_t, string, shared_ptr<string>>& user
+            ) {
+                users.push_back(user.toTuple());
+            });
+        BOOST_CHECK(3 == users.size());
+        BOOST_CHECK(nullptr == get<2>(users.at(1)));
+
+        // NULLs still need a smart pointer when they're read
+        BOOST_CHECK_THROW(
+            connection.forEachRow(
+                "SELECT password FROM user",
+                [](const MySqlLazyRow<string>& user) { user.get<0>(); }),
+            MySqlException);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
+void testFixedString() {
+    try {
+        const char* const host = "localhost";
+        MySql connection(host, username, password, database);
+        createUserTable(&connection);
+        connection.runCommand(
+            "INSERT INTO user (name, password) VALUES"
+            " ('brandon', 'a'), ('gary', NULL)");
+
+        vector<tuple<MySqlFixedString<8>, unique_ptr<MySqlFixedString<4>>>>
+            users;
+        connection.runQuery(&users, "SELECT name, password FROM user");
+        BOOST_REQUIRE(2 == users.size());
+        BOOST_CHECK("brandon" == get<0>(users.at(0)).str());
+        BOOST_CHECK("a" == get<1>(users.at(0))->str());
+        BOOST_CHECK(nullptr == get<1>(users.at(1)));
+
+        // Exactly fits
+        MySqlFixedString<7> name;
+        BOOST_CHECK(connection.runScalar(
+            &name,
+            "SELECT name FROM user WHERE name = 'brandon'"));
+        BOOST_CHECK(MySqlFixedString<7>(string("brandon")) == name);
+
+        // Doesn't fit
+        vector<tuple<MySqlFixedString<4>>> names;
+        BOOST_CHECK_THROW(
+            connection.runQuery(&names, "SELECT name FROM user"),
+            MySqlException);
+        BOOST_CHECK_THROW(
+            MySqlFixedString<4>(string("brandon")),
+            MySqlException);
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+}
+
+
 void createUserTable(MySql* const connection) {
     assert(nullptr != connection);
     my_ulonglong affectedRows = connection->runCommand(
@@ -398,3 +1907,11 @@ void testSimpleSelects(
         && database == *get<0>(results.at(0)));
     results.clear();
 }
+
+
+uint64_t getConnectionId(const MySql& connection) {
+    vector<tuple<uint64_t>> ids;
+    connection.runQuery(&ids, "SELECT CONNECTION_ID()");
+    BOOST_CHECK(1 == ids.size());
+    return get<0>(ids.at(0));
+}
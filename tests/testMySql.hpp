@@ -11,6 +11,11 @@
  */
 void testConnection();
 
+/**
+ * Tests connecting with MySqlOptions, e.g. with compression enabled.
+ */
+void testConnectionOptions();
+
 void testRunCommand();
 
 void testRunQuery();
@@ -24,4 +29,134 @@ void testInvalidCommands();
 
 void testPreparedStatement();
 
+/**
+ * Tests that MySqlReplicaRouter sends reads and writes to the right
+ * connections. The primary and the replica are the same server here, so this
+ * just checks the routing using connection IDs.
+ */
+void testReplicaRouter();
+
+/**
+ * Tests MySqlShardSet routing and scatter-gather queries. Both shards are the
+ * same server here.
+ */
+void testShardSet();
+
+/**
+ * Tests runCachedQuery hits and table based invalidation.
+ */
+void testQueryCache();
+
+/**
+ * Tests that MySqlTransaction commits, rolls back and uses savepoints.
+ */
+void testTransaction();
+
+/**
+ * Tests that MySqlGroupCommitter commits batches and isolates failures.
+ */
+void testGroupCommit();
+
+/**
+ * Tests multi-row commands and MySqlWriteBehind flushing and errors.
+ */
+void testWriteBehind();
+
+/**
+ * Tests that MySqlBulkLoader loads rows, escaping and NULLs. The server needs
+ * local_infile enabled.
+ */
+void testBulkLoader();
+
+/**
+ * Tests that MySqlParallelBulkLoader loads every chunk exactly once.
+ */
+void testParallelBulkLoader();
+
+/**
+ * Tests MySqlParallelScanner key ranges, merged scans and per-connection
+ * consumers.
+ */
+void testParallelScanner();
+
+/**
+ * Tests that MySqlKeysetPager reads every row once and adapts its page size.
+ */
+void testKeysetPager();
+
+/**
+ * Tests exporting results to CSV, JSON lines and the binary format.
+ */
+void testExport();
+
+/**
+ * Tests saving results to a snapshot file and reading them back.
+ */
+void testSnapshot();
+
+/**
+ * Tests decoding results into Arrow buffers and exporting them.
+ */
+void testArrowBatch();
+
+/**
+ * Tests reconnecting after the connection is killed, and that prepared
+ * statements still work afterward.
+ */
+void testReconnect();
+
+/**
+ * Tests opening connections in parallel with statements from a manifest
+ * already prepared.
+ */
+void testConnectionWarmer();
+
+/**
+ * Tests moving connections and prepared statements into containers.
+ */
+void testMove();
+
+/**
+ * Tests that MySqlThreadConnectionManager gives each thread its own
+ * connection and enforces its cap.
+ */
+void testThreadConnectionManager();
+
+/**
+ * Tests that tryRunCommand and tryRunQuery return server errors instead of
+ * throwing them.
+ */
+void testTryRun();
+
+/**
+ * Tests that MySqlRetryExecutor replays transactions that time out waiting
+ * for locks, and that exceptions carry the error number.
+ */
+void testRetryExecutor();
+
+/**
+ * Tests runScalar and runExists.
+ */
+void testScalar();
+
+/**
+ * Tests that runQueryInto writes rows to output iterators and row sinks.
+ */
+void testQueryInto();
+
+/**
+ * Tests that forEachRow calls a function with each row's columns.
+ */
+void testForEachRow();
+
+/**
+ * Tests that MySqlLazyRow converts columns when they're read.
+ */
+void testLazyRow();
+
+/**
+ * Tests reading short strings into MySqlFixedString.
+ */
+void testFixedString();
+
 #endif  // TESTS_TESTMYSQL_HPP_
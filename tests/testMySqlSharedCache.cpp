@@ -0,0 +1,72 @@
+#include <cstdint>
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "testMySqlSharedCache.hpp"
+#include "../MySqlException.hpp"
+#include "../MySqlSharedCache.hpp"
+
+using std::chrono::milliseconds;
+using std::exception;
+using std::get;
+using std::make_tuple;
+using std::shared_ptr;
+using std::string;
+using std::tuple;
+using std::vector;
+
+static const char* const cachePath = "/tmp/test_mysql_cpp_shared_cache";
+
+
+void testSharedCache() {
+    unlink(cachePath);
+    try {
+        MySqlSharedCache writer(cachePath, 16, 4096, milliseconds(60 * 1000));
+        MySqlSharedCache reader(cachePath, 16, 4096, milliseconds(60 * 1000));
+
+        typedef tuple<int, string, shared_ptr<double>> Row;
+        vector<Row> rows;
+        rows.push_back(Row(1, "brandon", shared_ptr<double>(new double(1.5))));
+        rows.push_back(Row(2, "gary", shared_ptr<double>()));
+
+        const char* const query = "SELECT id, name, score FROM user WHERE ?";
+        const int trueValue = 1;
+        vector<Row> cached;
+        BOOST_CHECK(!reader.get(&cached, query, trueValue));
+        BOOST_CHECK(writer.put(rows, query, trueValue));
+        BOOST_CHECK(reader.get(&cached, query, trueValue));
+        BOOST_CHECK(
+            2 == cached.size()
+            && 1 == get<0>(cached.at(0))
+            && "brandon" == get<1>(cached.at(0))
+            && nullptr != get<2>(cached.at(0))
+            && "gary" == get<1>(cached.at(1))
+            && nullptr == get<2>(cached.at(1)));
+        cached.clear();
+
+        // Different parameters or result types are different entries
+        const int falseValue = 0;
+        BOOST_CHECK(!reader.get(&cached, query, falseValue));
+        vector<tuple<int64_t, string, shared_ptr<double>>> otherType;
+        BOOST_CHECK(!reader.get(&otherType, query, trueValue));
+
+        // Results that don't fit in a slot aren't stored
+        vector<tuple<string>> tooBig{make_tuple(string(8192, 'a'))};
+        BOOST_CHECK(!writer.put(tooBig, query, trueValue));
+    } catch (const exception& e) {
+        BOOST_ERROR(e.what());
+    }
+
+    // Every process needs to agree on the layout
+    BOOST_CHECK_THROW(
+        MySqlSharedCache(cachePath, 8, 4096, milliseconds(1)),
+        MySqlException);
+    unlink(cachePath);
+}
@@ -0,0 +1,10 @@
+#ifndef TESTS_TESTMYSQLSHAREDCACHE_HPP_
+#define TESTS_TESTMYSQLSHAREDCACHE_HPP_
+
+/**
+ * Tests storing and loading results through two mappings of the same shared
+ * cache file, as two processes would.
+ */
+void testSharedCache();
+
+#endif  // TESTS_TESTMYSQLSHAREDCACHE_HPP_